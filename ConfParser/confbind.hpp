@@ -0,0 +1,193 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confbind.hpp
+ * \brief Typed binding of scopes onto C++ structures related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include "confscope.hpp"
+#include "confinstance.hpp"
+#include "conftype.hpp"
+#include "confpath.hpp"
+#include <array>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief A structure field bound to a dotted path
+	 * \see CP_FIELD
+	*/
+	template<typename _Struct, typename _Field> struct ConfField {
+		const char_t* Path;
+		_Field _Struct::* Member;
+	};
+
+	template<typename _Struct, typename _Field>
+	constexpr ConfField<_Struct, _Field> confField(const char_t* path, _Field _Struct::* member) {
+		return { path, member };
+	}
+
+	/*!
+	 * \brief Field table of a structure, to be specialized with CP_BIND
+	 * 
+	 * A specialization declares a constexpr tuple of ConfField named Fields
+	*/
+	template<typename _Ty> struct ConfBinding;
+
+	/*!
+	 * \brief Conf type matching a C++ field type
+	*/
+	template<typename _Ty> struct ConfBindTraits;
+
+	template<> struct ConfBindTraits<int> {
+		static constexpr const char_t* TypeName = NAME_TYPE_INT;
+	};
+
+	template<> struct ConfBindTraits<float> {
+		static constexpr const char_t* TypeName = NAME_TYPE_FLOAT;
+	};
+
+	template<> struct ConfBindTraits<string_t> {
+		static constexpr const char_t* TypeName = NAME_TYPE_STRING;
+	};
+
+	struct ConfBindError {
+		enum class Kind {
+			MISSING, //! Nothing found at Path, the field is left unchanged
+			TYPE_MISMATCH //! Found has not the field type
+		};
+
+		Kind Error;
+		string_t Path;
+
+		/*!
+		 * \brief Type name of the found instance or empty if not an instance
+		*/
+		string_t Found;
+	};
+
+	/*!
+	 * \brief Fill a structure from a scope through its field table
+	 * 
+	 * Each field path is resolved once to an instance slot and type checked.
+	 * Filling is then a load per field, the slots being resolved again only
+	 * when the structure of the root or of its parents changes, changes in
+	 * other trees are ignored. The root must outlive the binder.
+	 * 
+	 * \see bind, CP_BIND
+	*/
+	template<typename _Ty> class ConfBinder {
+		using Fields_t = std::remove_const_t<decltype(ConfBinding<_Ty>::Fields)>;
+		static constexpr std::size_t FIELDS_COUNT = std::tuple_size<Fields_t>::value;
+
+		ConfScope* m_Root;
+		std::array<ConfInstance*, FIELDS_COUNT> m_Slots{};
+		std::vector<ConfBindError> m_Errors;
+		/*!
+		 * \brief Lookup generation of m_Root the slots were resolved at
+		*/
+		std::uint64_t m_Generation;
+
+		template<typename _Struct, typename _Field>
+		ConfInstance* ResolveField(const ConfField<_Struct, _Field>& field) {
+			ConfScopeable* obj = ConfPath{ field.Path }.Resolve(m_Root);
+			if (!obj) {
+				m_Errors.push_back({ ConfBindError::Kind::MISSING, field.Path, {} });
+				return nullptr;
+			}
+			if (obj->GetCodeObjectType() != CodeObjectType::INSTANCE) {
+				m_Errors.push_back({ ConfBindError::Kind::TYPE_MISMATCH, field.Path, {} });
+				return nullptr;
+			}
+			ConfInstance* inst = static_cast<ConfInstance*>(obj);
+			if (inst->GetType()->GetNameView() != ConfBindTraits<_Field>::TypeName) {
+				m_Errors.push_back({ ConfBindError::Kind::TYPE_MISMATCH, field.Path, inst->GetType()->GetName() });
+				return nullptr;
+			}
+			return inst;
+		}
+
+		template<std::size_t... _Idx> void ResolveAll(std::index_sequence<_Idx...>) {
+			((m_Slots[_Idx] = ResolveField(std::get<_Idx>(ConfBinding<_Ty>::Fields))), ...);
+		}
+
+		template<typename _Struct, typename _Field>
+		static void Load(_Ty& out, const ConfField<_Struct, _Field>& field, ConfInstance* slot) {
+			if (slot) out.*field.Member = static_cast<ConfIntrinsicInstance<_Field>*>(slot)->GetRef();
+		}
+
+		template<std::size_t... _Idx> void LoadAll(_Ty& out, std::index_sequence<_Idx...>) const {
+			(Load(out, std::get<_Idx>(ConfBinding<_Ty>::Fields), m_Slots[_Idx]), ...);
+		}
+
+	public:
+		/*!
+		 * \brief Resolve the fields of _Ty in a scope
+		 * \param root The scope where the first name of each path is searched
+		*/
+		explicit ConfBinder(ConfScope* root) : m_Root{ root }, m_Generation{ 0 } {
+			Refresh();
+		}
+
+		/*!
+		 * \brief Resolve the fields again if the root lookup generation changed
+		 * \see ConfScope::GetLookupGeneration
+		*/
+		void Refresh() {
+			if (m_Generation == m_Root->GetLookupGeneration()) return;
+			m_Errors.clear();
+			ResolveAll(std::make_index_sequence<FIELDS_COUNT>{});
+			//Resolving may build lazy types, which changes the generation
+			m_Generation = m_Root->GetLookupGeneration();
+		}
+
+		/*!
+		 * \brief Copy the bound values into a structure
+		 * 
+		 * Fields in error are left unchanged
+		 * \return If every field has been set
+		*/
+		bool Fill(_Ty& out) {
+			Refresh();
+			LoadAll(out, std::make_index_sequence<FIELDS_COUNT>{});
+			return m_Errors.empty();
+		}
+
+		const std::vector<ConfBindError>& GetErrors() const {
+			return m_Errors;
+		}
+	};
+
+	/*!
+	 * \brief Create a binder of _Ty over a scope
+	 * \see ConfBinder
+	*/
+	template<typename _Ty> ConfBinder<_Ty> bind(ConfScope* root) {
+		return ConfBinder<_Ty>{ root };
+	}
+}
+
+/*!
+ * \brief Declare the field table of a structure, at global namespace scope
+ * 
+ * CP_BIND(Server, CP_FIELD(Server, port), CP_FIELD_PATH(Server, maxConn, "limits.max_conn"))
+*/
+#define CP_BIND(type, ...) namespace confparser { template<> struct ConfBinding<type> { \
+	static constexpr auto Fields = std::make_tuple(__VA_ARGS__); }; }
+
+/*!
+ * \brief A field bound to the name of the member
+*/
+#define CP_FIELD(type, member) ::confparser::confField(CP_TEXT(#member), &type::member)
+
+/*!
+ * \brief A field bound to a dotted path
+*/
+#define CP_FIELD_PATH(type, member, path) ::confparser::confField(CP_TEXT(path), &type::member)
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confdiff.cpp
+ * \brief Trees comparison related implementations
+ */
+
+#include "confdiff.hpp"
+#include "confparser.hpp"
+#include "confscope.hpp"
+#include "confinstance.hpp"
+#include "conftype.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+namespace confparser {
+	namespace {
+		/*!
+		 * \brief Get the childs of a scope or the subinstances of an instance
+		*/
+		std::vector<ConfScopeable*> childsOf(ConfScopeable* obj) {
+			std::vector<ConfScopeable*> ret;
+			switch (obj->GetCodeObjectType()) {
+			case CodeObjectType::INSTANCE:
+				for (auto it : static_cast<ConfInstance*>(obj)->GetSubInstances()) ret.push_back(it);
+				break;
+			case CodeObjectType::SCOPE:
+			case CodeObjectType::TYPE:
+			case CodeObjectType::FUNCTION:
+				for (auto it : static_cast<ConfScope*>(obj)->GetChilds()) {
+					if (it == ConfParser::GetIntrinsicScope()) continue;
+					ret.push_back(it);
+				}
+				break;
+			default:
+				break;
+			}
+			return ret;
+		}
+
+		/*!
+		 * \brief Check if two objects with the same name can be compared by their childs
+		*/
+		bool isSameKind(ConfScopeable* before, ConfScopeable* after) {
+			if (before->GetCodeObjectType() != after->GetCodeObjectType()) return false;
+			if (before->GetCodeObjectType() != CodeObjectType::INSTANCE) return true;
+			//Each tree declares its own types
+			ConfType* beforeType = static_cast<ConfInstance*>(before)->GetType();
+			ConfType* afterType = static_cast<ConfInstance*>(after)->GetType();
+			return beforeType && afterType ? beforeType->GetNameView() == afterType->GetNameView() : beforeType == afterType;
+		}
+
+		void compare(ConfScopeable* before, ConfScopeable* after, const string_t& prefix,
+			std::vector<ConfDifference>& changes) {
+			if (before->GetHash() == after->GetHash()) return;
+			const auto beforeChilds = childsOf(before), afterChilds = childsOf(after);
+			if (beforeChilds.empty() && afterChilds.empty()) {
+				changes.push_back({ ConfChange::MODIFIED, prefix });
+				return;
+			}
+
+			//The first declaration of a name is the one lookups find
+			std::unordered_map<string_view_t, ConfScopeable*> remaining;
+			for (auto it : afterChilds) remaining.emplace(it->GetNameView(), it);
+			const string_t path = prefix.empty() ? prefix : prefix + CP_TEXT('.');
+			for (auto it : beforeChilds) {
+				auto match = remaining.find(it->GetNameView());
+				if (match == remaining.end()) {
+					//Duplicated names are matched once
+					if (std::find_if(afterChilds.begin(), afterChilds.end(), [it](ConfScopeable* other) {
+						return other->GetNameView() == it->GetNameView(); }) == afterChilds.end())
+						changes.push_back({ ConfChange::REMOVED, path + it->GetName() });
+					continue;
+				}
+				ConfScopeable* other = match->second;
+				remaining.erase(match);
+				if (isSameKind(it, other)) compare(it, other, path + it->GetName(), changes);
+				else changes.push_back({ ConfChange::MODIFIED, path + it->GetName() });
+			}
+			for (auto it : afterChilds)
+				if (remaining.erase(it->GetNameView())) changes.push_back({ ConfChange::ADDED, path + it->GetName() });
+		}
+	}
+
+	std::vector<ConfDifference> diff(ConfScopeable* before, ConfScopeable* after) {
+		std::vector<ConfDifference> ret;
+		if (before && after) compare(before, after, {}, ret);
+		return ret;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confdiff.hpp
+ * \brief Trees comparison related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <vector>
+
+namespace confparser {
+	enum class ConfChange {
+		ADDED,
+		REMOVED,
+		MODIFIED //! Another value, type or kind. Objects with childs are never
+				 //! modified themselves, their changed childs are
+	};
+
+	/*!
+	 * \brief A changed object between two trees
+	*/
+	struct ConfDifference {
+		ConfChange Change;
+
+		/*!
+		 * \brief The dotted path of the object from the compared roots
+		*/
+		string_t Path;
+	};
+
+	/*!
+	 * \brief Compare two trees
+	 * 
+	 * Childs are matched by name. Subtrees with equal hashes are skipped
+	 * without being walked, so the cost depends on the changes, not on the
+	 * trees. Lazy types and initializers must be built first
+	 * \param before The old root
+	 * \param after The new root
+	 * \return The changes, in depth first order
+	 * \see ConfScopeable::GetHash
+	*/
+	std::vector<ConfDifference> diff(ConfScopeable* before, ConfScopeable* after);
+}
\ No newline at end of file
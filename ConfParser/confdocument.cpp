@@ -0,0 +1,411 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confdocument.cpp
+ * \brief Incrementally parsed text buffers related implementations
+ */
+
+#include "confdocument.hpp"
+#include "confscope.hpp"
+#include <algorithm>
+#include <queue>
+#include <cassert>
+
+namespace confparser {
+	namespace {
+		/*!
+		 * \brief Spacing of the line order keys, lines inserted between two
+		 *		  others take keys in their gap
+		*/
+		constexpr std::uint64_t ORDER_GAP = std::uint64_t(1) << 20;
+
+		std::vector<string_t> splitLines(const string_t& text) {
+			std::vector<string_t> ret{ {} };
+			for (auto ch : text) {
+				if (ch == CP_TEXT('\r')) continue;
+				if (ch == CP_TEXT('\n')) ret.emplace_back();
+				else ret.back().push_back(ch);
+			}
+			return ret;
+		}
+
+		bool addName(std::vector<string_t>& names, const string_t& name) {
+			if (name.empty() || std::find(names.begin(), names.end(), name) != names.end()) return false;
+			names.push_back(name);
+			return true;
+		}
+
+		void addNames(std::vector<string_t>& names, const ConfStatementInfo& info) {
+			addName(names, info.Declares);
+			for (const auto& it : info.Writes) addName(names, it);
+		}
+	}
+
+	ConfDocument::ConfDocument(const string_t& text, StringFormater_t format) :
+		m_Format{ format }, m_Root{ new ConfScope(ConfParser::GetIntrinsicScope()) }, m_Edits{ 0 } {
+		//Other documents and parsers keep roots parented to the intrinsic scope
+		m_Parser.m_OwnsEnvironment = false;
+		for (auto& it : splitLines(text)) {
+			m_Lines.push_back(std::make_unique<Line>());
+			m_Lines.back()->Text = std::move(it);
+		}
+		Renumber();
+		EvaluateAll();
+	}
+
+	ConfDocument::~ConfDocument() {
+		CP_SF(m_Root);
+		for (auto it : m_RemovedTypes) CP_SF(it);
+	}
+
+	string_t ConfDocument::GetText() const {
+		string_t ret;
+		for (std::size_t i{ 0 }; i < m_Lines.size(); ++i) {
+			if (i) ret.push_back(CP_TEXT('\n'));
+			ret += m_Lines[i]->Text;
+		}
+		return ret;
+	}
+
+	std::size_t ConfDocument::EvaluateAll() {
+		for (std::size_t i{ m_Root->GetChilds().size() }; m_KeepTypes && i-- > 0;) {
+			if (m_Root->GetChilds()[i]->GetCodeObjectType() == CodeObjectType::TYPE)
+				m_RemovedTypes.push_back(m_Root->RemoveChildAt(i));
+		}
+		m_Root->ClearChilds();
+		//Removed definitions must not enable blocks anymore
+		m_Parser.GetMacros().Clear();
+		m_Users.clear();
+		m_Declaring.clear();
+		m_ConditionReads.clear();
+		m_ConditionErrors.clear();
+		std::vector<Condition> conditions;
+		bool isEnabled = true;
+		ConfScope* currentScope = m_Root;
+		std::size_t ret = 0;
+		for (std::size_t i{ 0 }; i < m_Lines.size(); ++i) {
+			Line& line = *m_Lines[i];
+			string_t text = line.Text;
+			trim(text);
+			line.Scope = currentScope;
+			line.Declared = nullptr;
+			line.Info = {};
+			if (Preprocess(currentScope, text, i, conditions, isEnabled)) {
+				line.Info.IsStructural = true;
+				line.IsConditional = true;
+				continue;
+			}
+			line.IsConditional = !conditions.empty();
+			if (!isEnabled) continue;
+			SetInfo(line, ConfParser::AnalyzeLine(currentScope, text));
+			if (text.empty()) continue;
+
+			ConfScope* scope = currentScope;
+			std::size_t childs = scope->GetChilds().size();
+			m_Parser.ParseLine(&currentScope, std::move(text), m_Format);
+			if (scope->GetChilds().size() > childs) {
+				line.Declared = scope->GetChilds().back();
+				line.Child = scope->GetChilds().size() - 1;
+				if (scope == m_Root) m_Declaring.insert(&line);
+			}
+			++ret;
+		}
+		for (const auto& it : conditions)
+			m_ConditionErrors.push_back({ ConfConditionError::Kind::UNTERMINATED, {}, it.Line });
+		return ret;
+	}
+
+	bool ConfDocument::Preprocess(ConfScope* scope, const string_t& line, std::size_t index,
+		std::vector<Condition>& conditions, bool& isEnabled) {
+		string_view_t argument;
+		const auto directive = ConfParseTask::GetDirective(line, argument);
+		if (directive == ConfParseTask::Directive::NONE) return false;
+
+		string_t expression{ argument };
+		trim(expression);
+		if (directive == ConfParseTask::Directive::IF || directive == ConfParseTask::Directive::ELIF) {
+			for (const auto& it : operatorSplitter(expression)) {
+				if (!it.empty() && (cp_isalnum(it[0]) || it[0] == CP_TEXT('_')) &&
+					(it[0] < CP_TEXT('0') || it[0] > CP_TEXT('9')))
+					addName(m_ConditionReads, it);
+			}
+		}
+		switch (directive) {
+		case ConfParseTask::Directive::IF:
+		case ConfParseTask::Directive::IFDEF:
+		case ConfParseTask::Directive::IFNDEF: {
+			//Disabled blocks are not evaluated, their conditions neither
+			bool isTaken = isEnabled;
+			if (isTaken && directive == ConfParseTask::Directive::IF)
+				isTaken = m_Parser.EvaluateCondition(scope, expression);
+			else if (isTaken)
+				isTaken = m_Parser.GetMacros().IsDefined(expression) == (directive == ConfParseTask::Directive::IFDEF);
+			conditions.push_back({ isTaken, false, isEnabled, index + 1 });
+			isEnabled = isTaken;
+		}break;
+		case ConfParseTask::Directive::ELIF:
+		case ConfParseTask::Directive::ELSE: {
+			if (conditions.empty()) {
+				m_ConditionErrors.push_back({ ConfConditionError::Kind::UNMATCHED, {}, index + 1 });
+				break;
+			}
+			if (conditions.back().HasElse) {
+				m_ConditionErrors.push_back({ directive == ConfParseTask::Directive::ELSE ?
+					ConfConditionError::Kind::DUPLICATED_ELSE : ConfConditionError::Kind::ELIF_AFTER_ELSE, {}, index + 1 });
+				isEnabled = false;
+				break;
+			}
+			Condition& condition = conditions.back();
+			condition.HasElse = directive == ConfParseTask::Directive::ELSE;
+			isEnabled = condition.IsOuterEnabled && !condition.IsTaken &&
+				(condition.HasElse || m_Parser.EvaluateCondition(scope, expression));
+			condition.IsTaken |= isEnabled;
+		}break;
+		case ConfParseTask::Directive::ENDIF:
+			if (conditions.empty()) {
+				m_ConditionErrors.push_back({ ConfConditionError::Kind::UNMATCHED, {}, index + 1 });
+				break;
+			}
+			isEnabled = conditions.back().IsOuterEnabled;
+			conditions.pop_back();
+			break;
+		default:
+			break;
+		}
+		return true;
+	}
+
+	void ConfDocument::SetInfo(Line& line, ConfStatementInfo info) {
+		Unindex(line);
+		line.Info = std::move(info);
+		std::vector<string_t> names;
+		addName(names, line.Info.Declares);
+		for (const auto& it : line.Info.Reads) addName(names, it);
+		for (const auto& it : line.Info.Writes) addName(names, it);
+		for (auto& it : names) m_Users[std::move(it)].push_back(&line);
+	}
+
+	void ConfDocument::Unindex(Line& line) {
+		auto unindex = [this, &line](const string_t& name) {
+			auto users = m_Users.find(name);
+			if (users == m_Users.end()) return;
+			auto it = std::find(users->second.begin(), users->second.end(), &line);
+			if (it != users->second.end()) users->second.erase(it);
+			if (users->second.empty()) m_Users.erase(users);
+		};
+		unindex(line.Info.Declares);
+		for (const auto& it : line.Info.Reads) unindex(it);
+		for (const auto& it : line.Info.Writes) unindex(it);
+		m_Declaring.erase(&line);
+	}
+
+	void ConfDocument::Shift(const Line& line, std::ptrdiff_t delta) {
+		for (auto it = m_Declaring.upper_bound(const_cast<Line*>(&line)); it != m_Declaring.end(); ++it)
+			(*it)->Child += delta;
+	}
+
+	void ConfDocument::Undeclare(Line& line) {
+		if (!line.Declared) return;
+		//The slot is known, the scope is not searched
+		assert(line.Scope->GetChilds()[line.Child] == line.Declared);
+		line.Scope->RemoveChildAt(line.Child);
+		Release(line.Declared);
+		line.Declared = nullptr;
+		m_Declaring.erase(&line);
+		Shift(line, -1);
+	}
+
+	void ConfDocument::Release(ConfScopeable* object) {
+		if (m_KeepTypes && object->GetCodeObjectType() == CodeObjectType::TYPE) m_RemovedTypes.push_back(object);
+		else delete object;
+	}
+
+	void ConfDocument::Evaluate(Line& line) {
+		//Keep the declaration order of the scope: in the slot of the replaced
+		//object, else after the previous declaration
+		std::size_t position = 0;
+		const bool isReplacing = line.Declared != nullptr;
+		if (isReplacing) {
+			position = line.Child;
+			line.Scope->RemoveChildAt(position);
+			Release(line.Declared);
+			line.Declared = nullptr;
+			m_Declaring.erase(&line);
+		}
+		else {
+			auto previous = m_Declaring.lower_bound(&line);
+			if (previous != m_Declaring.begin()) position = (*std::prev(previous))->Child + 1;
+		}
+
+		string_t text = line.Text;
+		trim(text);
+		SetInfo(line, ConfParser::AnalyzeLine(line.Scope, text));
+		if (!text.empty()) {
+			ConfScope* scope = line.Scope;
+			std::size_t childs = scope->GetChilds().size();
+			m_Parser.ParseLine(&scope, std::move(text), m_Format);
+			if (line.Scope->GetChilds().size() > childs) {
+				line.Declared = line.Scope->RemoveChildAt(line.Scope->GetChilds().size() - 1);
+				line.Scope->InsertChild(position, line.Declared);
+				line.Child = position;
+				m_Declaring.insert(&line);
+				if (!isReplacing) Shift(line, 1);
+				return;
+			}
+		}
+		if (isReplacing) Shift(line, -1);
+	}
+
+	void ConfDocument::Renumber() {
+		for (std::size_t i{ 0 }; i < m_Lines.size(); ++i) m_Lines[i]->Order = (i + 1) * ORDER_GAP;
+	}
+
+	void ConfDocument::Replace(std::size_t begin, std::size_t end, std::vector<string_t> lines) {
+		for (std::size_t i{ begin }; i < end; ++i) Unindex(*m_Lines[i]);
+		m_Lines.erase(m_Lines.begin() + begin, m_Lines.begin() + end);
+
+		//Keys between the surrounding lines, the relative order of the others is kept
+		const std::uint64_t low = begin ? m_Lines[begin - 1]->Order : 0;
+		const std::uint64_t high = begin < m_Lines.size() ? m_Lines[begin]->Order : low + (lines.size() + 1) * ORDER_GAP;
+		const std::uint64_t step = (high - low) / (lines.size() + 1);
+		std::vector<std::unique_ptr<Line>> inserted;
+		for (std::size_t i{ 0 }; i < lines.size(); ++i) {
+			inserted.push_back(std::make_unique<Line>());
+			inserted.back()->Text = std::move(lines[i]);
+			inserted.back()->Scope = m_Root;
+			inserted.back()->Order = low + (i + 1) * step;
+		}
+		m_Lines.insert(m_Lines.begin() + begin, std::make_move_iterator(inserted.begin()),
+			std::make_move_iterator(inserted.end()));
+		if (!step) Renumber();
+	}
+
+	std::size_t ConfDocument::Edit(const ConfTextEdit& edit) {
+		auto clamp = [this](ConfTextPosition p) {
+			p.Line = std::min(p.Line, m_Lines.size() - 1);
+			p.Column = std::min(p.Column, m_Lines[p.Line]->Text.size());
+			return p;
+		};
+		ConfTextPosition start = clamp(edit.Start), end = clamp(edit.End);
+		if (end.Line < start.Line || (end.Line == start.Line && end.Column < start.Column))
+			std::swap(start, end);
+
+		auto newLines = splitLines(m_Lines[start.Line]->Text.substr(0, start.Column) + edit.Text +
+			m_Lines[end.Line]->Text.substr(end.Column));
+
+		//Names whose value may differ after the edit
+		std::vector<string_t> dirty;
+		bool full = false;
+		for (std::size_t i{ start.Line }; i <= end.Line; ++i) {
+			const Line& old = *m_Lines[i];
+			full |= old.Info.IsStructural || old.IsConditional || old.Scope != m_Root;
+			addNames(dirty, old.Info);
+		}
+		std::vector<string_t> removed;
+		if (!full) {
+			for (std::size_t i{ start.Line }; i <= end.Line; ++i) {
+				Line& old = *m_Lines[i];
+				if (!old.Declared) continue;
+				removed.push_back(old.Info.Declares);
+				Undeclare(old);
+			}
+		}
+
+		const std::size_t first = start.Line, last = start.Line + newLines.size();
+		Replace(start.Line, end.Line + 1, std::move(newLines));
+		if (full) return EvaluateAll();
+
+		std::vector<string_t> declared;
+		for (std::size_t i{ first }; i < last; ++i) {
+			string_t text = m_Lines[i]->Text;
+			trim(text);
+			auto info = ConfParser::AnalyzeLine(m_Root, text);
+			if (info.IsStructural) return EvaluateAll();
+			if (!info.Declares.empty()) declared.push_back(info.Declares);
+			addNames(dirty, info);
+		}
+
+		//A changed name may enable another branch of a conditional block
+		auto isCondition = [this](const string_t& name) {
+			return std::find(m_ConditionReads.begin(), m_ConditionReads.end(), name) != m_ConditionReads.end();
+		};
+		if (std::any_of(dirty.begin(), dirty.end(), isCondition)) return EvaluateAll();
+
+		//A changed name is replayed from its declaration
+		std::uint64_t from = m_Lines[first]->Order;
+		for (const auto& name : dirty) {
+			const Line* declaration = nullptr;
+			if (auto users = m_Users.find(name); users != m_Users.end()) {
+				for (const Line* it : users->second) {
+					if (it->Info.Declares == name && it->Order < m_Lines[first]->Order &&
+						(!declaration || it->Order < declaration->Order)) declaration = it;
+				}
+			}
+			if (declaration) from = std::min(from, declaration->Order);
+			else if (std::find(declared.begin(), declared.end(), name) == declared.end() &&
+				std::find(removed.begin(), removed.end(), name) == removed.end())
+				return EvaluateAll(); //Declared out of the buffer (included file), not replayable
+		}
+
+		//The lines to evaluate, in buffer order
+		auto isLater = [](const Line* a, const Line* b) { return a->Order > b->Order; };
+		std::priority_queue<Line*, std::vector<Line*>, decltype(isLater)> pending{ isLater };
+		const std::uint64_t visit = ++m_Edits;
+		//Users of a name from a position, each line once
+		auto schedule = [this, &pending, visit](const string_t& name, std::uint64_t from) {
+			auto users = m_Users.find(name);
+			if (users == m_Users.end()) return;
+			for (Line* it : users->second) {
+				if (it->Order < from || it->Visit == visit) continue;
+				it->Visit = visit;
+				pending.push(it);
+			}
+		};
+		for (std::size_t i{ first }; i < last; ++i) {
+			m_Lines[i]->Visit = visit;
+			pending.push(m_Lines[i].get());
+		}
+		for (const auto& name : dirty) schedule(name, from);
+		//The tree holds the values of the end of the buffer, a name written by a
+		//later line has not the value the line read in place
+		auto isOverwritten = [this, &dirty](const Line& line) {
+			for (const auto& name : line.Info.Reads) {
+				if (std::find(dirty.begin(), dirty.end(), name) != dirty.end()) continue;
+				auto users = m_Users.find(name);
+				if (users == m_Users.end()) continue;
+				for (const Line* it : users->second) {
+					if (it->Order > line.Order &&
+						std::find(it->Info.Writes.begin(), it->Info.Writes.end(), name) != it->Info.Writes.end())
+						return true;
+				}
+			}
+			return false;
+		};
+		//Run again on its previous result unless its name is replayed from its declaration
+		auto isAccumulated = [&dirty](const Line& line) {
+			return line.Info.IsCompound && std::any_of(line.Info.Writes.begin(), line.Info.Writes.end(),
+				[&dirty](const string_t& name) { return std::find(dirty.begin(), dirty.end(), name) == dirty.end(); });
+		};
+
+		std::size_t ret = 0;
+		while (!pending.empty()) {
+			Line& line = *pending.top();
+			pending.pop();
+			if (line.Scope != m_Root) return EvaluateAll();
+			Evaluate(line);
+			if (isOverwritten(line) || isAccumulated(line)) return EvaluateAll();
+			++ret;
+			std::vector<string_t> names;
+			addNames(names, line.Info);
+			for (const auto& it : names) {
+				if (!addName(dirty, it)) continue;
+				if (isCondition(it)) return EvaluateAll();
+				schedule(it, line.Order + 1);
+			}
+		}
+		return ret;
+	}
+}
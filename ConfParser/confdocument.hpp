@@ -0,0 +1,256 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confdocument.hpp
+ * \brief Incrementally parsed text buffers related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include "confparser.hpp"
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief Position in a text buffer, lines and columns are 0 based
+	*/
+	struct ConfTextPosition {
+		std::size_t Line;
+		std::size_t Column;
+	};
+
+	/*!
+	 * \brief Replacement of the text between Start (included) and End (excluded)
+	*/
+	struct ConfTextEdit {
+		ConfTextPosition Start;
+		ConfTextPosition End;
+		string_t Text;
+	};
+
+	/*!
+	 * \brief Source buffer kept parsed across edits
+	 *
+	 * Intended for editors: each edit re-lexes only the lines it touches and
+	 * re-runs only the statements which declare, read or write a name changed
+	 * by the edit. The scope tree is updated in place. Statements are found
+	 * through an index of the lines using each name and objects are replaced
+	 * in their slot, so the cost follows the statements evaluated again, not
+	 * the buffer size.
+	 *
+	 * An edit touching a structural line (directive, class, scope brace) or a
+	 * line inside a class body falls back to a full evaluation of the buffer,
+	 * as does a statement evaluated again which reads a name written by a
+	 * later line: the tree only holds the value of the end of the buffer. A
+	 * compound statement ('x += y') is only evaluated again with its name
+	 * replayed from the declaration, else the buffer is evaluated.
+	 *
+	 * Conditional blocks are evaluated as by parse tasks, disabled lines
+	 * declare nothing. An edit touching a conditional directive or a line
+	 * inside a block, or changing a name read by an %if or %elif expression,
+	 * is a full evaluation. Edits out of the blocks stay incremental.
+	 * Malformed blocks are reported by GetConditionErrors
+	 * \see ConfParseTask
+	*/
+	class ConfDocument {
+	public:
+		/*!
+		 * \brief Parse a buffer
+		 * \param text The source text
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		*/
+		ConfDocument(const string_t& text, StringFormater_t format = nullptr);
+		~ConfDocument();
+
+		ConfDocument(const ConfDocument&) = delete;
+		ConfDocument& operator=(const ConfDocument&) = delete;
+
+		/*!
+		 * \brief Get the root scope, the same pointer for the document lifetime
+		*/
+		ConfScope* GetRoot() const {
+			return m_Root;
+		}
+
+		/*!
+		 * \brief Get the current source text
+		*/
+		string_t GetText() const;
+
+		/*!
+		 * \brief Apply an edit and update the scope tree
+		 * \param edit The edit, positions are clamped to the buffer
+		 * \return The number of statements evaluated again
+		*/
+		std::size_t Edit(const ConfTextEdit& edit);
+
+		/*!
+		 * \brief Get the malformed conditional blocks of the last full
+		 *		  evaluation, lines are 1 based and files empty
+		*/
+		const std::vector<ConfConditionError>& GetConditionErrors() const {
+			return m_ConditionErrors;
+		}
+
+		/*!
+		 * \brief Keep the types the edits remove instead of deleting them
+		 *
+		 * Clones of the root keep referencing its types, the owner of such
+		 * clones takes the removed types and deletes them after the clones
+		 * \see TakeRemovedTypes
+		*/
+		void SetKeepTypes(bool keep) {
+			m_KeepTypes = keep;
+		}
+
+		/*!
+		 * \brief Take the types removed since the last call, the caller deletes them
+		*/
+		std::vector<ConfScopeable*> TakeRemovedTypes() {
+			return std::move(m_RemovedTypes);
+		}
+
+	private:
+		struct Line {
+			string_t Text;
+			ConfStatementInfo Info;
+
+			/*!
+			 * \brief The scope where the line was evaluated
+			*/
+			ConfScope* Scope = nullptr;
+
+			/*!
+			 * \brief The object the line added to Scope, if any
+			*/
+			ConfScopeable* Declared = nullptr;
+
+			/*!
+			 * \brief The position of Declared in the childs of Scope
+			*/
+			std::size_t Child = 0;
+
+			/*!
+			 * \brief Key increasing with the line position, kept across edits
+			*/
+			std::uint64_t Order = 0;
+
+			/*!
+			 * \brief The last edit which scheduled the line for evaluation
+			*/
+			std::uint64_t Visit = 0;
+
+			/*!
+			 * \brief The line is a conditional directive or inside a block
+			*/
+			bool IsConditional = false;
+		};
+
+		struct ByOrder {
+			bool operator()(const Line* a, const Line* b) const {
+				return a->Order < b->Order;
+			}
+		};
+
+		/*!
+		 * \brief A conditional block being evaluated
+		*/
+		struct Condition {
+			bool IsTaken; //! A branch of the block has been enabled
+			bool HasElse;
+			bool IsOuterEnabled; //! The lines around the block are enabled
+			std::size_t Line; //! The line of the opening directive, 1 based
+		};
+
+		/*!
+		 * \brief Clear the root and the macros then evaluate every enabled line
+		 * \return The number of evaluated statements
+		*/
+		std::size_t EvaluateAll();
+
+		/*!
+		 * \brief Apply a conditional directive
+		 * \param scope The scope where the directive is
+		 * \param index The position of the line in the buffer
+		 * \param conditions The enclosing conditional blocks, innermost last
+		 * \param isEnabled If the lines are enabled, updated for the next lines
+		 * \return If the line was a conditional directive
+		*/
+		bool Preprocess(ConfScope* scope, const string_t& line, std::size_t index, std::vector<Condition>& conditions,
+			bool& isEnabled);
+
+		/*!
+		 * \brief Evaluate a root line again, replacing what it declared in its slot
+		*/
+		void Evaluate(Line& line);
+
+		/*!
+		 * \brief Remove and delete the object a root line declared
+		*/
+		void Undeclare(Line& line);
+
+		/*!
+		 * \brief Delete an object removed from the tree, or keep it if a type
+		 * \see SetKeepTypes
+		*/
+		void Release(ConfScopeable* object);
+
+		/*!
+		 * \brief Move the slots of the root declarations after a line
+		*/
+		void Shift(const Line& line, std::ptrdiff_t delta);
+
+		/*!
+		 * \brief Set the analysis of a line and index its names
+		*/
+		void SetInfo(Line& line, ConfStatementInfo info);
+
+		/*!
+		 * \brief Remove a line from the indices
+		*/
+		void Unindex(Line& line);
+
+		/*!
+		 * \brief Replace the lines [begin, end) by new root lines, not evaluated
+		*/
+		void Replace(std::size_t begin, std::size_t end, std::vector<string_t> lines);
+
+		/*!
+		 * \brief Give every line an order key, spaced to insert lines between
+		*/
+		void Renumber();
+
+		ConfParser m_Parser;
+		StringFormater_t m_Format;
+		ConfScope* m_Root;
+		std::vector<std::unique_ptr<Line>> m_Lines;
+
+		/*!
+		 * \brief The lines declaring, reading or writing each name
+		*/
+		std::unordered_map<string_t, std::vector<Line*>> m_Users;
+
+		/*!
+		 * \brief The root lines which declared an object, in order
+		*/
+		std::set<Line*, ByOrder> m_Declaring;
+
+		std::uint64_t m_Edits;
+
+		/*!
+		 * \brief The names read by the %if and %elif expressions of the last
+		 *		  full evaluation
+		*/
+		std::vector<string_t> m_ConditionReads;
+		std::vector<ConfConditionError> m_ConditionErrors;
+
+		bool m_KeepTypes = false;
+		std::vector<ConfScopeable*> m_RemovedTypes;
+	};
+}
\ No newline at end of file
@@ -9,10 +9,23 @@
  */
 
 #include "conffunction.hpp"
+#include "confinstance.hpp"
+#include "conftype.hpp"
 
 namespace confparser {
 	ConfScopeable* ConfFunctionIntrinsic::Clone(string_t name, ConfScopeable* buf) const {
 		if (!buf) buf = new ConfFunctionIntrinsic(nullptr, name, m_Callback);
 		return buf;
 	}
+
+	ConfFunctionProfile* ConfFunctionIntrinsic::GetProfile(ConfInstance* _this) {
+		auto ret = m_Profile.load(std::memory_order_acquire);
+		if (ret) return ret;
+		string_t type;
+		if (m_Parent) type = m_Parent->GetName();
+		else if (_this && _this->GetType()) type = _this->GetType()->GetName();
+		ret = ConfFunctionProfiler::Instance().GetProfile(type, m_Name);
+		m_Profile.store(ret, std::memory_order_release);
+		return ret;
+	}
 }
\ No newline at end of file
@@ -11,7 +11,7 @@
 #pragma once
 #include "global.hpp"
 #include "confscope.hpp"
-#include <functional>
+#include "confprofiler.hpp"
 
 namespace confparser {
 	/*!
@@ -23,11 +23,17 @@ namespace confparser {
 	 */
 	class ConfFunctionIntrinsic : public ConfScope {
 	public:
-		using intricfunc_t = std::function<ConfInstance* (ConfInstance*, std::vector<ConfInstance*>)>;
+		/*!
+		 * \brief Plain function, intrinsic operators store the pointer of their
+		 *		  descriptor as is
+		 * \see ConfOperatorDescriptor
+		*/
+		using intricfunc_t = ConfInstance* (*)(ConfInstance*, std::vector<ConfInstance*>);
 
 		ConfFunctionIntrinsic(ConfScope* parent, string_t name, intricfunc_t callback) :
 			m_Callback{ callback }, m_Parent{ parent } {
 			m_Name = std::move(name);
+			Account(CodeObjectType::FUNCTION);
 		}
 
 		virtual CodeObjectType GetCodeObjectType() const override {
@@ -38,8 +44,11 @@ namespace confparser {
 		 * \brief Call the code linked to this function
 		 * \param _this The instance from where the method is called from
 		 * \param parameters List of parameters passed as arguments for the function call
+		 * \see ConfFunctionProfiler
 		 */
 		virtual ConfInstance* Call(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			if (!ConfFunctionProfiler::Instance().IsEnabled()) return m_Callback(_this, parameters);
+			ConfFunctionTimer timer{ GetProfile(_this) };
 			return m_Callback(_this, parameters);
 		}
 
@@ -48,6 +57,17 @@ namespace confparser {
 	protected:
 		intricfunc_t m_Callback;
 		ConfScope* m_Parent;
+
+		/*!
+		 * \brief Profile resolved on the first profiled call
+		*/
+		std::atomic<ConfFunctionProfile*> m_Profile{ nullptr };
+
+		/*!
+		 * \brief Get the profile keyed by the declaring type, or by the
+		 *		  receiver type for parentless clones
+		*/
+		ConfFunctionProfile* GetProfile(ConfInstance* _this);
 	};
 
 	/*!
@@ -0,0 +1,346 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confimage.cpp
+ * \brief Compiled binary images (.confc) related implementations
+ */
+
+#include "confimage.hpp"
+#include "confscope.hpp"
+#include "conftype.hpp"
+#include "confinstance.hpp"
+#include "confparser.hpp"
+#include <fstream>
+#include <cstring>
+#include <random>
+#include <cassert>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace confparser {
+	namespace {
+		std::int64_t writeTime(const std::filesystem::path& file) {
+			std::error_code ec;
+			auto ret = std::filesystem::last_write_time(file, ec);
+			return ec ? 0 : static_cast<std::int64_t>(ret.time_since_epoch().count());
+		}
+
+		/*!
+		 * \brief Get a temporary file name aside a file, unique to the writer
+		*/
+		std::filesystem::path tempPath(const std::filesystem::path& file) {
+#ifdef _WIN32
+			const unsigned long pid = GetCurrentProcessId();
+#else
+			const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+			std::filesystem::path ret = file;
+			ret += CP_TEXT(".") + cp_tostring(pid) + CP_TEXT(".") + cp_tostring(std::random_device{}()) + CP_TEXT(".tmp");
+			return ret;
+		}
+
+		string_t pathString(const std::filesystem::path& file) {
+#ifdef UNICODE
+			return file.wstring();
+#else
+			return file.string();
+#endif
+		}
+
+		/*!
+		 * \brief Image under construction
+		*/
+		struct ImageBuilder {
+			std::vector<ConfImageString> Strings;
+			std::vector<char_t> Chars;
+			std::unordered_map<string_t, std::uint32_t> Interned;
+			std::vector<ConfImageNode> Nodes;
+			std::vector<ConfScopeable*> Objects;
+
+			std::uint32_t Intern(const string_t& str) {
+				auto it = Interned.find(str);
+				if (it != Interned.end()) return it->second;
+				std::uint32_t ret = static_cast<std::uint32_t>(Strings.size());
+				Strings.push_back({ static_cast<std::uint32_t>(Chars.size()), static_cast<std::uint32_t>(str.size()) });
+				Chars.insert(Chars.end(), str.begin(), str.end());
+				Interned.emplace(str, ret);
+				return ret;
+			}
+
+			void Add(ConfScopeable* obj) {
+				ConfImageNode node{};
+				node.Kind = static_cast<std::uint8_t>(obj->GetCodeObjectType());
+				node.Name = Intern(obj->GetName());
+				node.Type = CONF_IMAGE_NPOS;
+				if (obj->GetCodeObjectType() == CodeObjectType::INSTANCE) {
+					ConfInstance* inst = static_cast<ConfInstance*>(obj);
+					const string_t typeName = inst->GetType()->GetName();
+					node.Type = Intern(typeName);
+					if (typeName == NAME_TYPE_INT) {
+						node.ValueKind = ConfImageValue::INT;
+						node.Value.Int = static_cast<ConfInstanceInt*>(inst)->Get();
+					}
+					else if (typeName == NAME_TYPE_FLOAT) {
+						node.ValueKind = ConfImageValue::FLOAT;
+						node.Value.Float = static_cast<ConfInstanceFloat*>(inst)->Get();
+					}
+					else if (typeName == NAME_TYPE_STRING) {
+						node.ValueKind = ConfImageValue::STRING;
+						node.Value.String = Intern(static_cast<ConfInstanceString*>(inst)->Get());
+					}
+				}
+				Nodes.push_back(node);
+				Objects.push_back(obj);
+			}
+
+			/*!
+			 * \brief Append the childs of Nodes[index], functions excluded
+			*/
+			void AddChilds(std::size_t index) {
+				ConfScopeable* obj = Objects[index];
+				const std::uint32_t first = static_cast<std::uint32_t>(Nodes.size());
+				if (obj->GetCodeObjectType() == CodeObjectType::INSTANCE) {
+					for (auto it : static_cast<ConfInstance*>(obj)->GetSubInstances()) Add(it);
+				}
+				else {
+					for (auto it : static_cast<ConfScope*>(obj)->GetChilds()) {
+						if (it->GetCodeObjectType() != CodeObjectType::FUNCTION) Add(it);
+					}
+				}
+				Nodes[index].FirstChild = first;
+				Nodes[index].ChildCount = static_cast<std::uint32_t>(Nodes.size()) - first;
+			}
+		};
+
+		ConfInstance* materializeInstance(const ConfImage& image, std::uint32_t index, ConfScope* scope) {
+			const ConfImageNode& node = image.GetNode(index);
+			ConfType* type = static_cast<ConfType*>(scope->GetByName(
+				string_t(image.GetString(node.Type)), CodeObjectType::TYPE));
+			if (!type) {
+				//Unresolved type
+				assert(false);
+				return nullptr;
+			}
+			ConfInstance* inst = type->CreateInstance(string_t(image.GetString(node.Name)));
+			if (!inst) return nullptr;
+			switch (node.ValueKind) {
+			case ConfImageValue::INT: static_cast<ConfInstanceInt*>(inst)->Set(node.Value.Int); break;
+			case ConfImageValue::FLOAT: static_cast<ConfInstanceFloat*>(inst)->Set(node.Value.Float); break;
+			case ConfImageValue::STRING:
+				static_cast<ConfInstanceString*>(inst)->Set(string_t(image.GetString(node.Value.String)));
+				break;
+			default: break;
+			}
+			inst->ClearSubInstances();
+			for (std::uint32_t i{ 0 }, count{ image.GetChildCount(index) }; i < count; ++i) {
+				if (ConfInstance* sub = materializeInstance(image, node.FirstChild + i, scope))
+					inst->AddSubInstance(sub);
+			}
+			return inst;
+		}
+
+		void materializeChilds(const ConfImage& image, std::uint32_t index, ConfScope* scope) {
+			const ConfImageNode& node = image.GetNode(index);
+			for (std::uint32_t i{ 0 }, count{ image.GetChildCount(index) }; i < count; ++i) {
+				const ConfImageNode& child = image.GetNode(node.FirstChild + i);
+				switch (static_cast<CodeObjectType>(child.Kind)) {
+				case CodeObjectType::TYPE: {
+					ConfType* ty = new ConfType(string_t(image.GetString(child.Name)), scope);
+					*ty += *ConfTypeIntrinsic::GetIntrinsicType(NAME_TYPE_OBJECT);
+					scope->AddChild(ty);
+					materializeChilds(image, node.FirstChild + i, ty);
+				}break;
+				case CodeObjectType::INSTANCE:
+					if (ConfInstance* inst = materializeInstance(image, node.FirstChild + i, scope)) scope->AddChild(inst);
+					break;
+				default:
+					//Anonymous scopes are not produced by the parser
+					break;
+				}
+			}
+		}
+	}
+
+	ConfImage::~ConfImage() {
+		Close();
+	}
+
+	bool ConfImage::Open(const std::filesystem::path& file) {
+		Close();
+#ifdef _WIN32
+		m_File = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE) {
+			m_File = nullptr;
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(m_File, &size) && size.QuadPart > 0) {
+			m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_Mapping) {
+				m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+				m_Size = static_cast<std::size_t>(size.QuadPart);
+			}
+		}
+#else
+		int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				m_Data = static_cast<const unsigned char*>(data);
+				m_Size = static_cast<std::size_t>(st.st_size);
+			}
+		}
+		close(fd);
+#endif
+		if (!m_Data || m_Size < sizeof(ConfImageHeader)) {
+			Close();
+			return false;
+		}
+
+		const ConfImageHeader& header = Header();
+		auto fits = [this](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+			return offset <= m_Size && count <= (m_Size - offset) / size;
+		};
+		if (std::memcmp(header.Magic, CONF_IMAGE_MAGIC, sizeof(CONF_IMAGE_MAGIC)) != 0 ||
+			header.Version != CONF_IMAGE_VERSION || header.CharSize != sizeof(char_t) || header.NodeCount == 0 ||
+			!fits(header.SourcesOffset, header.SourceCount, sizeof(ConfImageSource)) ||
+			!fits(header.StringsOffset, header.StringCount, sizeof(ConfImageString)) ||
+			!fits(header.NodesOffset, header.NodeCount, sizeof(ConfImageNode)) ||
+			!fits(header.CharsOffset, header.CharsCount, sizeof(char_t)) ||
+			!fits(header.DefinesOffset, header.DefineCount, sizeof(std::uint32_t))) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void ConfImage::Close() {
+#ifdef _WIN32
+		if (m_Data) UnmapViewOfFile(m_Data);
+		if (m_Mapping) CloseHandle(m_Mapping);
+		if (m_File) CloseHandle(m_File);
+		m_Mapping = m_File = nullptr;
+#else
+		if (m_Data) munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	string_view_t ConfImage::GetString(std::uint32_t index) const {
+		const ConfImageHeader& header = Header();
+		if (index >= header.StringCount) return {};
+		const ConfImageString& str = reinterpret_cast<const ConfImageString*>(m_Data + header.StringsOffset)[index];
+		if (static_cast<std::uint64_t>(str.Offset) + str.Length > header.CharsCount) return {};
+		return { reinterpret_cast<const char_t*>(m_Data + header.CharsOffset) + str.Offset, str.Length };
+	}
+
+	std::vector<string_t> ConfImage::GetDefines() const {
+		std::vector<string_t> ret;
+		if (!IsOpen()) return ret;
+		const std::uint32_t* defines = reinterpret_cast<const std::uint32_t*>(m_Data + Header().DefinesOffset);
+		for (std::uint32_t i{ 0 }; i < Header().DefineCount; ++i) ret.emplace_back(GetString(defines[i]));
+		return ret;
+	}
+
+	bool ConfImage::IsUpToDate(std::uint64_t macros) const {
+		if (!IsOpen() || Header().Macros != macros) return false;
+		for (std::uint32_t i{ 0 }; i < GetSourceCount(); ++i) {
+			const ConfImageSource& source = GetSource(i);
+			std::filesystem::path file{ string_t(GetString(source.Path)) };
+			std::error_code ec;
+			auto size = std::filesystem::file_size(file, ec);
+			if (ec || size != source.Size) return false;
+			if (writeTime(file) == source.WriteTime) continue;
+			//Touched but maybe not modified
+			std::uint64_t hash;
+			if (!ConfParser::HashFile(file, hash) || hash != source.Hash) return false;
+		}
+		return true;
+	}
+
+	ConfScope* ConfImage::Materialize(ConfScope* root) const {
+		if (IsOpen()) materializeChilds(*this, 0, root);
+		return root;
+	}
+
+	bool ConfImage::Write(const std::filesystem::path& file, ConfScope* root,
+		const std::vector<std::filesystem::path>& sources, std::uint64_t macros,
+		const std::vector<string_t>& defines) {
+		ImageBuilder builder;
+		std::vector<ConfImageSource> sourcesTable;
+		for (const auto& it : sources) {
+			ConfImageSource source{};
+			std::error_code ec;
+			source.Size = std::filesystem::file_size(it, ec);
+			if (ec || !ConfParser::HashFile(it, source.Hash)) return false;
+			source.WriteTime = writeTime(it);
+			source.Path = builder.Intern(pathString(it));
+			sourcesTable.push_back(source);
+		}
+		std::vector<std::uint32_t> definesTable;
+		for (const auto& it : defines) definesTable.push_back(builder.Intern(it));
+
+		builder.Add(root);
+		for (std::size_t i{ 0 }; i < builder.Nodes.size(); ++i) builder.AddChilds(i);
+
+		auto align = [](std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); };
+		ConfImageHeader header{};
+		std::memcpy(header.Magic, CONF_IMAGE_MAGIC, sizeof(CONF_IMAGE_MAGIC));
+		header.Version = CONF_IMAGE_VERSION;
+		header.CharSize = sizeof(char_t);
+		header.SourceCount = static_cast<std::uint32_t>(sourcesTable.size());
+		header.StringCount = static_cast<std::uint32_t>(builder.Strings.size());
+		header.NodeCount = static_cast<std::uint32_t>(builder.Nodes.size());
+		header.CharsCount = builder.Chars.size();
+		header.Macros = macros;
+		header.DefineCount = static_cast<std::uint32_t>(definesTable.size());
+		header.SourcesOffset = align(sizeof(ConfImageHeader));
+		header.StringsOffset = align(header.SourcesOffset + sourcesTable.size() * sizeof(ConfImageSource));
+		header.NodesOffset = align(header.StringsOffset + builder.Strings.size() * sizeof(ConfImageString));
+		header.CharsOffset = align(header.NodesOffset + builder.Nodes.size() * sizeof(ConfImageNode));
+		header.DefinesOffset = align(header.CharsOffset + builder.Chars.size() * sizeof(char_t));
+
+		//Writers of the same image each write their own file, the last rename wins
+		const std::filesystem::path temp = tempPath(file);
+		std::error_code ec;
+		{
+			std::ofstream ofs{ temp, std::ios::binary | std::ios::trunc };
+			if (!ofs) return false;
+			auto write = [&ofs](std::uint64_t offset, const void* data, std::size_t size) {
+				static const char padding[8] = {};
+				ofs.write(padding, static_cast<std::streamsize>(offset - static_cast<std::uint64_t>(ofs.tellp())));
+				ofs.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			};
+			write(0, &header, sizeof(header));
+			write(header.SourcesOffset, sourcesTable.data(), sourcesTable.size() * sizeof(ConfImageSource));
+			write(header.StringsOffset, builder.Strings.data(), builder.Strings.size() * sizeof(ConfImageString));
+			write(header.NodesOffset, builder.Nodes.data(), builder.Nodes.size() * sizeof(ConfImageNode));
+			write(header.CharsOffset, builder.Chars.data(), builder.Chars.size() * sizeof(char_t));
+			write(header.DefinesOffset, definesTable.data(), definesTable.size() * sizeof(std::uint32_t));
+			ofs.close();
+			if (!ofs) {
+				std::filesystem::remove(temp, ec);
+				return false;
+			}
+		}
+		std::filesystem::rename(temp, file, ec);
+		if (!ec) return true;
+		std::filesystem::remove(temp, ec);
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confimage.hpp
+ * \brief Compiled binary images (.confc) related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <filesystem>
+#include <vector>
+#include <cstdint>
+
+namespace confparser {
+	constexpr char CONF_IMAGE_MAGIC[4] = { 'C', 'P', 'C', 'I' };
+	constexpr std::uint32_t CONF_IMAGE_VERSION = 2;
+	constexpr char_t CONF_IMAGE_EXTENSION[] = CP_TEXT(".confc");
+
+	/*!
+	 * \brief Index used for "no string" in images
+	*/
+	constexpr std::uint32_t CONF_IMAGE_NPOS = 0xFFFFFFFF;
+
+	/*!
+	 * \brief Kind of raw value stored in an image instance node
+	*/
+	enum class ConfImageValue : std::uint8_t {
+		NONE,
+		INT,
+		FLOAT,
+		STRING
+	};
+
+	/*!
+	 * \brief Image file header, sections offsets are in bytes from the file start
+	*/
+	struct ConfImageHeader {
+		char Magic[4];
+		std::uint32_t Version;
+		std::uint32_t CharSize;
+		std::uint32_t SourceCount;
+		std::uint32_t StringCount;
+		std::uint32_t NodeCount;
+		std::uint64_t SourcesOffset;
+		std::uint64_t StringsOffset;
+		std::uint64_t NodesOffset;
+		std::uint64_t CharsOffset;
+		std::uint64_t CharsCount;
+
+		/*!
+		 * \brief Hash of the macros defined before the parse
+		 * \see ConfMacroTable::GetHash
+		*/
+		std::uint64_t Macros;
+
+		/*!
+		 * \brief Count of the strings indices of the %define directives giving
+		 *		  the macros after the parse, at DefinesOffset
+		*/
+		std::uint32_t DefineCount;
+		std::uint32_t Reserved;
+		std::uint64_t DefinesOffset;
+	};
+
+	/*!
+	 * \brief Source file the image was compiled from
+	*/
+	struct ConfImageSource {
+		std::uint32_t Path;
+		std::uint32_t Reserved;
+		std::uint64_t Size;
+		std::int64_t WriteTime;
+		std::uint64_t Hash;
+	};
+
+	/*!
+	 * \brief Interned string, Offset and Length are in chars
+	*/
+	struct ConfImageString {
+		std::uint32_t Offset;
+		std::uint32_t Length;
+	};
+
+	/*!
+	 * \brief Scope tree node
+	 *
+	 * Nodes are stored breadth first so the childs of a node are contiguous.
+	 * Node 0 is the root scope. Functions are not stored: types get the
+	 * 'object' operators back when loaded, like a class declaration
+	*/
+	struct ConfImageNode {
+		std::uint8_t Kind; //! \see CodeObjectType
+		ConfImageValue ValueKind;
+		std::uint16_t Reserved;
+		std::uint32_t Name;
+
+		/*!
+		 * \brief Name of the instance type, CONF_IMAGE_NPOS for scopes and types
+		*/
+		std::uint32_t Type;
+		std::uint32_t FirstChild;
+		std::uint32_t ChildCount;
+		union {
+			std::int32_t Int;
+			float Float;
+			std::uint32_t String;
+		} Value;
+	};
+
+	/*!
+	 * \brief Memory mapped compiled image of an evaluated scope tree
+	 *
+	 * An image is written after a parse and memory mapped by the next ones.
+	 * It stays valid while its sources are unchanged: same size and
+	 * modification time or, failing that, same content hash, for parses
+	 * starting with the same macros. It holds the macros defined after the
+	 * parse so a load defines them as the parse would.
+	 *
+	 * \see ConfParser::SetImageCache
+	*/
+	class ConfImage {
+	public:
+		ConfImage() = default;
+		~ConfImage();
+
+		ConfImage(const ConfImage&) = delete;
+		ConfImage& operator=(const ConfImage&) = delete;
+
+		/*!
+		 * \brief Map an image file and check its header
+		 * \param file The image path
+		 * \return If the image can be used, it is closed otherwise
+		*/
+		bool Open(const std::filesystem::path& file);
+
+		void Close();
+
+		bool IsOpen() const {
+			return m_Data != nullptr;
+		}
+
+		/*!
+		 * \brief Check the image sources against the file system
+		 * \param macros Hash of the macros defined before the parse
+		*/
+		bool IsUpToDate(std::uint64_t macros) const;
+
+		/*!
+		 * \brief Build the scope tree of the image
+		 * \param root The scope where to declare the top level objects
+		 * \return root
+		*/
+		ConfScope* Materialize(ConfScope* root) const;
+
+		/*!
+		 * \brief Compile a scope tree into an image file
+		 *
+		 * The file is written aside, under a name unique to the writer, then
+		 * renamed so concurrent readers never map a partial image and
+		 * concurrent writers never mix theirs
+		 * \param file The image path
+		 * \param root The scope tree to compile
+		 * \param sources The files root was parsed from
+		 * \param macros Hash of the macros defined before the parse
+		 * \param defines The directives defining the macros after the parse
+		 * \return If the image has been written
+		 * \see ConfMacroTable::GetDefinitions
+		*/
+		static bool Write(const std::filesystem::path& file, ConfScope* root,
+			const std::vector<std::filesystem::path>& sources, std::uint64_t macros,
+			const std::vector<string_t>& defines);
+
+		std::uint32_t GetNodeCount() const {
+			return Header().NodeCount;
+		}
+
+		/*!
+		 * \brief Get a node, index must be lower than GetNodeCount
+		*/
+		const ConfImageNode& GetNode(std::uint32_t index) const {
+			return reinterpret_cast<const ConfImageNode*>(m_Data + Header().NodesOffset)[index];
+		}
+
+		/*!
+		 * \brief Get the childs count of a node, index must be lower than GetNodeCount
+		 * 
+		 * Childs are written after their parent, a corrupted node placing them
+		 * elsewhere or out of bounds has none, which bounds the recursion of
+		 * the walkers
+		*/
+		std::uint32_t GetChildCount(std::uint32_t index) const {
+			const ConfImageNode& node = GetNode(index);
+			if (node.FirstChild <= index || node.FirstChild > GetNodeCount() ||
+				node.ChildCount > GetNodeCount() - node.FirstChild) return 0;
+			return node.ChildCount;
+		}
+
+		/*!
+		 * \brief Get an interned string, empty if out of bounds
+		*/
+		string_view_t GetString(std::uint32_t index) const;
+
+		std::uint32_t GetSourceCount() const {
+			return Header().SourceCount;
+		}
+
+		const ConfImageSource& GetSource(std::uint32_t index) const {
+			return reinterpret_cast<const ConfImageSource*>(m_Data + Header().SourcesOffset)[index];
+		}
+
+		/*!
+		 * \brief Get the directives defining the macros after the parse
+		*/
+		std::vector<string_t> GetDefines() const;
+
+	private:
+		const ConfImageHeader& Header() const {
+			return *reinterpret_cast<const ConfImageHeader*>(m_Data);
+		}
+
+		const unsigned char* m_Data = nullptr;
+		std::size_t m_Size = 0;
+#ifdef _WIN32
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#endif
+	};
+}
\ No newline at end of file
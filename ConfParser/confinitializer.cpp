@@ -0,0 +1,48 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confinitializer.cpp
+ * \brief Lazily evaluated initializers related implementations
+ */
+
+#include "confinitializer.hpp"
+#include "confinstance.hpp"
+
+namespace confparser {
+	bool ConfInitializers::Run(ConfScope* scope, ConfScopeable* target) {
+		auto it = m_Initializers.find(target);
+		if (it == m_Initializers.end()) return true;
+		if (it->second.IsRunning) {
+			//Cyclic initializers, the instance keeps its default value
+			it->second.Parser->m_InitializerCycles.push_back(target->GetName());
+			return false;
+		}
+
+		//Elements stay in place when the initializers of the dependencies are removed
+		ConfInitializer& initializer = it->second;
+		initializer.IsRunning = true;
+		initializer.Parser->RunInitializer(scope, static_cast<ConfInstance*>(target), initializer.Statement);
+		m_Initializers.erase(target);
+		if (m_Initializers.empty()) m_Readers.clear();
+		return true;
+	}
+
+	void ConfInitializers::RunReading(ConfScope* scope, const string_t& name) {
+		auto range = m_Readers.equal_range(name);
+		if (range.first == range.second) return;
+		std::vector<const ConfScopeable*> targets;
+		for (auto it = range.first; it != range.second; ++it) targets.push_back(it->second);
+		m_Readers.erase(range.first, range.second);
+		for (auto it : targets) Run(scope, const_cast<ConfScopeable*>(it));
+	}
+
+	void ConfInitializers::RunAll(ConfScope* scope) {
+		while (!m_Initializers.empty()) {
+			//Running one may run others
+			Run(scope, const_cast<ConfScopeable*>(m_Initializers.begin()->first));
+		}
+	}
+}
\ No newline at end of file
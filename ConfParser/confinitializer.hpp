@@ -0,0 +1,102 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confinitializer.hpp
+ * \brief Lazily evaluated initializers related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include "confparser.hpp"
+#include <unordered_map>
+
+namespace confparser {
+	/*!
+	 * \brief The compiled right side of a declaration, evaluated on the first
+	 *		  lookup of the declared instance
+	 * \see ConfParser::SetLazyInitializers
+	*/
+	struct ConfInitializer {
+		/*!
+		 * \brief The parser evaluating the initializer, must outlive it
+		*/
+		ConfParser* Parser;
+		ConfParenthesized_t Statement;
+
+		/*!
+		 * \brief The names the statement reads, the initializer is evaluated
+		 *		  before one of them is written
+		*/
+		std::vector<string_t> Reads;
+
+		/*!
+		 * \brief The initializer is being evaluated, a lookup of its instance
+		 *		  now is a cycle
+		*/
+		bool IsRunning = false;
+	};
+
+	/*!
+	 * \brief The initializers not evaluated yet in a scope
+	 * \see ConfScope::AddInitializer
+	*/
+	class ConfInitializers {
+		std::unordered_map<const ConfScopeable*, ConfInitializer> m_Initializers;
+
+		/*!
+		 * \brief The targets by name read, may hold targets already evaluated
+		 *		  or removed: evaluating an initializer early is harmless
+		*/
+		std::unordered_multimap<string_t, const ConfScopeable*> m_Readers;
+	public:
+		void Add(const ConfScopeable* target, ConfInitializer initializer) {
+			for (const auto& it : initializer.Reads) m_Readers.emplace(it, target);
+			m_Initializers[target] = std::move(initializer);
+		}
+
+		/*!
+		 * \brief Forget the initializer of an instance without evaluating it
+		*/
+		void Remove(const ConfScopeable* target) {
+			m_Initializers.erase(target);
+		}
+
+		void Clear() {
+			m_Initializers.clear();
+			m_Readers.clear();
+		}
+
+		bool IsEmpty() const {
+			return m_Initializers.empty();
+		}
+
+		std::size_t GetCount() const {
+			return m_Initializers.size();
+		}
+
+		/*!
+		 * \brief Evaluate the initializer of an instance, if any
+		 * \param scope The scope where the instance is declared
+		 * \param target The instance
+		 * \return False if the initializer depends on itself, the cycle is
+		 *		  reported to its parser
+		 * \see ConfParser::GetInitializerCycles
+		*/
+		bool Run(ConfScope* scope, ConfScopeable* target);
+
+		/*!
+		 * \brief Evaluate the initializers reading a name, before it is written
+		 * \param scope The scope where the instances are declared
+		 * \param name The name about to be written
+		*/
+		void RunReading(ConfScope* scope, const string_t& name);
+
+		/*!
+		 * \brief Evaluate every initializer, in no particular order
+		*/
+		void RunAll(ConfScope* scope);
+	};
+}
\ No newline at end of file
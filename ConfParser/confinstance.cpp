@@ -31,6 +31,35 @@ namespace confparser {
 		return nullptr;
 	}
 
+	std::uint64_t ConfInstance::ComputeHash() const {
+		std::uint64_t ret = ConfScopeable::ComputeHash();
+		if (m_Type) {
+			const string_t type = m_Type->GetName();
+			ret = hashBytes(type.data(), type.size() * sizeof(char_t), ret);
+		}
+		for (auto it : m_SubInstances) {
+			const std::uint64_t hash = it->GetHash();
+			ret = hashBytes(&hash, sizeof(hash), ret);
+		}
+		return ret;
+	}
+
+	ConfInstance* ConfInstance::Detach(std::size_t index) {
+		ConfInstance* ret = m_SubInstances[index];
+		if (!ret->m_Shares) {
+			//Its first owner may have released it, changes must reach this one
+			SetOwner(ret, this);
+			return ret;
+		}
+		--ret->m_Shares;
+		if (ret->m_Owner == this) SetOwner(ret, nullptr);
+		ret = static_cast<ConfInstance*>(ret->Clone(ret->GetName()));
+		m_SubInstances[index] = ret;
+		SetOwner(ret, this);
+		Touch();
+		return ret;
+	}
+
 	ConfFunctionIntrinsic* ConfInstance::GetFunction(const string_t& funcName) {
 		return static_cast<ConfFunctionIntrinsic*>(m_Type->GetByName(funcName, CodeObjectType::FUNCTION));
 	}
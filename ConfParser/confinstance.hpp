@@ -12,6 +12,7 @@
 #include "global.hpp"
 #include "confscopeable.hpp"
 #include <string>
+#include <type_traits>
 #include <cassert>
 
 namespace confparser {
@@ -25,10 +26,25 @@ namespace confparser {
 	protected:
 		std::vector<ConfInstance*> m_SubInstances;
 		ConfType* m_Type;
+
+		/*!
+		 * \brief Owners beyond the first, a shared instance is deleted by its
+		 *		  last owner
+		 * \see ConfInterner
+		*/
+		std::uint32_t m_Shares = 0;
+
+		friend class ConfInterner;
+
+		/*!
+		 * \brief Hash the type name and the subinstances too
+		*/
+		virtual std::uint64_t ComputeHash() const override;
 	public:
 		ConfInstance(ConfType* type, string_t name) {
 			m_Type = type;
 			m_Name = std::move(name);
+			Account(CodeObjectType::INSTANCE);
 		}
 
 		~ConfInstance() {
@@ -36,13 +52,19 @@ namespace confparser {
 		}
 
 		/*!
-		 * \brief Safe delete all subinstances
+		 * \brief Safe delete all subinstances, shared ones are released
 		 */
 		void ClearSubInstances() {
 			for (auto it : m_SubInstances) {
-				CP_SF(it);
+				if (!it->m_Shares) {
+					CP_SF(it);
+					continue;
+				}
+				--it->m_Shares;
+				if (it->m_Owner == this) SetOwner(it, nullptr);
 			}
 			m_SubInstances.clear();
+			Touch();
 		}
 
 		virtual CodeObjectType GetCodeObjectType() const override {
@@ -64,10 +86,14 @@ namespace confparser {
 		virtual ConfFunctionIntrinsic* GetFunction(const string_t& funcName);
 
 		/*!
-		 * \brief [Unused: to be removed] Get the memory cost of the instance
+		 * \brief Get the memory used by the instance and its subinstances
+		 * \see ConfScopeable::GetSize
 		*/
-		virtual std::size_t GetSize() const {
-			return 0;
+		virtual std::size_t GetSize() const override {
+			std::size_t ret = ConfScopeable::GetSize() + m_SubInstances.capacity() * sizeof(ConfInstance*);
+			//Shared subinstances are split between their owners
+			for (auto it : m_SubInstances) ret += it->GetSize() / (it->m_Shares + 1);
+			return ret;
 		}
 
 		virtual ConfType* GetType() const {
@@ -78,12 +104,29 @@ namespace confparser {
 			return m_SubInstances;
 		}
 
+		/*!
+		 * \brief Check if the instance is owned by several instances, it must
+		 *		  then be detached from its owner before being written
+		*/
+		bool IsShared() const {
+			return m_Shares > 0;
+		}
+
+		/*!
+		 * \brief Get a subinstance to write to, replaced by a private copy if shared
+		 * \param index The subinstance position, lower than GetSubInstances().size()
+		*/
+		ConfInstance* Detach(std::size_t index);
+
 		virtual void AddSubInstance(ConfInstance* inst) {
 			m_SubInstances.push_back(inst);
+			SetOwner(inst, this);
+			Touch();
 		}
 
 		virtual ConfInstance& operator=(ConfInstance* inst) {
 			m_SubInstances = inst->m_SubInstances;
+			Touch();
 			return *this;
 		}
 
@@ -101,18 +144,29 @@ namespace confparser {
 	 */
 	template<typename _Ty>class ConfIntrinsicInstance : public ConfInstance {
 	protected:
-		_Ty m_Data;
+		_Ty m_Data{};
 	public:
 		ConfIntrinsicInstance<_Ty>(ConfType* strType, string_t name) : ConfInstance{ strType,std::move(name) } {
 
 		}
 
+		/*!
+		 * \brief Clone the instance including its raw value
+		 * \see ConfScopeable::Clone
+		*/
+		virtual ConfScopeable* Clone(string_t name, ConfScopeable* buf = nullptr) const override {
+			auto ret = static_cast<ConfIntrinsicInstance<_Ty>*>(ConfInstance::Clone(std::move(name), buf));
+			ret->m_Data = m_Data;
+			return ret;
+		}
+
 		/*!
 		 * \brief Set the raw value
 		 * \param data The new value
 		*/
 		inline void Set(_Ty data) {
 			m_Data = data;
+			TouchValue();
 		}
 
 		/*!
@@ -122,6 +176,23 @@ namespace confparser {
 			return m_Data;
 		}
 
+		/*!
+		 * \brief Get the raw value without copying it
+		*/
+		inline const _Ty& GetRef() const {
+			return m_Data;
+		}
+
+		/*!
+		 * \brief Get the memory used by the instance including a string value heap
+		 * \see ConfScopeable::GetSize
+		*/
+		virtual std::size_t GetSize() const override {
+			if constexpr (std::is_same_v<_Ty, string_t>)
+				return ConfInstance::GetSize() + GetHeapSize(m_Data);
+			else return ConfInstance::GetSize();
+		}
+
 		/*!
 		 * \brief Set the raw value from a string
 		 * 
@@ -133,6 +204,19 @@ namespace confparser {
 		virtual void SetFromString(const string_t& v) override final {
 			ConfInstance::SetFromString(v);
 		}
+
+		/*!
+		 * \brief Hash the raw value too, object references are not
+		*/
+		virtual std::uint64_t ComputeHash() const override {
+			const std::uint64_t ret = ConfInstance::ComputeHash();
+			if constexpr (std::is_same_v<_Ty, string_t>)
+				return hashBytes(m_Data.data(), m_Data.size() * sizeof(char_t), ret);
+			else if constexpr (std::is_arithmetic_v<_Ty>)
+				return hashBytes(&m_Data, sizeof(m_Data), ret);
+			else
+				return ret;
+		}
 	};
 
 	using ConfInstanceString = ConfIntrinsicInstance<string_t>;
@@ -140,19 +224,22 @@ namespace confparser {
 	using ConfInstanceFloat = ConfIntrinsicInstance<float>;
 	using ConfInstanceObject = ConfIntrinsicInstance<ConfInstance*>;
 
-	template<> void ConfInstanceString::SetFromString(const string_t& v) {
+	template<> inline void ConfInstanceString::SetFromString(const string_t& v) {
 		m_Data = v;
+		TouchValue();
 	}
 
-	template<> void ConfInstanceInt::SetFromString(const string_t& v) {
+	template<> inline void ConfInstanceInt::SetFromString(const string_t& v) {
 		m_Data = std::stoi(v);
+		TouchValue();
 	}
 
-	template<> void ConfInstanceFloat::SetFromString(const string_t& v) {
+	template<> inline void ConfInstanceFloat::SetFromString(const string_t& v) {
 		m_Data = std::stof(v);
+		TouchValue();
 	}
 
-	template<> void ConfInstanceObject::SetFromString(const string_t& v) {
+	template<> inline void ConfInstanceObject::SetFromString(const string_t& v) {
 		//Peek instance addr by scope lookaround
 		assert(false && "WIP");
 	}
@@ -0,0 +1,99 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confintern.cpp
+ * \brief Shared instances related implementations
+ */
+
+#include "confintern.hpp"
+#include "confparser.hpp"
+#include "confscope.hpp"
+#include "confinstance.hpp"
+#include "conftype.hpp"
+
+namespace confparser {
+	namespace {
+		/*!
+		 * \brief Compare the raw values of two intrinsic instances of the same type
+		*/
+		template<typename _Ty> bool sameValue(ConfInstance* left, ConfInstance* right, bool& isIntrinsic) {
+			auto l = dynamic_cast<ConfIntrinsicInstance<_Ty>*>(left);
+			if (!l) return true;
+			isIntrinsic = true;
+			auto r = dynamic_cast<ConfIntrinsicInstance<_Ty>*>(right);
+			return r && l->Get() == r->Get();
+		}
+
+		/*!
+		 * \brief Check two subtrees structurally, equal hashes may collide
+		*/
+		bool isSame(ConfInstance* left, ConfInstance* right) {
+			if (left == right) return true;
+			if (left->GetNameView() != right->GetNameView() || left->GetType() != right->GetType()) return false;
+			bool isIntrinsic = false;
+			if (!sameValue<int>(left, right, isIntrinsic) || !sameValue<float>(left, right, isIntrinsic) ||
+				!sameValue<string_t>(left, right, isIntrinsic))
+				return false;
+			//Object references can't be compared
+			if (!isIntrinsic && dynamic_cast<ConfInstanceObject*>(left)) return false;
+
+			const auto& l = left->GetSubInstances();
+			const auto& r = right->GetSubInstances();
+			if (l.size() != r.size()) return false;
+			for (std::size_t i{ 0 }; i < l.size(); ++i)
+				if (!isSame(l[i], r[i])) return false;
+			return true;
+		}
+
+		void collect(ConfScope* scope, std::vector<ConfInstance*>& instances) {
+			for (auto it : scope->GetChilds()) {
+				if (it == ConfParser::GetIntrinsicScope()) continue;
+				if (it->GetCodeObjectType() == CodeObjectType::INSTANCE) instances.push_back(static_cast<ConfInstance*>(it));
+				else if (it->GetCodeObjectType() == CodeObjectType::SCOPE) collect(static_cast<ConfScope*>(it), instances);
+			}
+		}
+	}
+
+	std::size_t ConfInterner::Intern(ConfScope* root) {
+		const std::size_t shared = m_Shared;
+		std::vector<ConfInstance*> instances;
+		collect(root, instances);
+		for (auto it : instances) InternMembers(it);
+
+		//Deleting touches the trees, which would invalidate the hashes in use
+		for (auto it : m_Replaced) CP_SF(it);
+		m_Replaced.clear();
+		return m_Shared - shared;
+	}
+
+	void ConfInterner::InternMembers(ConfInstance* inst) {
+		auto& members = inst->m_SubInstances;
+		for (auto& member : members) {
+			//Already canonical, its members too
+			if (member->m_Shares) continue;
+			InternMembers(member);
+			ConfInstance* canonical = Find(member);
+			if (canonical == member) continue;
+
+			//Its members are shared by now, only its own memory is released
+			std::size_t size = member->GetSize();
+			for (auto it : member->m_SubInstances) size -= it->GetSize() / (it->m_Shares + 1);
+			m_SavedBytes += size;
+			++canonical->m_Shares;
+			m_Replaced.push_back(member);
+			member = canonical;
+			++m_Shared;
+		}
+	}
+
+	ConfInstance* ConfInterner::Find(ConfInstance* inst) {
+		auto& candidates = m_Instances[inst->GetHash()];
+		for (auto it : candidates)
+			if (isSame(it, inst)) return it;
+		candidates.push_back(inst);
+		return inst;
+	}
+}
\ No newline at end of file
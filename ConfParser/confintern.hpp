@@ -0,0 +1,83 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confintern.hpp
+ * \brief Shared instances related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief Deduplicate identical subinstances of parsed trees
+	 * 
+	 * Equal member subtrees (same names, types and values) are replaced by
+	 * one shared instance. The instances declared in scopes stay apart since
+	 * lookups return them to be written. A shared instance is copied when
+	 * written: by an assignation of the parser, through ConfScope::GetByPath,
+	 * ConfPath::ResolveForWrite or ConfInstance::Detach. Reading through the
+	 * '.' operator or ConfPath::Resolve keeps it shared, hosts writing members
+	 * must use one of the former. The canonical instances are kept
+	 * across calls, so several trees can share them, and must not be deleted
+	 * while the interner is used.
+	*/
+	class ConfInterner {
+		/*!
+		 * \brief Canonical instances by structural hash
+		*/
+		std::unordered_map<std::uint64_t, std::vector<ConfInstance*>> m_Instances;
+		std::size_t m_Shared = 0;
+
+		/*!
+		 * \brief Duplicates to delete at the end of the pass
+		*/
+		std::vector<ConfInstance*> m_Replaced;
+		std::size_t m_SavedBytes = 0;
+
+		/*!
+		 * \brief Intern the subinstances of an instance, deepest first
+		*/
+		void InternMembers(ConfInstance* inst);
+
+		/*!
+		 * \brief Get the canonical instance equal to inst, inst itself if new
+		*/
+		ConfInstance* Find(ConfInstance* inst);
+
+	public:
+		/*!
+		 * \brief Share the identical member subtrees of a tree
+		 * \param root The tree, its types are not walked
+		 * \return The number of subtrees replaced by a shared one
+		*/
+		std::size_t Intern(ConfScope* root);
+
+		/*!
+		 * \brief Get the number of subtrees replaced so far
+		*/
+		std::size_t GetSharedCount() const {
+			return m_Shared;
+		}
+
+		/*!
+		 * \brief Get the memory released by the replaced subtrees so far, in bytes
+		*/
+		std::size_t GetSavedBytes() const {
+			return m_SavedBytes;
+		}
+
+		/*!
+		 * \brief Forget the canonical instances, the trees stay shared
+		*/
+		void Clear() {
+			m_Instances.clear();
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confintrinsics.cpp
+ * \brief Intrinsic environment tables related implementations
+ */
+
+#include "confintrinsics.hpp"
+#include "confscope.hpp"
+#include "conftype.hpp"
+#include "confinstance.hpp"
+#include "confoperator.hpp"
+#include <cassert>
+
+namespace confparser {
+	namespace {
+		template<class T>
+		ConfTypeIntrinsic* createType() {
+			return new T();
+		}
+
+		ConfInstance* stringSet(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			ConfInstanceString* strThis = static_cast<ConfInstanceString*>(_this);
+			strThis->Set(static_cast<ConfInstanceString*>(parameters[0])->Get());
+			return _this;
+		}
+
+		ConfInstance* intSet(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			ConfInstanceInt* intThis = static_cast<ConfInstanceInt*>(_this);
+			intThis->Set(static_cast<ConfInstanceInt*>(parameters[0])->Get());
+			return _this;
+		}
+
+		ConfInstance* intAdd(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			ConfInstanceInt* intThis = static_cast<ConfInstanceInt*>(_this);
+			ConfInstanceInt* ret = static_cast<ConfInstanceInt*>(intThis->Clone(CP_TEXT("__RV")));
+			ret->Set(intThis->Get() + static_cast<ConfInstanceInt*>(parameters[0])->Get());
+			ret->SetTemp(true);
+			return ret;
+		}
+
+		ConfInstance* intMultiply(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			ConfInstanceInt* intThis = static_cast<ConfInstanceInt*>(_this);
+			ConfInstanceInt* ret = static_cast<ConfInstanceInt*>(intThis->Clone(CP_TEXT("__RV")));
+			ret->Set(intThis->Get() * static_cast<ConfInstanceInt*>(parameters[0])->Get());
+			ret->SetTemp(true);
+			return ret;
+		}
+
+		ConfInstance* intAddSet(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			ConfInstanceInt* intThis = static_cast<ConfInstanceInt*>(_this);
+			intThis->Set(intThis->Get() + static_cast<ConfInstanceInt*>(parameters[0])->Get());
+			return _this;
+		}
+
+		ConfInstance* floatSet(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			ConfInstanceFloat* floatThis = static_cast<ConfInstanceFloat*>(_this);
+			floatThis->Set(static_cast<ConfInstanceFloat*>(parameters[0])->Get());
+			return _this;
+		}
+
+		ConfInstance* objectMember(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			//Assigned members are detached by the parser before, reads share
+			for (auto it : _this->GetSubInstances())
+				if (it->GetName() == parameters[0]->GetName()) return it;
+			return nullptr;
+		}
+
+		ConfInstance* objectSet(ConfInstance* _this, std::vector<ConfInstance*> parameters) {
+			_this->ClearSubInstances();
+			for (auto c : parameters[0]->GetSubInstances())
+				_this->AddSubInstance(static_cast<ConfInstance*>(c->Clone(c->GetName())));
+			return _this;
+		}
+
+		constexpr ConfTypeDescriptor defaultTypes[] = {
+			{ NAME_TYPE_STRING, &createType<ConfTypeString> },
+			{ NAME_TYPE_INT, &createType<ConfTypeInt> },
+			{ NAME_TYPE_FLOAT, &createType<ConfTypeFloat> },
+			{ NAME_TYPE_OBJECT, &createType<ConfTypeObject> }
+		};
+
+		constexpr ConfOperatorDescriptor defaultOperators[] = {
+			{ NAME_TYPE_STRING, CP_TEXT("operator="), &stringSet, 14 },
+			{ NAME_TYPE_INT, CP_TEXT("operator+"), &intAdd, 4 },
+			{ NAME_TYPE_INT, CP_TEXT("operator*"), &intMultiply, 3 },
+			{ NAME_TYPE_INT, CP_TEXT("operator="), &intSet, 14 },
+			{ NAME_TYPE_INT, CP_TEXT("operator+="), &intAddSet, 14 },
+			{ NAME_TYPE_FLOAT, CP_TEXT("operator="), &floatSet, 14 },
+			{ NAME_TYPE_OBJECT, CP_TEXT("operator."), &objectMember, 1 },
+			{ NAME_TYPE_OBJECT, CP_TEXT("operator="), &objectSet, 14 }
+		};
+	}
+
+	constexpr ConfIntrinsicLayer DefaultIntrinsics{ defaultTypes, defaultOperators };
+
+	ConfScope* buildIntrinsicScope(const ConfIntrinsicLayer& layer) {
+		ConfScope* ret = new ConfScope();
+		//The first declaration of a name is found first, upper layers are declared first
+		for (auto it = &layer; it; it = it->Base) {
+			for (std::size_t i{ 0 }; i < it->TypesCount; ++i) {
+				const ConfTypeDescriptor& type = it->Types[i];
+				if (!ret->GetByName(type.Name, CodeObjectType::TYPE)) ret->AddChild(type.Create());
+			}
+		}
+		for (auto it = &layer; it; it = it->Base) {
+			for (std::size_t i{ 0 }; i < it->OperatorsCount; ++i) {
+				const ConfOperatorDescriptor& op = it->Operators[i];
+				ConfScope* type = static_cast<ConfScope*>(ret->GetByName(op.Type, CodeObjectType::TYPE));
+				if (!type) {
+					//Operator of a type declared by no layer
+					assert(false);
+					continue;
+				}
+				if (type->GetByName(op.Name, CodeObjectType::FUNCTION)) continue;
+				type->AddChild(new ConfFunctionIntrinsicOperator(type, op.Name, op.Function, op.Priority));
+			}
+		}
+		return ret;
+	}
+}
\ No newline at end of file
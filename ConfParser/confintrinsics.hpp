@@ -0,0 +1,80 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confintrinsics.hpp
+ * \brief Intrinsic environment tables related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief An intrinsic type, created by its factory
+	*/
+	struct ConfTypeDescriptor {
+		const char_t* Name;
+		ConfTypeIntrinsic* (*Create)();
+	};
+
+	/*!
+	 * \brief An intrinsic operator declared on an intrinsic type
+	 * \see ConfFunctionIntrinsicOperator
+	*/
+	struct ConfOperatorDescriptor {
+		const char_t* Type;
+		const char_t* Name;
+		ConfInstance* (*Function)(ConfInstance*, std::vector<ConfInstance*>);
+		std::size_t Priority;
+	};
+
+	/*!
+	 * \brief Constant tables of intrinsic types and operators, layered on a base
+	 * 
+	 * A layer declares new types, operators on the types of any layer, and
+	 * replaces the types and operators of its base with the same names. A
+	 * replaced type keeps the operators of the base it does not replace:
+	 * \code
+	 * constexpr ConfOperatorDescriptor HostOperators[] = {
+	 *	{ NAME_TYPE_INT, CP_TEXT("operator-"), &intSub, 4 }
+	 * };
+	 * constexpr ConfIntrinsicLayer HostIntrinsics{ HostOperators, &DefaultIntrinsics };
+	 * \endcode
+	 * \see ConfParser::SetIntrinsicLayer
+	*/
+	struct ConfIntrinsicLayer {
+		const ConfTypeDescriptor* Types;
+		std::size_t TypesCount;
+		const ConfOperatorDescriptor* Operators;
+		std::size_t OperatorsCount;
+		const ConfIntrinsicLayer* Base;
+
+		template<std::size_t TypesSize, std::size_t OperatorsSize>
+		constexpr ConfIntrinsicLayer(const ConfTypeDescriptor(&types)[TypesSize],
+			const ConfOperatorDescriptor(&operators)[OperatorsSize], const ConfIntrinsicLayer* base = nullptr) :
+			Types{ types }, TypesCount{ TypesSize }, Operators{ operators }, OperatorsCount{ OperatorsSize },
+			Base{ base } {}
+
+		template<std::size_t OperatorsSize>
+		constexpr ConfIntrinsicLayer(const ConfOperatorDescriptor(&operators)[OperatorsSize],
+			const ConfIntrinsicLayer* base = nullptr) :
+			Types{ nullptr }, TypesCount{ 0 }, Operators{ operators }, OperatorsCount{ OperatorsSize },
+			Base{ base } {}
+	};
+
+	/*!
+	 * \brief The language types: string, int, float and object
+	*/
+	extern const ConfIntrinsicLayer DefaultIntrinsics;
+
+	/*!
+	 * \brief Create the scope declaring the types and operators of a layer and
+	 *		  of its bases
+	 * \param layer The top layer
+	*/
+	ConfScope* buildIntrinsicScope(const ConfIntrinsicLayer& layer);
+}
\ No newline at end of file
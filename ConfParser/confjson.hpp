@@ -0,0 +1,39 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confjson.hpp
+ * \brief JSON output helpers shared by the exporters, internal
+ */
+
+#pragma once
+#include "global.hpp"
+#include <ostream>
+
+namespace confparser {
+	/*!
+	 * \brief Write a string as a quoted and escaped JSON string
+	*/
+	inline void writeJsonString(std::basic_ostream<char_t>& os, const string_t& str) {
+		static constexpr const char_t* HEX = CP_TEXT("0123456789abcdef");
+		os << CP_TEXT('"');
+		for (auto c : str) {
+			switch (c) {
+			case CP_TEXT('"'): os << CP_TEXT("\\\""); break;
+			case CP_TEXT('\\'): os << CP_TEXT("\\\\"); break;
+			case CP_TEXT('\n'): os << CP_TEXT("\\n"); break;
+			case CP_TEXT('\r'): os << CP_TEXT("\\r"); break;
+			case CP_TEXT('\t'): os << CP_TEXT("\\t"); break;
+			default:
+				//Other control characters are only valid escaped
+				if (static_cast<std::uint32_t>(c) < 0x20)
+					os << CP_TEXT("\\u00") << HEX[(c >> 4) & 0xF] << HEX[c & 0xF];
+				else os << c;
+				break;
+			}
+		}
+		os << CP_TEXT('"');
+	}
+}
@@ -0,0 +1,244 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confmacro.cpp
+ * \brief Macros related implementations
+ */
+
+#include "confmacro.hpp"
+#include "confparser.hpp"
+#include <algorithm>
+#include <cassert>
+#include <list>
+
+namespace confparser {
+	namespace {
+		bool isIdentifierChar(char_t ch) {
+			return cp_isalnum(ch) || ch == CP_TEXT('_');
+		}
+
+		bool isIdentifier(const string_t& token) {
+			return !token.empty() && isIdentifierChar(token[0]) &&
+				(token[0] < CP_TEXT('0') || token[0] > CP_TEXT('9'));
+		}
+
+		void skipSpaces(string_view_t& str) {
+			while (!str.empty() && cp_isspace(str.front())) str.remove_prefix(1);
+		}
+
+		string_view_t takeIdentifier(string_view_t& str) {
+			std::size_t size{ 0 };
+			while (size < str.size() && isIdentifierChar(str[size])) ++size;
+			auto ret = str.substr(0, size);
+			str.remove_prefix(size);
+			return ret;
+		}
+	}
+
+	bool ConfMacroTable::Define(string_view_t statement) {
+		const string_view_t directive = statement;
+		skipSpaces(statement);
+		if (statement.empty() || statement.front() != TOKEN_CHAR_SPECIAL) return false;
+		statement.remove_prefix(1);
+		skipSpaces(statement);
+		if (takeIdentifier(statement) != TOKEN_STRING_SPECIAL_DEFINE) return false;
+		skipSpaces(statement);
+		string_t name{ takeIdentifier(statement) };
+		if (name.empty()) return false;
+
+		Macro macro;
+		macro.Statement = directive;
+		std::vector<string_t> parameters;
+		//Only a parenthesis right after the name opens a parameters list
+		if (!statement.empty() && statement.front() == CP_TEXT('(')) {
+			macro.IsFunction = true;
+			statement.remove_prefix(1);
+			while (true) {
+				skipSpaces(statement);
+				if (!statement.empty() && statement.front() == CP_TEXT(')') && parameters.empty()) break;
+				string_t parameter{ takeIdentifier(statement) };
+				if (parameter.empty()) return false;
+				parameters.push_back(std::move(parameter));
+				skipSpaces(statement);
+				if (statement.empty()) return false;
+				if (statement.front() == CP_TEXT(')')) break;
+				if (statement.front() != CP_TEXT(',')) return false;
+				statement.remove_prefix(1);
+			}
+			statement.remove_prefix(1);
+			macro.Arity = parameters.size();
+		}
+
+		for (auto& token : operatorSplitter(string_t{ statement })) {
+			if (token.empty()) continue;
+			auto it = std::find(parameters.begin(), parameters.end(), token);
+			macro.Slots.push_back(it == parameters.end() ? -1 : static_cast<int>(it - parameters.begin()));
+			macro.Tokens.push_back(std::move(token));
+		}
+
+		macro.Hash = hashBytes(name.data(), name.size() * sizeof(char_t));
+		macro.Hash = hashBytes(&macro.Arity, sizeof(macro.Arity), macro.Hash);
+		macro.Hash = hashBytes(&macro.IsFunction, sizeof(macro.IsFunction), macro.Hash);
+		for (std::size_t i{ 0 }; i < macro.Tokens.size(); ++i) {
+			const std::size_t size = macro.Tokens[i].size();
+			macro.Hash = hashBytes(&size, sizeof(size), macro.Hash);
+			macro.Hash = hashBytes(macro.Tokens[i].data(), size * sizeof(char_t), macro.Hash);
+			macro.Hash = hashBytes(&macro.Slots[i], sizeof(int), macro.Hash);
+		}
+
+		//Cached expansions may use the previous definition
+		for (auto& it : m_Macros) {
+			it.second.IsCached = false;
+			it.second.Expansion.clear();
+			it.second.UsesMacros = -1;
+		}
+		Macro& slot = m_Macros[std::move(name)];
+		m_Hash ^= slot.Hash;
+		slot = std::move(macro);
+		m_Hash ^= slot.Hash;
+		return true;
+	}
+
+	std::vector<string_t> ConfMacroTable::GetDefinitions() const {
+		std::vector<string_t> ret;
+		ret.reserve(m_Macros.size());
+		for (const auto& it : m_Macros) ret.push_back(it.second.Statement);
+		return ret;
+	}
+
+	void ConfMacroTable::Expand(std::vector<string_t>& tokens) const {
+		if (m_Macros.empty()) return;
+		//Most expressions use no macro, keep them untouched
+		auto first = std::find_if(tokens.begin(), tokens.end(), [this](const string_t& token) {
+			return Find(token);
+		});
+		if (first == tokens.end()) return;
+
+		std::vector<string_t> ret;
+		ret.reserve(tokens.size() * 2);
+		ret.insert(ret.end(), std::make_move_iterator(tokens.begin()), std::make_move_iterator(first));
+		std::vector<const string_t*> active;
+		ExpandInto(ret, tokens, first - tokens.begin(), tokens.size(), active);
+		tokens = std::move(ret);
+	}
+
+	const std::pair<const string_t, ConfMacroTable::Macro>* ConfMacroTable::Find(const string_t& token) const {
+		if (!isIdentifier(token)) return nullptr;
+		auto it = m_Macros.find(token);
+		return it == m_Macros.end() ? nullptr : &*it;
+	}
+
+	bool ConfMacroTable::HasMacro(const string_t* begin, const string_t* end) const {
+		for (; begin != end; ++begin) if (Find(*begin)) return true;
+		return false;
+	}
+
+	void ConfMacroTable::ExpandInto(std::vector<string_t>& out, const std::vector<string_t>& tokens,
+		std::size_t begin, std::size_t end, std::vector<const string_t*>& active) const {
+		for (std::size_t i{ begin }; i < end; ++i) {
+			const string_t& token = tokens[i];
+			auto found = Find(token);
+			if (!found || std::find_if(active.begin(), active.end(),
+				[&token](const string_t* it) { return *it == token; }) != active.end()) {
+				out.push_back(token);
+				continue;
+			}
+			const Macro& macro = found->second;
+			if (macro.UsesMacros < 0)
+				macro.UsesMacros = HasMacro(macro.Tokens.data(), macro.Tokens.data() + macro.Tokens.size());
+
+			if (!macro.IsFunction) {
+				if (!macro.UsesMacros) {
+					out.insert(out.end(), macro.Tokens.begin(), macro.Tokens.end());
+					continue;
+				}
+				if (macro.IsCached && active.empty()) {
+					out.insert(out.end(), macro.Expansion.begin(), macro.Expansion.end());
+					continue;
+				}
+				const std::size_t size = out.size();
+				active.push_back(&found->first);
+				ExpandInto(out, macro.Tokens, 0, macro.Tokens.size(), active);
+				active.pop_back();
+				//Expansions made while other macros are suppressed are partial
+				if (active.empty()) {
+					macro.Expansion.assign(out.begin() + size, out.end());
+					macro.IsCached = true;
+				}
+				continue;
+			}
+
+			//A function-like macro name without arguments is a plain token
+			std::size_t open{ i + 1 };
+			while (open < end && tokens[open].empty()) ++open;
+			if (open >= end || tokens[open] != CP_TEXT("(")) {
+				out.push_back(token);
+				continue;
+			}
+
+			//Arguments as spans of tokens, pointing into expanded when they use macros
+			std::vector<std::pair<const string_t*, const string_t*>> arguments;
+			std::list<std::vector<string_t>> expanded;
+			auto addArgument = [&](std::size_t from, std::size_t to) {
+				const string_t* first = tokens.data() + from, * last = tokens.data() + to;
+				if (HasMacro(first, last)) {
+					auto& storage = expanded.emplace_back();
+					ExpandInto(storage, tokens, from, to, active);
+					arguments.emplace_back(storage.data(), storage.data() + storage.size());
+				}
+				else arguments.emplace_back(first, last);
+			};
+
+			std::size_t close{ open + 1 }, argument{ open + 1 };
+			int depth{ 0 };
+			bool hasTokens{ false };
+			for (; close < end; ++close) {
+				const string_t& it = tokens[close];
+				if (it == CP_TEXT("(")) ++depth;
+				else if (it == CP_TEXT(")")) {
+					if (!depth) break;
+					--depth;
+				}
+				else if (!depth && it == CP_TEXT(",")) {
+					addArgument(argument, close);
+					argument = close + 1;
+					continue;
+				}
+				hasTokens |= !it.empty();
+			}
+			if (close >= end) {
+				//Unterminated arguments list
+				assert(false);
+				out.push_back(token);
+				continue;
+			}
+			if (hasTokens || !arguments.empty()) addArgument(argument, close);
+			if (arguments.size() != macro.Arity) {
+				//Wrong arguments count
+				assert(false);
+				out.push_back(token);
+				continue;
+			}
+
+			auto substitute = [&](std::vector<string_t>& into) {
+				for (std::size_t t{ 0 }; t < macro.Tokens.size(); ++t) {
+					if (macro.Slots[t] < 0) into.push_back(macro.Tokens[t]);
+					else into.insert(into.end(), arguments[macro.Slots[t]].first, arguments[macro.Slots[t]].second);
+				}
+			};
+			if (!macro.UsesMacros) substitute(out);
+			else {
+				std::vector<string_t> body;
+				body.reserve(macro.Tokens.size());
+				substitute(body);
+				active.push_back(&found->first);
+				ExpandInto(out, body, 0, body.size(), active);
+				active.pop_back();
+			}
+			i = close;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confmacro.hpp
+ * \brief Macros related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief The macros defined by %define directives
+	 * 
+	 * A body is lexed once, when defined, with its parameters replaced by
+	 * slots. Expanding splices token spans into the expression tokens, no text
+	 * is scanned again. Arguments are expanded before being substituted, a
+	 * macro is not expanded again inside its own expansion. Expansions of
+	 * parameterless macros are cached until the next definition.
+	 * 
+	 * \code
+	 * %define WIDTH 80
+	 * %define AREA(w, h) (w * h)
+	 * int a = AREA(WIDTH, 25)
+	 * \endcode
+	*/
+	class ConfMacroTable {
+	public:
+		/*!
+		 * \brief Define or redefine a macro
+		 * \param statement The whole directive, "%define NAME body" or
+		 *		  "%define NAME(a, b) body"
+		 * \return If the directive was well formed
+		*/
+		bool Define(string_view_t statement);
+
+		bool IsDefined(const string_t& name) const {
+			return m_Macros.find(name) != m_Macros.end();
+		}
+
+		bool IsEmpty() const {
+			return m_Macros.empty();
+		}
+
+		std::size_t GetCount() const {
+			return m_Macros.size();
+		}
+
+		void Clear() {
+			m_Macros.clear();
+			m_Hash = 0;
+		}
+
+		/*!
+		 * \brief Get a hash of the defined macros, independent of their
+		 *		  definition order, 0 when none is defined
+		*/
+		std::uint64_t GetHash() const {
+			return m_Hash;
+		}
+
+		/*!
+		 * \brief Get the directives defining the current macros, replaying them
+		 *		  into an empty table restores this one
+		*/
+		std::vector<string_t> GetDefinitions() const;
+
+		/*!
+		 * \brief Expand the macros of an expression in place
+		 * \param tokens The expression as split by operatorSplitter
+		*/
+		void Expand(std::vector<string_t>& tokens) const;
+
+	private:
+		struct Macro {
+			/*!
+			 * \brief The directive defining the macro
+			*/
+			string_t Statement;
+			std::vector<string_t> Tokens;
+
+			/*!
+			 * \brief Parameter index of each token, -1 for plain tokens
+			*/
+			std::vector<int> Slots;
+			std::size_t Arity = 0;
+			bool IsFunction = false;
+
+			/*!
+			 * \brief Hash of the name and the definition
+			*/
+			std::uint64_t Hash = 0;
+
+			mutable std::vector<string_t> Expansion;
+			mutable bool IsCached = false;
+
+			/*!
+			 * \brief If the body uses other macros: -1 unknown, 0 no, 1 yes
+			*/
+			mutable int UsesMacros = -1;
+		};
+
+		/*!
+		 * \brief Get the macro named by a token, nullptr if none
+		*/
+		const std::pair<const string_t, Macro>* Find(const string_t& token) const;
+
+		bool HasMacro(const string_t* begin, const string_t* end) const;
+
+		/*!
+		 * \brief Append the expansion of tokens [begin, end) to out
+		 * \param active The macros being expanded, not expanded again
+		*/
+		void ExpandInto(std::vector<string_t>& out, const std::vector<string_t>& tokens,
+			std::size_t begin, std::size_t end, std::vector<const string_t*>& active) const;
+
+		std::unordered_map<string_t, Macro> m_Macros;
+
+		/*!
+		 * \brief Xor of the hashes of the macros
+		*/
+		std::uint64_t m_Hash = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confmemory.cpp
+ * \brief Memory accounting related implementations
+ */
+
+#include "confmemory.hpp"
+#include "confparser.hpp"
+#include "confscope.hpp"
+#include "confinstance.hpp"
+
+namespace confparser {
+	namespace {
+		constexpr const char_t* KIND_NAMES[ConfMemoryTracker::KINDS_COUNT] = {
+			CP_TEXT("type"), CP_TEXT("instance"), CP_TEXT("rvalue"),
+			CP_TEXT("function"), CP_TEXT("scope"), CP_TEXT("other")
+		};
+
+		constexpr const char_t* PHASE_NAMES[ConfMemoryTracker::PHASES_COUNT] = {
+			CP_TEXT("read"), CP_TEXT("split"), CP_TEXT("tokenize"), CP_TEXT("resolve"),
+			CP_TEXT("evaluate"), CP_TEXT("include"), CP_TEXT("none")
+		};
+
+		void dumpCounters(std::basic_ostream<char_t>& os, const char_t* name,
+			const ConfMemoryTracker::Counters& counters) {
+			os << CP_TEXT("  ") << name << CP_TEXT(": ") << counters.Allocations
+				<< CP_TEXT(" allocations, ") << counters.Bytes << CP_TEXT(" bytes, ")
+				<< counters.LiveObjects << CP_TEXT(" live, ") << counters.LiveBytes
+				<< CP_TEXT(" live bytes\n");
+		}
+
+		void dumpTree(std::basic_ostream<char_t>& os, ConfScopeable* object,
+			std::size_t depth, std::size_t maxDepth) {
+			os << string_t(depth * 2, CP_TEXT(' ')) << object->GetNameView() << CP_TEXT(" (")
+				<< KIND_NAMES[static_cast<std::size_t>(object->GetCodeObjectType())]
+				<< CP_TEXT("): ") << object->GetSize() << CP_TEXT(" bytes\n");
+			if (depth >= maxDepth) return;
+			if (auto scope = dynamic_cast<ConfScope*>(object)) {
+				for (auto it : scope->GetChilds()) {
+					if (it != ConfParser::GetIntrinsicScope()) dumpTree(os, it, depth + 1, maxDepth);
+				}
+			}
+			else if (auto inst = dynamic_cast<ConfInstance*>(object)) {
+				for (auto it : inst->GetSubInstances()) dumpTree(os, it, depth + 1, maxDepth);
+			}
+		}
+	}
+
+	thread_local std::uint64_t ConfMemoryTracker::ThreadBytes = 0;
+	std::atomic<std::uint32_t> ConfMemoryTracker::ThreadBytesUsers{ 0 };
+
+	ConfMemoryTracker::Counters ConfMemoryTracker::AtomicCounters::Load() const {
+		Counters ret;
+		ret.Allocations = Allocations.load(std::memory_order_relaxed);
+		ret.Bytes = Bytes.load(std::memory_order_relaxed);
+		ret.LiveObjects = LiveObjects.load(std::memory_order_relaxed);
+		ret.LiveBytes = LiveBytes.load(std::memory_order_relaxed);
+		return ret;
+	}
+
+	void ConfMemoryTracker::Reset() {
+		for (auto& it : m_Kinds) {
+			it.Allocations.store(0, std::memory_order_relaxed);
+			it.Bytes.store(0, std::memory_order_relaxed);
+		}
+		for (auto& it : m_Phases) {
+			it.Allocations.store(0, std::memory_order_relaxed);
+			it.Bytes.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void ConfMemoryTracker::Dump(std::basic_ostream<char_t>& os) const {
+		os << CP_TEXT("By kind:\n");
+		for (std::size_t i{ 0 }; i < KINDS_COUNT; ++i) dumpCounters(os, KIND_NAMES[i], m_Kinds[i].Load());
+		os << CP_TEXT("By phase:\n");
+		for (std::size_t i{ 0 }; i < PHASES_COUNT; ++i) {
+			//Objects may die in another phase than the one they were born in, no live counters
+			auto counters = m_Phases[i].Load();
+			os << CP_TEXT("  ") << PHASE_NAMES[i] << CP_TEXT(": ") << counters.Allocations
+				<< CP_TEXT(" allocations, ") << counters.Bytes << CP_TEXT(" bytes\n");
+		}
+	}
+
+	void ConfMemoryTracker::DumpTree(std::basic_ostream<char_t>& os, ConfScopeable* object,
+		std::size_t maxDepth) {
+		if (object) dumpTree(os, object, 0, maxDepth);
+	}
+
+	void ConfMemoryTracker::OnAllocate(std::size_t size) {
+		auto& phase = m_Phases[static_cast<std::size_t>(ConfPhaseTimer::GetCurrentPhase())];
+		phase.Allocations.fetch_add(1, std::memory_order_relaxed);
+		phase.Bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void ConfMemoryTracker::OnCreate(CodeObjectType kind, std::size_t size) {
+		auto& counters = m_Kinds[static_cast<std::size_t>(kind)];
+		counters.Allocations.fetch_add(1, std::memory_order_relaxed);
+		counters.Bytes.fetch_add(size, std::memory_order_relaxed);
+		counters.LiveObjects.fetch_add(1, std::memory_order_relaxed);
+		counters.LiveBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void ConfMemoryTracker::OnReclassify(CodeObjectType from, CodeObjectType to, std::size_t size) {
+		OnDestroy(from, size);
+		auto& counters = m_Kinds[static_cast<std::size_t>(to)];
+		counters.LiveObjects.fetch_add(1, std::memory_order_relaxed);
+		counters.LiveBytes.fetch_add(size, std::memory_order_relaxed);
+		//Base constructors pass the allocation on, becoming temporary does not
+		if (from != CodeObjectType::RVALUE && to != CodeObjectType::RVALUE) {
+			auto& previous = m_Kinds[static_cast<std::size_t>(from)];
+			previous.Allocations.fetch_sub(1, std::memory_order_relaxed);
+			previous.Bytes.fetch_sub(size, std::memory_order_relaxed);
+			counters.Allocations.fetch_add(1, std::memory_order_relaxed);
+			counters.Bytes.fetch_add(size, std::memory_order_relaxed);
+		}
+	}
+
+	void ConfMemoryTracker::OnDestroy(CodeObjectType kind, std::size_t size) {
+		auto& counters = m_Kinds[static_cast<std::size_t>(kind)];
+		counters.LiveObjects.fetch_sub(1, std::memory_order_relaxed);
+		counters.LiveBytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+}
\ No newline at end of file
@@ -5,12 +5,16 @@
 */
 /*!
  * \file confmemory.hpp
- * \brief Unused possible future memory management implementation
+ * \brief Memory accounting and unused possible future memory management implementation
  */
 
 #pragma once
 #include <unordered_map>
+#include <array>
+#include <atomic>
+#include <ostream>
 #include "global.hpp"
+#include "confstats.hpp"
 
 namespace confparser {
 	class ConfMemoryHandle {
@@ -63,4 +67,143 @@ namespace confparser {
 			return m_CurrentIdentifier;
 		}
 	};
+
+	/*!
+	 * \brief Process wide accounting of the scopeable objects allocations
+	 * 
+	 * Allocations are counted by the kind objects are constructed as and by
+	 * the parse phase running on the allocating thread, live objects by their
+	 * current kind so temporaries show as rvalues. Objects created while
+	 * disabled are never counted. Thread safe.
+	 * 
+	 * \see ConfScopeable::GetSize
+	*/
+	class ConfMemoryTracker {
+	public:
+		static constexpr std::size_t KINDS_COUNT = static_cast<std::size_t>(CodeObjectType::NONE) + 1;
+
+		/*!
+		 * \brief Phases plus one slot for allocations out of any parse
+		*/
+		static constexpr std::size_t PHASES_COUNT = CONF_PARSE_PHASES_COUNT + 1;
+
+		struct Counters {
+			std::uint64_t Allocations = 0;
+			std::uint64_t Bytes = 0;
+			std::int64_t LiveObjects = 0;
+			std::int64_t LiveBytes = 0;
+		};
+
+	private:
+		struct AtomicCounters {
+			std::atomic<std::uint64_t> Allocations{ 0 };
+			std::atomic<std::uint64_t> Bytes{ 0 };
+			std::atomic<std::int64_t> LiveObjects{ 0 };
+			std::atomic<std::int64_t> LiveBytes{ 0 };
+
+			Counters Load() const;
+		};
+
+		static thread_local std::uint64_t ThreadBytes;
+
+		/*!
+		 * \brief Number of attached line profilers, ThreadBytes is counted
+		 *		  while there is any
+		*/
+		static std::atomic<std::uint32_t> ThreadBytesUsers;
+
+		std::atomic<bool> m_IsEnabled;
+		std::array<AtomicCounters, KINDS_COUNT> m_Kinds;
+		std::array<AtomicCounters, PHASES_COUNT> m_Phases;
+
+		ConfMemoryTracker() : m_IsEnabled{ false } {}
+
+	public:
+		static ConfMemoryTracker& Instance() {
+			static ConfMemoryTracker instance;
+			return instance;
+		}
+
+		void SetEnabled(bool enabled) {
+			m_IsEnabled.store(enabled, std::memory_order_relaxed);
+			//Allocations are counted by phase
+			ConfPhaseTimer::IsTracking.store(enabled, std::memory_order_relaxed);
+		}
+
+		bool IsEnabled() const {
+			return m_IsEnabled.load(std::memory_order_relaxed);
+		}
+
+		/*!
+		 * \brief Get the bytes of scopeable objects allocated by the calling
+		 *		  thread while counted, even when disabled
+		 * \see CountThreadBytes
+		*/
+		static std::uint64_t GetThreadBytes() {
+			return ThreadBytes;
+		}
+
+		/*!
+		 * \brief Start or stop a use of GetThreadBytes, allocations are counted
+		 *		  while there is any use
+		 * \see ConfParser::SetLineProfiler
+		*/
+		static void CountThreadBytes(bool counted) {
+			if (counted) ThreadBytesUsers.fetch_add(1, std::memory_order_relaxed);
+			else ThreadBytesUsers.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		static bool IsCountingThreadBytes() {
+			return ThreadBytesUsers.load(std::memory_order_relaxed) != 0;
+		}
+
+		Counters GetKind(CodeObjectType kind) const {
+			return m_Kinds[static_cast<std::size_t>(kind)].Load();
+		}
+
+		/*!
+		 * \brief Get the allocations made during a phase, ConfParsePhase::COUNT
+		 *		  for the ones out of any parse
+		*/
+		Counters GetPhase(ConfParsePhase phase) const {
+			return m_Phases[static_cast<std::size_t>(phase)].Load();
+		}
+
+		/*!
+		 * \brief Reset the allocations counters, live counters are kept
+		*/
+		void Reset();
+
+		/*!
+		 * \brief Print the counters by kind and by phase
+		*/
+		void Dump(std::basic_ostream<char_t>& os) const;
+
+		/*!
+		 * \brief Print the footprint of a tree, one line per object
+		 * \param object The tree root
+		 * \param maxDepth Deeper objects are summed in their parent only
+		*/
+		static void DumpTree(std::basic_ostream<char_t>& os, ConfScopeable* object,
+			std::size_t maxDepth = static_cast<std::size_t>(-1));
+
+		/*!
+		 * \brief Count an allocation of the running phase
+		*/
+		void OnAllocate(std::size_t size);
+
+		/*!
+		 * \brief Count an object as alive and allocated for kind
+		*/
+		void OnCreate(CodeObjectType kind, std::size_t size);
+
+		/*!
+		 * \brief Move an object from a kind to another
+		*/
+		void OnReclassify(CodeObjectType from, CodeObjectType to, std::size_t size);
+
+		void OnDestroy(CodeObjectType kind, std::size_t size);
+
+		friend class ConfScopeable;
+	};
 }
\ No newline at end of file
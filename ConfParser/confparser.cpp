@@ -15,17 +15,35 @@
 #include "confoperator.hpp"
 #include "confscopeable.hpp"
 #include "confinstance.hpp"
+#include "confimage.hpp"
+#include "confinitializer.hpp"
+#include "confvaluegraph.hpp"
+#include "confpath.hpp"
 #include <fstream>
 #include <sstream>
 #include <cwctype>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace confparser {
 	std::unordered_map<string_t, ApplySpecialFunction_t> ConfParser::SpecialTokensMap;
 	std::unordered_map<string_t, ApplyKeywordFunction_t> ConfParser::KeywordsMap;
 	ConfScope* ConfParser::IntrinsicScope = nullptr;
+	const ConfIntrinsicLayer* ConfParser::IntrinsicLayer = &DefaultIntrinsics;
 	ConfScope* ConfParser::GlobalScope = nullptr;
 
+	std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t hash) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i{ 0 }; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
 	void removeCariageReturn(string_t& str) {
 		for (string_t::iterator it{ str.begin() }; it != str.end(); ++it) {
 			if (*it == CP_TEXT('\r')) {
@@ -167,10 +185,10 @@ namespace confparser {
 		}break;
 			//TODO [F:implement on others parsers !]
 		case ConfOperatorType::POST:
-			__fallthrough;
+			[[fallthrough]];
 			//TODO [F:implement on others parsers !]
 		case ConfOperatorType::PRE:
-			__fallthrough;
+			[[fallthrough]];
 			//TODO [F:implement on others parsers !]
 		case ConfOperatorType::SUR: break;
 		}
@@ -188,7 +206,7 @@ namespace confparser {
 	* This function calls threatOp to apply operators operations
 	*/
 	ConfInstance* operatorParser(ConfScope* scope,
-		std::unordered_map<int, std::vector<std::vector<string_t>>>& parenthetized, int depth = 0, int offset = 0) {
+		std::unordered_map<int, std::vector<std::vector<string_t>>>& parenthetized, int depth, int offset) {
 		std::vector< ConfScopeable*> currentLine = { };
 		for (auto& token : parenthetized[depth][offset]) {
 			if (token.empty()) continue;
@@ -276,32 +294,77 @@ namespace confparser {
 		return parenthetized;
 	}
 
+	/*!
+	 * \brief Get the path a statement assigns: its leading dotted name when an
+	 *		  assignation operator follows it, empty otherwise
+	 * \param tokens The statement tokens, as given by operatorSplitter
+	 */
+	string_t assignedPath(const std::vector<string_t>& tokens) {
+		string_t ret;
+		bool isName = true;
+		for (const auto& token : tokens) {
+			if (token.empty()) continue;
+			if (isName) {
+				if (!cp_isalnum(token[0]) && token[0] != CP_TEXT('_')) return {};
+				ret += token;
+			}
+			else if (token == CP_TEXT(".")) ret += token;
+			else if (token.back() == CP_TEXT('=') && token != CP_TEXT("==") && token != CP_TEXT("!=") &&
+				token != CP_TEXT("<=") && token != CP_TEXT(">=")) return ret;
+			else return {};
+			isName = !isName;
+		}
+		return {};
+	}
+
 	void ConfParser::Initialize() {
+		//The handlers are stateless, every parser shares them
+		static std::once_flag registered;
+		std::call_once(registered, Register);
+		m_IsInitialized = true;
+	}
+
+	void ConfParser::Register() {
 		SpecialTokensMap[TOKEN_STRING_SPECIAL_DEFINE] = [](ConfParser* _this, ConfScope* scope,
-			const std::vector<string_t>& tokens, StringFormater_t formater) {
-				//TODO
+			const std::vector<string_t>& tokens, const string_t& statement, StringFormater_t formater) {
+				if (!_this->m_Macros.Define(statement)) {
+					//Malformed macro
+					assert(false);
+					return;
+				}
+				//Replayed when the unit is served from the cache
+				if (!_this->m_Building.empty()) _this->m_Building.back().Defines.push_back(statement);
 		};
 		SpecialTokensMap[TOKEN_STRING_SPECIAL_USE] = [](ConfParser* _this, ConfScope* scope,
-			const std::vector<string_t>& tokens, StringFormater_t formater) {
+			const std::vector<string_t>& tokens, const string_t& statement, StringFormater_t formater) {
 				//TODO
-				SpecialTokensMap[TOKEN_STRING_SPECIAL_DEFAULT](_this, scope, tokens, formater);
+				SpecialTokensMap.at(TOKEN_STRING_SPECIAL_DEFAULT)(_this, scope, tokens, statement, formater);
 		};
 		SpecialTokensMap[TOKEN_STRING_SPECIAL_DEFAULT] = [](ConfParser* _this, ConfScope* scope,
-			const std::vector<string_t>& tokens, StringFormater_t formater) {
-				auto oscope = _this->Parse(unStringify(tokens[2]));
+			const std::vector<string_t>& tokens, const string_t& statement, StringFormater_t formater) {
+				_this->Include(scope, unStringify(tokens[2]), formater);
 		};
 		SpecialTokensMap[TOKEN_STRING_SPECIAL_TYPE] = [](ConfParser* _this, ConfScope* scope,
-			const std::vector<string_t>& tokens, StringFormater_t formater) {
+			const std::vector<string_t>& tokens, const string_t& statement, StringFormater_t formater) {
 		};
 		SpecialTokensMap[TOKEN_STRING_PREFIX_FUNCTION] = [](ConfParser* _this, ConfScope* scope,
-			const std::vector<string_t>& tokens, StringFormater_t formater) {
+			const std::vector<string_t>& tokens, const string_t& statement, StringFormater_t formater) {
 
 		};
+		//Conditional blocks span lines, parse tasks handle them before statements
+		for (auto it : { TOKEN_STRING_SPECIAL_IF, TOKEN_STRING_SPECIAL_IFDEF, TOKEN_STRING_SPECIAL_IFNDEF,
+			TOKEN_STRING_SPECIAL_ELIF, TOKEN_STRING_SPECIAL_ELSE, TOKEN_STRING_SPECIAL_ENDIF }) {
+			SpecialTokensMap[it] = [](ConfParser* _this, ConfScope* scope,
+				const std::vector<string_t>& tokens, const string_t& statement, StringFormater_t formater) {
+					//Conditional directive out of a parse task
+					assert(false);
+			};
+		}
 
 		KeywordsMap[TOKENS_STRING_KEYWORD_CLASS] = [](ConfParser* _this, ConfScope** currentScope,
 			const std::vector<string_t>& tokens) {
 				ConfType* ty = new ConfType(tokens[1], *currentScope);
-				*ty += *(ConfTypeIntrinsic::GetTypesRegistry().at(NAME_TYPE_OBJECT));
+				*ty += *ConfTypeIntrinsic::GetIntrinsicType(NAME_TYPE_OBJECT);
 				(*currentScope)->AddChild(ty);
 				*currentScope = ty;
 		};
@@ -313,162 +376,449 @@ namespace confparser {
 	}
 
 	ConfParser::~ConfParser() {
-		if (IntrinsicScope) CP_SF(IntrinsicScope);
+		SetLineProfiler(nullptr);
+		m_Units.clear();
+		if (!m_OwnsEnvironment) return;
+		//Cached units outlive their parsers and reference the intrinsic types
+		if (IntrinsicScope && !ConfUnitCache::Instance().GetCount()) CP_SF(IntrinsicScope);
 	}
 
 	ConfScope* ConfParser::Parse(std::filesystem::path file, StringFormater_t format) {
+		return ParseInto(std::move(file), GetGlobalScope(), format);
+	}
+
+	ConfScope* ConfParser::ParseInto(std::filesystem::path file, ConfScope* root, StringFormater_t format) {
+		//Includes are part of the including file image
+		std::filesystem::path image;
+		const std::uint64_t macros = m_Macros.GetHash();
+		if (m_UseImageCache && !m_ActiveTask && !m_SourceReader) {
+			image = file;
+			image += CONF_IMAGE_EXTENSION;
+			ConfPhaseTimer timer{ m_Stats, ConfParsePhase::READ };
+			ConfTraceSpan span{ m_Trace, CP_TEXT("image"), ConfTrace::Category::PHASE,
+				m_Trace ? image.string<char_t>() : string_t{} };
+			ConfImage compiled;
+			if (compiled.Open(image) && compiled.IsUpToDate(macros)) {
+				if (!m_IsInitialized) Initialize();
+				compiled.Materialize(root);
+				//The image macros include the ones defined before the parse
+				m_Macros.Clear();
+				for (const auto& it : compiled.GetDefines()) m_Macros.Define(it);
+				if (m_Stats) m_Stats->Tree(root);
+				return root;
+			}
+		}
+		//An image holds the whole root, declarations of previous parses must not be part of it
+		const bool isFresh = root->GetChilds().empty() && !root->GetTypeStubsCount() && !root->GetInitializersCount();
+
+		ConfParseTask task{ this, file, root, format };
+		while (!task.Step());
+		if (m_Stats) m_Stats->Tree(root);
+
+		if (!image.empty() && isFresh) {
+			//Images hold built trees only
+			root->MaterializeTypes();
+			root->EvaluateInitializers();
+			ConfImage::Write(image, root, GetIncludeClosure(file), macros, m_Macros.GetDefinitions());
+		}
+		return root;
+	}
+
+	std::vector<ConfScope*> ConfParser::ParseBatch(const std::vector<std::filesystem::path>& files,
+		std::size_t threads) {
+		return ParseBatch(files.size(), threads, [&files](ConfParser& worker, std::size_t i, ConfScope* root) {
+			worker.ParseInto(files[i], root);
+		});
+	}
+
+	std::vector<ConfScope*> ConfParser::ParseBatch(const std::vector<string_view_t>& sources,
+		std::size_t threads) {
+		return ParseBatch(sources.size(), threads, [&sources](ConfParser& worker, std::size_t i, ConfScope* root) {
+			worker.ParseText(sources[i], root);
+		});
+	}
+
+	std::vector<ConfScope*> ConfParser::ParseBatch(std::size_t count, std::size_t threads,
+		const std::function<void(ConfParser&, std::size_t, ConfScope*)>& parse) {
 		if (!m_IsInitialized) Initialize();
-		ConfScope* ret = GetGlobalScope();
-		
-		ConfScope* currentScope = ret;
+		//Created once here, read only by the workers
+		ConfScope* intrinsic = GetIntrinsicScope();
+		std::vector<ConfScope*> ret(count, nullptr);
+		if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+		threads = std::max<std::size_t>(1, std::min(threads, count));
+
+		std::atomic<std::size_t> next{ 0 };
+		std::mutex mutex;
+		auto work = [&]() {
+			for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+				//One parser per file: macros and include state are per tenant
+				ConfParser worker;
+				worker.m_OwnsEnvironment = false;
+				worker.m_IsInitialized = true;
+				worker.m_IncludeHandler = m_IncludeHandler;
+				worker.m_SourceReader = m_SourceReader;
+				worker.m_UseImageCache = m_UseImageCache;
+				worker.m_UseIncludeCache = m_UseIncludeCache;
+				worker.m_UseLazyTypes = m_UseLazyTypes;
+				worker.m_UseLazyInitializers = m_UseLazyInitializers;
+				worker.m_Trace = m_Trace;
+				worker.m_Macros = m_Macros;
+
+				ConfScope* root = new ConfScope(intrinsic);
+				parse(worker, i, root);
+				//Lazy types and initializers reference the worker
+				root->MaterializeTypes();
+				root->EvaluateInitializers();
+				ret[i] = root;
+
+				//The trees reference the types of the units they merged
+				std::lock_guard<std::mutex> lock{ mutex };
+				m_Units.insert(m_Units.end(), worker.m_Units.begin(), worker.m_Units.end());
+				for (auto& it : worker.m_Dependencies) m_Dependencies[it.first] = std::move(it.second);
+				m_InitializerCycles.insert(m_InitializerCycles.end(), worker.m_InitializerCycles.begin(),
+					worker.m_InitializerCycles.end());
+				m_ConditionErrors.insert(m_ConditionErrors.end(), worker.m_ConditionErrors.begin(),
+					worker.m_ConditionErrors.end());
+			}
+		};
 
-		ifstream_t ifs{ file };
-		osstream_t sstream;
-		sstream << ifs.rdbuf();
-		string_t rawText{ sstream.str() };
-		ifs.close();
-
-		removeCariageReturn(rawText);
-		auto stext = filtersplit(std::move(rawText), { '\n',false });
-
-		for (auto& it : stext) {
-			trim(it);
-			if (it.empty()) continue;
-			string_t text = format ? format(it) : std::move(it); //Is this really cost-free ?
-			std::vector<string_t> tokenizedText = filtersplit(text,
-				{ " =#%+-*/.", {false}, true}, true, true);
-			switch (text[0]) {
-			case TOKEN_CHAR_COMMENT: break;
-			case TOKEN_CHAR_SPECIAL: {
-				SpecialTokensMap[tokenizedText[1]](this, currentScope, tokenizedText, format);
-			}break;
-				//TODO
-			case TOKEN_CHAR_SCOPE_BEGIN: break;
-			case TOKEN_CHAR_SCOPE_END: 
-				currentScope = currentScope->GetParent();
+		if (threads == 1) work();
+		else {
+			std::vector<std::thread> pool;
+			for (std::size_t i{ 0 }; i < threads; ++i) pool.emplace_back(work);
+			ConfTraceSpan wait{ m_Trace, CP_TEXT("batch"), ConfTrace::Category::WAIT };
+			for (auto& it : pool) it.join();
+		}
+		return ret;
+	}
+
+	ConfScope* ConfParser::ParseText(string_view_t text, ConfScope* root, std::filesystem::path name) {
+		if (!root) root = GetGlobalScope();
+		ConfParseTask task{ this, std::move(name), string_t{ text }, root };
+		while (!task.Step());
+		if (m_Stats) m_Stats->Tree(root);
+		return root;
+	}
+
+	ConfParseTask ConfParser::ParseAsync(std::filesystem::path file, ConfScope* root, StringFormater_t format) {
+		return { this, std::move(file), root ? root : GetGlobalScope(), format };
+	}
+
+	void ConfParser::ParseLine(ConfScope** currentScope, string_t line, StringFormater_t format) {
+		if (!m_IsInitialized) Initialize();
+		ConfPhaseTimer timer{ m_Stats, ConfParsePhase::RESOLVE };
+		string_t text = format ? format(line) : std::move(line); //Is this really cost-free ?
+		std::vector<string_t> tokenizedText;
+		{
+			ConfPhaseTimer tokenize{ m_Stats, ConfParsePhase::TOKENIZE };
+			tokenizedText = filtersplit(text, { " =#%+-*/.", {false}, true}, true, true);
+		}
+		if (m_Stats) m_Stats->Count(0, tokenizedText.size(), 1, 0);
+		switch (text[0]) {
+		case TOKEN_CHAR_COMMENT: break;
+		case TOKEN_CHAR_SPECIAL: {
+			//Read only, parsers of other threads share it
+			auto handler = SpecialTokensMap.find(tokenizedText[1]);
+			if (handler == SpecialTokensMap.end()) {
+				//Unknown directive
+				assert(false);
 				break;
-			default: {
-				if (KeywordsMap.find(tokenizedText[0]) != KeywordsMap.end()) {
-					KeywordsMap[tokenizedText[0]](this, &currentScope, tokenizedText);
-					continue;
-				}
+			}
+			handler->second(this, *currentScope, tokenizedText, text, format);
+		}break;
+			//TODO
+		case TOKEN_CHAR_SCOPE_BEGIN: break;
+		case TOKEN_CHAR_SCOPE_END: 
+			*currentScope = (*currentScope)->GetParent();
+			break;
+		default: {
+			if (auto keyword = KeywordsMap.find(tokenizedText[0]); keyword != KeywordsMap.end()) {
+				keyword->second(this, currentScope, tokenizedText);
+				break;
+			}
 
-				ConfScopeable* firstToken = currentScope->GetByName(tokenizedText[0]);
-				if (!firstToken) {
-					//Unresolved symbol
-					assert(false);
-				}
+			ConfScopeable* firstToken = (*currentScope)->GetByName(tokenizedText[0]);
+			if (!firstToken && !m_Macros.IsDefined(tokenizedText[0])) {
+				//Unresolved symbol
+				assert(false);
+				return;
+			}
 
-				if (firstToken->GetCodeObjectType() == CodeObjectType::TYPE) {
-					ConfType* type = static_cast<ConfType*>(firstToken);
-					ConfInstance* inst = type->CreateInstance(tokenizedText[1]);
-					currentScope->AddChild(inst);
-					text = text.substr(text.find(' ')+1);
-				}
+			if (firstToken && firstToken->GetCodeObjectType() == CodeObjectType::TYPE) {
+				ConfType* type = static_cast<ConfType*>(firstToken);
+				//A redeclaration assigns the first instance of its name, in place
+				const auto& childs = (*currentScope)->GetChilds();
+				const bool isRedeclared = m_UseLazyInitializers && std::any_of(childs.begin(), childs.end(),
+					[&tokenizedText](const ConfScopeable* it) { return it->GetName() == tokenizedText[1]; });
+				ConfInstance* inst = type->CreateInstance(tokenizedText[1]);
+				(*currentScope)->AddChild(inst);
+				text = text.substr(text.find(' ')+1);
+				//Members are copied from their type when instantiated, they can't wait
+				if (m_UseLazyInitializers && !isRedeclared && (*currentScope)->GetCodeObjectType() == CodeObjectType::SCOPE &&
+					text.find(CP_TEXT('=')) != string_t::npos && DeferInitializer(*currentScope, inst, text))
+					break;
+			}
+
+			ConfParenthesized_t splitted;
+			{
+				ConfPhaseTimer tokenize{ m_Stats, ConfParsePhase::TOKENIZE };
+				auto tokens = operatorSplitter(text);
+				m_Macros.Expand(tokens);
+				if (m_ValueGraph && (*currentScope)->GetCodeObjectType() == CodeObjectType::SCOPE)
+					m_ValueGraph->Record(this, *currentScope, tokens);
+				//Members are shared until written, operator. only reads
+				const string_t assigned = assignedPath(tokens);
+				if (!assigned.empty()) (*currentScope)->EvaluateInitializersReading(assigned.substr(0, assigned.find(CP_TEXT('.'))));
+				if (assigned.find(CP_TEXT('.')) != string_t::npos) ConfPath{ assigned }.ResolveForWrite(*currentScope);
+				splitted = parenthesisOperatorParser(tokens);
+			}
+			ConfPhaseTimer evaluate{ m_Stats, ConfParsePhase::EVALUATE };
+			ConfInstance* r = operatorParser(*currentScope, splitted);
+			if (r->IsTemp()) CP_SF(r);
+		}break;
+		}
+	}
+
+	ConfStatementInfo ConfParser::AnalyzeLine(ConfScope* scope, const string_t& line) {
+		ConfStatementInfo ret;
+		if (line.empty() || line[0] == TOKEN_CHAR_COMMENT) return ret;
+		if (line[0] == TOKEN_CHAR_SPECIAL || line[0] == TOKEN_CHAR_SCOPE_BEGIN ||
+			line[0] == TOKEN_CHAR_SCOPE_END) {
+			ret.IsStructural = true;
+			return ret;
+		}
+
+		string_t text = line;
+		std::vector<string_t> tokenizedText = filtersplit(text,
+			{ " =#%+-*/.", {false}, true }, true, true);
+		if (KeywordsMap.find(tokenizedText[0]) != KeywordsMap.end()) {
+			ret.IsStructural = true;
+			return ret;
+		}
+		ConfScopeable* firstToken = scope->GetByName(tokenizedText[0]);
+		if (firstToken && firstToken->GetCodeObjectType() == CodeObjectType::TYPE && tokenizedText.size() > 1) {
+			ret.Declares = tokenizedText[1];
+			text = text.substr(text.find(' ') + 1);
+		}
 
-				auto splitted = parenthesisOperatorParser(operatorSplitter(text));
-				ConfInstance* r = operatorParser(currentScope, splitted);
-				if (r->IsTemp()) CP_SF(r);
-			}break;
+		bool isMember = false, hasAssignation = false, readsTarget = false;
+		string_t target;
+		for (const auto& token : operatorSplitter(text)) {
+			if (token.empty()) continue;
+			if (cp_isalnum(token[0]) || token[0] == CP_TEXT('_')) {
+				bool isNumber = token[0] >= CP_TEXT('0') && token[0] <= CP_TEXT('9');
+				if (!isNumber && !isMember) {
+					if (target.empty()) target = token;
+					readsTarget |= hasAssignation && token == target;
+					if (std::find(ret.Reads.begin(), ret.Reads.end(), token) == ret.Reads.end())
+						ret.Reads.push_back(token);
+				}
+				isMember = false;
 			}
+			else {
+				isMember = token == string_t(1, TOKEN_CHAR_MEMBER);
+				if (hasAssignation || token[token.size() - 1] != TOKEN_CHAR_ASSIGNATION_SEPARATOR ||
+					token == CP_TEXT("==") || token == CP_TEXT("!=") ||
+					token == CP_TEXT("<=") || token == CP_TEXT(">=")) continue;
+				hasAssignation = true;
+				//'+=', '-=', ...
+				readsTarget |= token.size() > 1;
+			}
+		}
+		if (hasAssignation && !target.empty()) {
+			ret.Writes.push_back(target);
+			ret.IsCompound = readsTarget && ret.Declares.empty();
 		}
 		return ret;
 	}
 
-	ConfScope* ConfParser::GetNewIntrinsicScope() {
-		ConfScope* ret = new ConfScope();
-		ConfType* tyStr = new ConfTypeString();
-		auto tyStrSet = new ConfFunctionIntrinsicOperator(tyStr, CP_TEXT("operator="),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parmeters) {
-				ConfInstanceString* strThis = static_cast<ConfInstanceString*>(_this);
-				strThis->Set(static_cast<ConfInstanceString*>(parmeters[0])->Get());
-				return _this;
-			}, 14
-		);
-		tyStr->AddChild(tyStrSet);
-		ret->AddChild(tyStr);
-
-		ConfType* tyInt = new ConfTypeInt();
-		auto tyIntSet = new ConfFunctionIntrinsicOperator(tyInt, CP_TEXT("operator="),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				ConfInstanceInt* strThis = static_cast<ConfInstanceInt*>(_this);
-				strThis->Set(static_cast<ConfInstanceInt*>(parameters[0])->Get());
-				return _this;
-			}, 14
-		);
-
-		auto tyIntAdd = new ConfFunctionIntrinsicOperator(tyInt, CP_TEXT("operator+"),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				ConfInstanceInt* intThis = static_cast<ConfInstanceInt*>(_this);
-				ConfInstanceInt* ret = static_cast<ConfInstanceInt*>(
-					intThis->Clone(CP_TEXT("__RV")));
-				ret->Set(intThis->Get() + static_cast<ConfInstanceInt*>(parameters[0])->Get());
-				ret->SetTemp(true);
-				return ret;
-			}, 4
-		);
-
-		tyInt->AddChild(tyIntAdd);
-
-		auto tyIntMult = new ConfFunctionIntrinsicOperator(tyInt, CP_TEXT("operator*"),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				ConfInstanceInt* intThis = static_cast<ConfInstanceInt*>(_this);
-				ConfInstanceInt* ret = static_cast<ConfInstanceInt*>(
-					intThis->Clone(CP_TEXT("__RV")));
-				ret->Set(intThis->Get() * static_cast<ConfInstanceInt*>(parameters[0])->Get());
-				ret->SetTemp(true);
-				return ret;
-			}, 3
-		);
-
-		tyInt->AddChild(tyIntMult);
-
-		auto tyIntAddSet = new ConfFunctionIntrinsicOperator(tyInt, CP_TEXT("operator+="),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				ConfInstanceInt* strThis = static_cast<ConfInstanceInt*>(_this);
-				strThis->Set(strThis->Get() + static_cast<ConfInstanceInt*>(parameters[0])->Get());
-				return _this;
-			}, 14
-		);
-		tyInt->AddChild(tyIntSet);
-		tyInt->AddChild(tyIntAddSet);
-		ret->AddChild(tyInt);
-
-		ConfType* tyFloat = new ConfTypeFloat();
-		auto tyFloSet = new ConfFunctionIntrinsicOperator(tyStr, CP_TEXT("operator="),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				ConfInstanceFloat* strThis = static_cast<ConfInstanceFloat*>(_this);
-				strThis->Set(static_cast<ConfInstanceFloat*>(parameters[0])->Get());
-				return _this;
-			}, 14
-		);
-		tyFloat->AddChild(tyFloSet);
-		ret->AddChild(tyFloat);
-
-		ConfType* tyObject = new ConfTypeObject();
-		auto tyObjDot = new ConfFunctionIntrinsicOperator(tyStr, CP_TEXT("operator."),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				for (auto c : _this->GetSubInstances())
-					if (c->GetName() == parameters[0]->GetName()) return c;
-				return static_cast<ConfInstance*>(nullptr);
-			}, 1
-		);
-
-		auto tyObjEqu = new ConfFunctionIntrinsicOperator(tyStr, CP_TEXT("operator="),
-			[](ConfInstance* _this, std::vector<ConfInstance*> parameters) {
-				_this->ClearSubInstances();
-				for (auto c : parameters[0]->GetSubInstances())
-					_this->AddSubInstance(static_cast<ConfInstance*>(c->Clone(c->GetName())));
-				return _this;
-			}, 14
-		);
-		
-		tyObject->AddChild(tyObjDot);
-		tyObject->AddChild(tyObjEqu);
-		ret->AddChild(tyObject);
+	bool ConfParser::EvaluateCondition(ConfScope* scope, const string_t& expression) {
+		if (!m_IsInitialized) Initialize();
+		auto tokens = operatorSplitter(expression);
+		m_Macros.Expand(tokens);
+		bool isEmpty = true;
+		for (auto& token : tokens) {
+			if (token.empty()) continue;
+			isEmpty = false;
+			if ((cp_isalnum(token[0]) || token[0] == CP_TEXT('_')) &&
+				(token[0] < CP_TEXT('0') || token[0] > CP_TEXT('9')) &&
+				!scope->GetByName(token, CodeObjectType::INSTANCE))
+				token = CP_TEXT("0");
+		}
+		if (isEmpty) return false;
+
+		auto grouped = parenthesisOperatorParser(tokens);
+		ConfInstance* result = operatorParser(scope, grouped);
+		bool ret = false;
+		if (auto value = dynamic_cast<ConfIntrinsicInstance<int>*>(result)) ret = value->Get() != 0;
+		else if (auto value = dynamic_cast<ConfIntrinsicInstance<float>*>(result)) ret = value->Get() != 0.f;
+		else if (auto value = dynamic_cast<ConfIntrinsicInstance<string_t>*>(result))
+			ret = value->GetRef().size() > 2; //Quotes are kept
+		if (result && result->IsTemp()) CP_SF(result);
+		return ret;
+	}
+
+	bool ConfParser::DeferInitializer(ConfScope* scope, ConfInstance* target, const string_t& statement) {
+		ConfPhaseTimer tokenize{ m_Stats, ConfParsePhase::TOKENIZE };
+		auto tokens = operatorSplitter(statement);
+		m_Macros.Expand(tokens);
+		tokens.erase(std::remove(tokens.begin(), tokens.end(), string_t{}), tokens.end());
+		//Compound assignations read the default value, nothing to gain
+		if (tokens.size() < 3 || tokens[0] != target->GetName() || tokens[1] != CP_TEXT("=")) return false;
+		if (m_ValueGraph) m_ValueGraph->Record(this, scope, tokens);
+		tokens.erase(tokens.begin(), tokens.begin() + 2);
+
+		//Names, not members nor numbers
+		std::vector<string_t> reads;
+		for (std::size_t i{ 0 }; i < tokens.size(); ++i) {
+			const string_t& token = tokens[i];
+			if ((cp_isalnum(token[0]) || token[0] == CP_TEXT('_')) &&
+				(token[0] < CP_TEXT('0') || token[0] > CP_TEXT('9')) &&
+				(!i || tokens[i - 1] != string_t(1, TOKEN_CHAR_MEMBER)) &&
+				std::find(reads.begin(), reads.end(), token) == reads.end())
+				reads.push_back(token);
+		}
+		scope->AddInitializer(target, { this, parenthesisOperatorParser(tokens), std::move(reads) });
+		return true;
+	}
+
+	std::shared_ptr<const ConfMacroTable> ConfParser::SnapshotMacros() {
+		if (m_Macros.IsEmpty()) return nullptr;
+		//Copied once per set of definitions, not per declaration
+		if (!m_MacrosSnapshot || m_MacrosSnapshot->GetHash() != m_Macros.GetHash())
+			m_MacrosSnapshot = std::make_shared<const ConfMacroTable>(m_Macros);
+		return m_MacrosSnapshot;
+	}
+
+	void ConfParser::RunInitializer(ConfScope* scope, ConfInstance* target, ConfParenthesized_t& statement) {
+		ConfPhaseTimer evaluate{ m_Stats, ConfParsePhase::EVALUATE };
+		ConfInstance* value = operatorParser(scope, statement);
+		ConfFunctionIntrinsic* op = target->GetFunction(string_t{ TOKEN_STRING_PREFIX_OPERATOR } + CP_TEXT("="));
+		if (!value || !op) {
+			//Initializer without value or type without assignation
+			assert(false);
+		}
+		else op->Call(target, { value });
+		if (value && value->IsTemp()) CP_SF(value);
+	}
+
+	bool ConfStatementInfo::Uses(const string_t& name) const {
+		return Declares == name || std::find(Reads.begin(), Reads.end(), name) != Reads.end() ||
+			std::find(Writes.begin(), Writes.end(), name) != Writes.end();
+	}
+
+	void ConfParser::Include(ConfScope* scope, const std::filesystem::path& file, StringFormater_t format) {
+		ConfPhaseTimer timer{ m_Stats, ConfParsePhase::INCLUDE };
+		ConfTraceSpan span{ m_Trace, CP_TEXT("include"), ConfTrace::Category::PHASE,
+			m_Trace ? file.string<char_t>() : string_t{} };
+		if (m_Stats) m_Stats->Count(0, 0, 0, 1);
+		if (m_ActiveTask && !m_ActiveTask->GetCurrentFile().empty())
+			m_Dependencies[m_ActiveTask->GetCurrentFile()].push_back(SourcePath(file));
+		if (m_IncludeHandler) m_IncludeHandler(this, scope, file, format);
+		else if (m_UseIncludeCache && !m_SourceReader) {
+			auto canonical = CanonicalPath(file);
+			auto unit = ConfUnitCache::Instance().Find(canonical, m_Macros.GetHash());
+			if (unit) {
+				//The includer sees the macros the file defines
+				for (const auto& it : unit->Defines) m_Macros.Define(it);
+			}
+			else unit = BuildUnit(canonical, format);
+			if (!unit) return;
+			{
+				ConfTraceSpan merge{ m_Trace, CP_TEXT("merge") };
+				*scope += *unit->Scope;
+			}
+			if (m_Building.empty()) m_Units.push_back(std::move(unit));
+			else {
+				auto& building = m_Building.back();
+				building.Defines.insert(building.Defines.end(), unit->Defines.begin(), unit->Defines.end());
+				building.Dependencies.push_back(std::move(unit));
+			}
+		}
+		else if (m_ActiveTask) m_ActiveTask->Include(file, scope);
+		else ParseInto(file, scope, format);
+	}
+
+	std::shared_ptr<const ConfUnit> ConfParser::BuildUnit(const std::filesystem::path& file, StringFormater_t format) {
+		for (const auto& it : m_Building) {
+			if (it.File == file) {
+				assert(false && "Include cycle");
+				return nullptr;
+			}
+		}
 
+		auto unit = std::make_shared<ConfUnit>();
+		unit->File = file;
+		unit->Macros = m_Macros.GetHash();
+		std::error_code ec;
+		unit->FileSize = std::filesystem::file_size(file, ec);
+		if (!ec) unit->WriteTime = std::filesystem::last_write_time(file, ec);
+		if (ec || !HashFile(file, unit->Hash)) return nullptr;
+
+		unit->Scope = new ConfScope(GetIntrinsicScope());
+		m_Building.push_back({ file, {}, {} });
+		ParseInto(file, unit->Scope, format);
+		//Units outlive the parser building them
+		unit->Scope->MaterializeTypes();
+		unit->Scope->EvaluateInitializers();
+		unit->Dependencies = std::move(m_Building.back().Dependencies);
+		unit->Defines = std::move(m_Building.back().Defines);
+		m_Building.pop_back();
+		unit->Size = unit->Scope->GetSize();
+
+		ConfUnitCache::Instance().Insert(unit);
+		return unit;
+	}
+
+	std::vector<std::filesystem::path> ConfParser::GetIncludeClosure(const std::filesystem::path& file) const {
+		std::vector<std::filesystem::path> ret{ SourcePath(file) };
+		for (std::size_t i{ 0 }; i < ret.size(); ++i) {
+			auto it = m_Dependencies.find(ret[i]);
+			if (it == m_Dependencies.end()) continue;
+			for (const auto& dep : it->second)
+				if (std::find(ret.begin(), ret.end(), dep) == ret.end()) ret.push_back(dep);
+		}
 		return ret;
 	}
-}
 
+	bool ConfParser::HashFile(const std::filesystem::path& file, std::uint64_t& hash) {
+		std::ifstream ifs{ file, std::ios::binary };
+		if (!ifs) return false;
+		char buffer[1 << 16];
+		hash = hashBytes(nullptr, 0);
+		while (ifs.read(buffer, sizeof(buffer)) || ifs.gcount() > 0)
+			hash = hashBytes(buffer, static_cast<std::size_t>(ifs.gcount()), hash);
+		return true;
+	}
+
+	bool ConfParser::ReadSource(const std::filesystem::path& file, string_t& text) const {
+		if (m_SourceReader) return m_SourceReader(file, text);
+		ifstream_t ifs{ file };
+		if (!ifs) return false;
+		osstream_t sstream;
+		sstream << ifs.rdbuf();
+		text = sstream.str();
+		return true;
+	}
+
+	std::filesystem::path ConfParser::SourcePath(const std::filesystem::path& file) const {
+		//Sources of a reader are not on the file system
+		return m_SourceReader ? file.lexically_normal() : CanonicalPath(file);
+	}
+
+	std::filesystem::path ConfParser::CanonicalPath(const std::filesystem::path& file) {
+		std::error_code ec;
+		auto ret = std::filesystem::weakly_canonical(file, ec);
+		return ec ? std::filesystem::absolute(file).lexically_normal() : ret;
+	}
 
+	void ConfParser::SetIntrinsicLayer(const ConfIntrinsicLayer* layer) {
+		//The intrinsic scope is shared and already built
+		assert(!IntrinsicScope);
+		IntrinsicLayer = layer ? layer : &DefaultIntrinsics;
+	}
+
+	ConfScope* ConfParser::GetNewIntrinsicScope() {
+		return buildIntrinsicScope(*IntrinsicLayer);
+	}
+}
\ No newline at end of file
@@ -11,9 +11,77 @@
 #pragma once
 #include <unordered_map>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
 #include "global.hpp"
+#include "confparsetask.hpp"
+#include "confunitcache.hpp"
+#include "confstats.hpp"
+#include "confmemory.hpp"
+#include "confprofiler.hpp"
+#include "conftrace.hpp"
+#include "confmacro.hpp"
+#include "confintrinsics.hpp"
 
 namespace confparser {
+	/*!
+	 * \brief Names used by a line
+	 * 
+	 * Member accesses are reported on their instance: 'a.b = 1' writes 'a'
+	 * \see ConfParser::AnalyzeLine
+	*/
+	struct ConfStatementInfo {
+		/*!
+		 * \brief Name of the instance declared by the line, empty if none
+		*/
+		string_t Declares;
+		std::vector<string_t> Reads;
+		std::vector<string_t> Writes;
+
+		/*!
+		 * \brief The line changes the parser state beyond its names: directives,
+		 *		  scope openers and closers, keywords
+		*/
+		bool IsStructural = false;
+
+		/*!
+		 * \brief The line reads the value it writes: compound assignation or
+		 *		  written name on the right hand side ('x += 1', 'x = x + 1')
+		*/
+		bool IsCompound = false;
+
+		/*!
+		 * \brief Check if the line declares, reads or writes a name
+		*/
+		bool Uses(const string_t& name) const;
+	};
+
+	/*!
+	 * \brief Expression tokens grouped by parenthesis depth, "$n" tokens refer to
+	 *		  the group n of the next depth
+	*/
+	using ConfParenthesized_t = std::unordered_map<int, std::vector<std::vector<string_t>>>;
+
+	/*!
+	 * \brief Split an expression into operands and operators
+	*/
+	std::vector<string_t> operatorSplitter(string_t expr);
+
+	/*!
+	 * \brief Group the tokens of operatorSplitter by parenthesis
+	*/
+	ConfParenthesized_t parenthesisOperatorParser(const std::vector<string_t>& expression);
+
+	/*!
+	 * \brief Evaluate grouped tokens in a scope
+	 * \param depth Recursive arg let as 0
+	 * \param offset Recursive arg let as 0
+	 * \return The result, to be deleted if temporary
+	*/
+	ConfInstance* operatorParser(ConfScope* scope, ConfParenthesized_t& parenthetized, int depth = 0, int offset = 0);
+
 	/*!
 	 * \brief Main class, public interface
 	 * 
@@ -22,12 +90,128 @@ namespace confparser {
 	 * if necessary
 	*/
 	class ConfParser {
+	public:
+		/*!
+		 * \brief Called in place of the default inclusion of a file
+		 * 
+		 * Receives the parser, the scope where the directive is and the
+		 * included file, e.g. to merge a scope parsed beforehand instead of
+		 * evaluating the file again
+		*/
+		using IncludeHandler_t = std::function<void(ConfParser*, ConfScope*,
+			const std::filesystem::path&, StringFormater_t)>;
+
+		/*!
+		 * \brief Read a source in place of the file system
+		 * 
+		 * Receives the normalized path of the parsed or included file and
+		 * fills its text, returns false if there is no such source
+		*/
+		using SourceReader_t = std::function<bool(const std::filesystem::path&, string_t&)>;
+
+		/*!
+		 * \brief Include graph: file -> files it includes, in order
+		*/
+		using DependencyGraph_t = std::map<std::filesystem::path, std::vector<std::filesystem::path>>;
+
 	private:
 		bool m_IsInitialized;
+
+		/*!
+		 * \brief The parser deletes the intrinsic scope when destroyed if no unit
+		 *		  is cached, batch workers and documents don't
+		*/
+		bool m_OwnsEnvironment;
+		IncludeHandler_t m_IncludeHandler;
+		SourceReader_t m_SourceReader;
+		DependencyGraph_t m_Dependencies;
+
+		/*!
+		 * \brief The task running a step, includes are queued on it
+		*/
+		ConfParseTask* m_ActiveTask;
+		bool m_UseImageCache;
+		bool m_UseIncludeCache;
+		bool m_UseLazyTypes;
+		bool m_UseLazyInitializers;
+		ConfParseStats* m_Stats;
+		ConfLineProfiler* m_LineProfiler;
+		ConfTrace* m_Trace;
+		ConfValueGraph* m_ValueGraph;
+		ConfMacroTable m_Macros;
+
+		/*!
+		 * \brief Copy of m_Macros shared by the type stubs declared under it
+		*/
+		std::shared_ptr<const ConfMacroTable> m_MacrosSnapshot;
+
+		/*!
+		 * \brief Cached units merged in the trees of this parser, kept alive
+		*/
+		std::vector<std::shared_ptr<const ConfUnit>> m_Units;
+
+		/*!
+		 * \brief A unit being built, with the units it merged and the macros
+		 *		  it defined so far
+		*/
+		struct UnitBuild {
+			std::filesystem::path File;
+			std::vector<std::shared_ptr<const ConfUnit>> Dependencies;
+			std::vector<string_t> Defines;
+		};
+
+		/*!
+		 * \brief Units being built, innermost last
+		*/
+		std::vector<UnitBuild> m_Building;
+
+		std::shared_ptr<const ConfUnit> BuildUnit(const std::filesystem::path& file, StringFormater_t format);
+
+		/*!
+		 * \brief Get a copy of the current macros, nullptr if none is defined
+		*/
+		std::shared_ptr<const ConfMacroTable> SnapshotMacros();
+
+		/*!
+		 * \brief Compile the initializer of a declaration and attach it to its scope
+		 * \param scope The scope where the instance is declared
+		 * \param target The declared instance
+		 * \param statement The declaration without its type, "name = expression"
+		 * \return If the initializer was deferred, false to evaluate it now
+		*/
+		bool DeferInitializer(ConfScope* scope, ConfInstance* target, const string_t& statement);
+
+		/*!
+		 * \brief Names of the instances whose lazy initializer depends on itself
+		*/
+		std::vector<string_t> m_InitializerCycles;
+
+		/*!
+		 * \brief Malformed conditional blocks met by the parses
+		*/
+		std::vector<ConfConditionError> m_ConditionErrors;
+
+		friend class ConfParseTask;
+		friend class ConfInitializers;
+		friend class ConfDocument;
+
 		static std::unordered_map<string_t, ApplySpecialFunction_t> SpecialTokensMap;
 		static std::unordered_map<string_t, ApplyKeywordFunction_t> KeywordsMap;
 		static ConfScope* IntrinsicScope;
+		static const ConfIntrinsicLayer* IntrinsicLayer;
 		static ConfScope* GetNewIntrinsicScope();
+
+		/*!
+		 * \brief Register the directives and keywords handlers, once per process
+		*/
+		static void Register();
+
+		/*!
+		 * \brief Parse sources by index with worker parsers
+		 * \see ParseBatch
+		*/
+		std::vector<ConfScope*> ParseBatch(std::size_t count, std::size_t threads,
+			const std::function<void(ConfParser&, std::size_t, ConfScope*)>& parse);
 		static ConfScope* GlobalScope;
 
 	public:
@@ -41,13 +225,29 @@ namespace confparser {
 			return IntrinsicScope;
 		}
 
+		/*!
+		 * \brief Set the tables the intrinsic scope is built from
+		 * 
+		 * Must be called before the intrinsic scope is first used, it is never
+		 * changed once built
+		 * \param layer The top layer, usually layered on DefaultIntrinsics
+		*/
+		static void SetIntrinsicLayer(const ConfIntrinsicLayer* layer);
+
+		static const ConfIntrinsicLayer* GetIntrinsicLayer() {
+			return IntrinsicLayer;
+		}
+
 		/*!
 		 * \brief Get the global scope as singleton
 		 * \deprecated Global scope not to be singleton
 		*/
 		static ConfScope* GetGlobalScope();
 
-		ConfParser() : m_IsInitialized{ false } {}
+		ConfParser() : m_IsInitialized{ false }, m_OwnsEnvironment{ true }, m_ActiveTask{ nullptr }, m_UseImageCache{ false },
+			m_UseIncludeCache{ false }, m_UseLazyTypes{ false },
+			m_UseLazyInitializers{ false }, m_Stats{ nullptr }, m_LineProfiler{ nullptr }, m_Trace{ nullptr },
+			m_ValueGraph{ nullptr } {}
 		~ConfParser();
 
 		/*!
@@ -57,10 +257,350 @@ namespace confparser {
 		*/
 		ConfScope* Parse(std::filesystem::path file, StringFormater_t format=nullptr);
 
+		/*!
+		 * \brief Parse a conf source file into a given scope
+		 * 
+		 * Unlike Parse, the declarations are not added to the global scope
+		 * singleton so the same file can be parsed again into a fresh root
+		 * \param file The path to the source file
+		 * \param root The scope where to declare the top level objects
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		 * \return root
+		*/
+		ConfScope* ParseInto(std::filesystem::path file, ConfScope* root, StringFormater_t format=nullptr);
+
+		/*!
+		 * \brief Parse independent files into independent roots
+		 * 
+		 * Every file is parsed by its own worker parser, with the options,
+		 * include handler, trace and macros of this one, against the shared
+		 * intrinsic scope and unit cache. Units are cached per set of macros,
+		 * a file included under other macros is parsed again. Lazy types and
+		 * initializers are built before returning. Stats, profilers and value
+		 * graphs are not thread safe and not used. The include handler must be
+		 * thread safe when several threads are used
+		 * \param files The source files
+		 * \param threads Number of threads, 0 for one per core, 1 to parse on
+		 *		  the calling thread
+		 * \return One root per file, in order, to be deleted by the caller
+		 *		  before this parser
+		*/
+		std::vector<ConfScope*> ParseBatch(const std::vector<std::filesystem::path>& files,
+			std::size_t threads = 1);
+
+		/*!
+		 * \brief Parse independent in-memory sources into independent roots
+		 * \param sources The source texts, must stay valid during the call
+		 * \see ParseBatch
+		*/
+		std::vector<ConfScope*> ParseBatch(const std::vector<string_view_t>& sources,
+			std::size_t threads = 1);
+
+		/*!
+		 * \brief Parse a source held in memory
+		 * 
+		 * Includes are read through the source reader if any, from the file
+		 * system otherwise
+		 * \param text The source text
+		 * \param root The scope where to declare the top level objects, the
+		 *		  global scope if nullptr
+		 * \param name The path identifying the source in the dependencies and
+		 *		  the traces, never opened
+		 * \return root
+		*/
+		ConfScope* ParseText(string_view_t text, ConfScope* root=nullptr, std::filesystem::path name={});
+
+		/*!
+		 * \brief Create a resumable parse of a conf source file
+		 * 
+		 * Nothing is done before the first step of the returned task. The
+		 * synchronous Parse and ParseInto run a task to its end
+		 * \param file The path to the source file
+		 * \param root The scope where to declare the top level objects, the
+		 *		  global scope if nullptr
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		 * \see ConfParseTask
+		*/
+		ConfParseTask ParseAsync(std::filesystem::path file, ConfScope* root=nullptr, StringFormater_t format=nullptr);
+
+		/*!
+		 * \brief Parse a single trimmed, non empty line
+		 * \param currentScope The scope where the line is, updated by scope
+		 *		  openers and closers
+		 * \param line The line to parse
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		*/
+		void ParseLine(ConfScope** currentScope, string_t line, StringFormater_t format=nullptr);
+
+		/*!
+		 * \brief Statically find which names a trimmed line reads, writes and declares
+		 * \param scope The scope where the line is
+		 * \param line The line to analyze
+		*/
+		static ConfStatementInfo AnalyzeLine(ConfScope* scope, const string_t& line);
+
+		/*!
+		 * \brief Evaluate the expression of a %if or %elif directive
+		 * 
+		 * Macros are expanded and the names which are neither macros nor
+		 * instances of the scope are replaced by 0
+		 * \param scope The scope where the directive is
+		 * \param expression The directive argument
+		 * \return If the result is a non zero number or a non empty string
+		*/
+		bool EvaluateCondition(ConfScope* scope, const string_t& expression);
+
+		/*!
+		 * \brief Assign the result of a compiled expression to an instance
+		 * 
+		 * Used by deferred initializers and by value graph updates
+		 * \param scope The scope where the instance is declared
+		 * \param target The instance
+		 * \param statement The compiled expression
+		 * \see ConfInitializer, ConfValueGraph
+		*/
+		void RunInitializer(ConfScope* scope, ConfInstance* target, ConfParenthesized_t& statement);
+
+		/*!
+		 * \brief Include a file in a scope (%use and %default directives)
+		 * 
+		 * The inclusion is recorded in the dependency graph then delegated to
+		 * the include handler if any, then to the unit cache if enabled, otherwise
+		 * the file is parsed in scope by the running task or synchronously if
+		 * there is none
+		 * \param scope The scope where the directive is
+		 * \param file The included file
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		*/
+		void Include(ConfScope* scope, const std::filesystem::path& file, StringFormater_t format=nullptr);
+
+		/*!
+		 * \brief Replace the default inclusion behaviour
+		 * \param handler The new handler, nullptr to restore the default one
+		*/
+		void SetIncludeHandler(IncludeHandler_t handler) {
+			m_IncludeHandler = std::move(handler);
+		}
+
+		/*!
+		 * \brief Read the parsed and included sources through a reader
+		 * 
+		 * Paths are then normalized lexically instead of canonicalized, and
+		 * the image and include caches, which check files, are not used. A
+		 * parse needs no file system call at all
+		 * \param reader The reader, nullptr to read files again
+		*/
+		void SetSourceReader(SourceReader_t reader) {
+			m_SourceReader = std::move(reader);
+		}
+
+		/*!
+		 * \brief Read a source through the reader if any, from its file otherwise
+		 * \param file The source path
+		 * \param text Receives the source text
+		 * \return If the source exists
+		*/
+		bool ReadSource(const std::filesystem::path& file, string_t& text) const;
+
+		/*!
+		 * \brief Get the path identifying a source: canonical for files, lexically
+		 *		  normal for the sources of a reader
+		*/
+		std::filesystem::path SourcePath(const std::filesystem::path& file) const;
+
+		/*!
+		 * \brief Get the include graph recorded by the parses of this parser
+		 * 
+		 * Keys and values are canonical paths. A file parsed again has its
+		 * edges replaced
+		*/
+		const DependencyGraph_t& GetDependencies() const {
+			return m_Dependencies;
+		}
+
+		/*!
+		 * \brief Get a file and every file it includes, directly or not
+		 * \param file The file, as given to Parse
+		 * \return Canonical paths, file first
+		*/
+		std::vector<std::filesystem::path> GetIncludeClosure(const std::filesystem::path& file) const;
+
+		/*!
+		 * \brief Enable compiled images (.confc) for synchronous parses
+		 * 
+		 * When enabled, Parse and ParseInto load "<file>.confc" if its sources
+		 * and the macros defined before the parse are unchanged, otherwise they
+		 * parse the file and write the image. An image is only written by a
+		 * parse into an empty root: Parse writes one for the first file parsed
+		 * in the global scope only
+		 * \param enabled If the cache is used
+		 * \see ConfImage
+		*/
+		void SetImageCache(bool enabled) {
+			m_UseImageCache = enabled;
+		}
+
+		/*!
+		 * \brief Use the process wide unit cache for included files
+		 * 
+		 * When enabled, an included file is parsed alone once then its unit is
+		 * merged in the including scope, for every parser of the process, until
+		 * the file changes. The included file no longer sees the declarations
+		 * of the including one, the macros it defines are replayed when it is
+		 * served from the cache. Trees built this way must not outlive the parser
+		 * \param enabled If the cache is used
+		 * \see ConfUnitCache
+		*/
+		void SetIncludeCache(bool enabled) {
+			m_UseIncludeCache = enabled;
+		}
+
+		/*!
+		 * \brief Keep class declarations as source until their type is looked up
+		 * 
+		 * Declarations extending an existing type, or holding directives,
+		 * are still evaluated in place. A body is evaluated with the macros
+		 * defined at its declaration. Walking the childs of a scope needs
+		 * ConfScope::MaterializeTypes first. A lookup building a type runs
+		 * the parser: lookups are not thread safe while types are not built.
+		 * Trees built this way must not outlive the parser
+		 * \param enabled If the types are built lazily
+		 * \see ConfTypeStub
+		*/
+		void SetLazyTypes(bool enabled) {
+			m_UseLazyTypes = enabled;
+		}
+
+		/*!
+		 * \brief Evaluate the initializers of declarations on the first lookup
+		 *		  of their instance instead of in place
+		 * 
+		 * Applies to "Type name = expression" outside of types. Values are the
+		 * same as in place: an initializer is evaluated before a statement or
+		 * a merged file writes a name it reads. Writes made by the host through
+		 * the tree are not tracked, ConfScope::EvaluateInitializers first.
+		 * Initializers depending on themselves, only possible through names
+		 * declared after them, leave their instances default initialized and
+		 * are reported by GetInitializerCycles. Walking the childs of a scope
+		 * needs ConfScope::EvaluateInitializers first. Trees built this way
+		 * must not outlive the parser
+		 * \param enabled If the initializers are evaluated lazily
+		 * \see ConfInitializer
+		*/
+		void SetLazyInitializers(bool enabled) {
+			m_UseLazyInitializers = enabled;
+		}
+
+		/*!
+		 * \brief Get the names of the instances left default initialized
+		 *		  because their lazy initializer depends on itself, in order
+		*/
+		const std::vector<string_t>& GetInitializerCycles() const {
+			return m_InitializerCycles;
+		}
+
+		void ClearInitializerCycles() {
+			m_InitializerCycles.clear();
+		}
+
+		/*!
+		 * \brief Get the malformed conditional blocks met by the parses, in order
+		 * \see ConfParseTask
+		*/
+		const std::vector<ConfConditionError>& GetConditionErrors() const {
+			return m_ConditionErrors;
+		}
+
+		void ClearConditionErrors() {
+			m_ConditionErrors.clear();
+		}
+
+		/*!
+		 * \brief Collect statistics during the parses of this parser
+		 * 
+		 * Without stats, collection costs a pointer and a flag check per
+		 * phase, the flag being set by an enabled ConfMemoryTracker
+		 * \param stats Where to accumulate, nullptr to stop. Must outlive the
+		 *		  parses using it
+		*/
+		void SetStats(ConfParseStats* stats) {
+			m_Stats = stats;
+		}
+
+		ConfParseStats* GetStats() const {
+			return m_Stats;
+		}
+
+		/*!
+		 * \brief Profile the source lines evaluated by this parser
+		 * 
+		 * The allocations of every thread are counted while a profiler is
+		 * attached to any parser
+		 * \param profiler Where to accumulate, nullptr to stop. Must outlive the
+		 *		  parses using it
+		*/
+		void SetLineProfiler(ConfLineProfiler* profiler) {
+			if (!m_LineProfiler != !profiler) ConfMemoryTracker::CountThreadBytes(profiler != nullptr);
+			m_LineProfiler = profiler;
+		}
+
+		ConfLineProfiler* GetLineProfiler() const {
+			return m_LineProfiler;
+		}
+
+		/*!
+		 * \brief Record a timeline of the parses of this parser
+		 * \param trace Where to record, nullptr to stop. Must outlive the
+		 *		  parses using it
+		*/
+		void SetTrace(ConfTrace* trace) {
+			m_Trace = trace;
+		}
+
+		ConfTrace* GetTrace() const {
+			return m_Trace;
+		}
+
+		/*!
+		 * \brief Record the dependencies between the values evaluated by this parser
+		 * \param graph Where to record, nullptr to stop. Must outlive the trees
+		 *		  it records and be cleared with them
+		*/
+		void SetValueGraph(ConfValueGraph* graph) {
+			m_ValueGraph = graph;
+		}
+
+		ConfValueGraph* GetValueGraph() const {
+			return m_ValueGraph;
+		}
+
+		/*!
+		 * \brief Get the macros defined by the files parsed so far
+		*/
+		ConfMacroTable& GetMacros() {
+			return m_Macros;
+		}
+
+		/*!
+		 * \brief Get the canonical form of a path used as file identifier
+		 * \param file The path to canonicalize
+		*/
+		static std::filesystem::path CanonicalPath(const std::filesystem::path& file);
+
+		/*!
+		 * \brief Hash the content of a file
+		 * \param file The file to hash
+		 * \param hash Receives the hash
+		 * \return If the file could be read
+		 * \see hashBytes
+		*/
+		static bool HashFile(const std::filesystem::path& file, std::uint64_t& hash);
+
 		/*!
 		 * \brief ConfParser initialization
 		 * 
-		 * This function will be called automatically if not be the user
+		 * This function will be called automatically if not be the user.
+		 * The handlers are registered by the first parser only
 		*/
 		void Initialize();
 	};
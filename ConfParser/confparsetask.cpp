@@ -0,0 +1,300 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confparsetask.cpp
+ * \brief Resumable parse related implementations
+ */
+
+#include "confparsetask.hpp"
+#include "confparser.hpp"
+#include "confscope.hpp"
+#include "conftypestub.hpp"
+
+namespace confparser {
+	namespace {
+		string_t trimmed(string_view_t str) {
+			string_t ret{ str };
+			trim(ret);
+			return ret;
+		}
+	}
+
+	ConfParseTask::Directive ConfParseTask::GetDirective(string_view_t line, string_view_t& argument) {
+		std::size_t i{ 0 };
+		while (i < line.size() && cp_isspace(line[i])) ++i;
+		if (i == line.size() || line[i] != TOKEN_CHAR_SPECIAL) return Directive::NONE;
+		++i;
+		while (i < line.size() && cp_isspace(line[i])) ++i;
+		const std::size_t begin{ i };
+		while (i < line.size() && cp_isalnum(line[i])) ++i;
+		const string_view_t name = line.substr(begin, i - begin);
+		argument = line.substr(i);
+		if (name == TOKEN_STRING_SPECIAL_IF) return Directive::IF;
+		if (name == TOKEN_STRING_SPECIAL_IFDEF) return Directive::IFDEF;
+		if (name == TOKEN_STRING_SPECIAL_IFNDEF) return Directive::IFNDEF;
+		if (name == TOKEN_STRING_SPECIAL_ELIF) return Directive::ELIF;
+		if (name == TOKEN_STRING_SPECIAL_ELSE) return Directive::ELSE;
+		if (name == TOKEN_STRING_SPECIAL_ENDIF) return Directive::ENDIF;
+		return Directive::NONE;
+	}
+
+	ConfParseTask::ConfParseTask(ConfParser* parser, std::filesystem::path file, ConfScope* root,
+		StringFormater_t format) : m_Parser{ parser }, m_Root{ root }, m_Format{ format },
+		m_State{ State::RUNNING } {
+		m_Frames.push_back({ parser->SourcePath(file), {}, 0, root, false });
+	}
+
+	ConfParseTask::ConfParseTask(ConfParser* parser, std::filesystem::path name, string_t text, ConfScope* root) :
+		m_Parser{ parser }, m_Root{ root }, m_Format{ nullptr }, m_State{ State::RUNNING } {
+		Frame frame{ name.lexically_normal(), {}, 0, root, false };
+		frame.Text = std::move(text);
+		frame.IsBuffer = true;
+		m_Frames.push_back(std::move(frame));
+	}
+
+	bool ConfParseTask::Step() {
+		if (IsOver()) return true;
+		if (m_Frames.empty()) {
+			Finish(State::DONE);
+			return true;
+		}
+
+		//Includes reached by this step are queued on this task, nested tasks
+		//(include handlers) restore the previous one
+		ConfParseTask* previous = m_Parser->m_ActiveTask;
+		m_Parser->m_ActiveTask = this;
+
+		Frame& frame = m_Frames.back();
+		if (!frame.IsRead) {
+			if (!m_Parser->m_IsInitialized) m_Parser->Initialize();
+			m_Parser->m_Dependencies[frame.File].clear();
+
+			ConfParseStats* stats = m_Parser->m_Stats;
+			ConfTrace* trace = m_Parser->m_Trace;
+			if (trace) frame.Begin = ConfTrace::Clock_t::now();
+			ConfPhaseTimer timer{ stats, ConfParsePhase::READ, frame.File };
+			string_t rawText;
+			{
+				ConfTraceSpan read{ trace, CP_TEXT("read") };
+				//A missing source is empty
+				if (frame.IsBuffer) rawText = std::move(frame.Text);
+				else m_Parser->ReadSource(frame.File, rawText);
+			}
+
+			ConfPhaseTimer split{ stats, ConfParsePhase::SPLIT };
+			{
+				ConfTraceSpan lex{ trace, CP_TEXT("lex") };
+				removeCariageReturn(rawText);
+				frame.Lines = filtersplit(std::move(rawText), { '\n',false });
+			}
+			frame.IsRead = true;
+			if (trace) frame.Evaluate = ConfTrace::Clock_t::now();
+			if (stats) stats->Count(frame.Lines.size(), 0, 0, 0);
+		}
+		else {
+			ConfPhaseTimer timer{ m_Parser->m_Stats, ConfParsePhase::RESOLVE, frame.File };
+			const std::size_t index = m_Frames.size() - 1;
+			while (frame.Line < frame.Lines.size()) {
+				string_t line = std::move(frame.Lines[frame.Line++]);
+				trim(line);
+				if (line.empty()) continue;
+				if (line[0] == TOKEN_CHAR_SPECIAL && Preprocess(line)) break;
+				if (m_Parser->m_UseLazyTypes && Defer(line)) break;
+				ConfScope* scope = frame.Scope;
+				ConfLineProfiler* profiler = m_Parser->m_LineProfiler;
+				string_t frames, file;
+				if (profiler) {
+					//Relative to the root file directory, same named files of several directories stay apart
+					const std::filesystem::path base = m_Frames.front().File.parent_path();
+					for (const auto& it : m_Frames) {
+						if (!frames.empty()) frames.push_back(CP_TEXT(';'));
+						frames += it.File.lexically_proximate(base).string<char_t>() + CP_TEXT(":") + cp_tostring(it.Line);
+					}
+					file = frame.File.string<char_t>();
+				}
+				ConfLineTimer profile{ profiler, frames, std::move(file), frame.Line };
+				m_Parser->ParseLine(&scope, std::move(line), m_Format);
+				//An include pushes a frame and invalidates the reference
+				m_Frames[index].Scope = scope;
+				break;
+			}
+			if (index == m_Frames.size() - 1 && m_Frames[index].Line >= m_Frames[index].Lines.size()) {
+				for (const auto& it : m_Frames[index].Conditions)
+					Report(ConfConditionError::Kind::UNTERMINATED, it.Line);
+				Pop();
+			}
+		}
+
+		m_Parser->m_ActiveTask = previous;
+		if (m_Frames.empty()) Finish(State::DONE);
+		return IsOver();
+	}
+
+	bool ConfParseTask::Run(std::size_t steps) {
+		while (steps-- > 0 && !Step());
+		return IsOver();
+	}
+
+	void ConfParseTask::Cancel() {
+		if (!IsOver()) Finish(State::CANCELLED);
+	}
+
+	void ConfParseTask::Include(std::filesystem::path file, ConfScope* scope) {
+		m_Frames.push_back({ m_Parser->SourcePath(file), {}, 0, scope, false });
+	}
+
+	std::filesystem::path ConfParseTask::GetCurrentFile() const {
+		return m_Frames.empty() ? std::filesystem::path{} : m_Frames.back().File;
+	}
+
+	void ConfParseTask::Pop() {
+		if (ConfTrace* trace = m_Parser->m_Trace) {
+			const Frame& frame = m_Frames.back();
+			const auto end = ConfTrace::Clock_t::now();
+			//Frames cancelled before being read have no span
+			if (frame.IsRead) {
+				trace->Add(CP_TEXT("evaluate"), ConfTrace::Category::PHASE, frame.Evaluate, end);
+				trace->Add(frame.File.filename().string<char_t>(), ConfTrace::Category::FILE,
+					frame.Begin, end, frame.File.string<char_t>());
+			}
+		}
+		m_Frames.pop_back();
+	}
+
+	bool ConfParseTask::Preprocess(const string_t& line) {
+		string_view_t argument;
+		const Directive directive = GetDirective(line, argument);
+		if (directive == Directive::NONE) return false;
+
+		Frame& frame = m_Frames.back();
+		switch (directive) {
+		case Directive::IF:
+		case Directive::IFDEF:
+		case Directive::IFNDEF: {
+			bool isTaken;
+			if (directive == Directive::IF) isTaken = m_Parser->EvaluateCondition(frame.Scope, trimmed(argument));
+			else isTaken = m_Parser->m_Macros.IsDefined(trimmed(argument)) == (directive == Directive::IFDEF);
+			frame.Conditions.push_back({ isTaken, false, frame.Line });
+			if (!isTaken) Skip();
+		}break;
+		case Directive::ELIF:
+		case Directive::ELSE:
+			//Reached from an evaluated branch, the others are disabled
+			if (frame.Conditions.empty()) {
+				Report(ConfConditionError::Kind::UNMATCHED, frame.Line);
+				break;
+			}
+			if (frame.Conditions.back().HasElse) {
+				Report(directive == Directive::ELSE ? ConfConditionError::Kind::DUPLICATED_ELSE :
+					ConfConditionError::Kind::ELIF_AFTER_ELSE, frame.Line);
+			}
+			frame.Conditions.back().HasElse |= directive == Directive::ELSE;
+			Skip();
+			break;
+		case Directive::ENDIF:
+			if (frame.Conditions.empty()) Report(ConfConditionError::Kind::UNMATCHED, frame.Line);
+			else frame.Conditions.pop_back();
+			break;
+		default:
+			break;
+		}
+		return true;
+	}
+
+	void ConfParseTask::Skip() {
+		Frame& frame = m_Frames.back();
+		std::size_t depth{ 0 };
+		string_view_t argument;
+		while (frame.Line < frame.Lines.size()) {
+			const string_t& line = frame.Lines[frame.Line++];
+			const Directive directive = GetDirective(line, argument);
+			if (directive == Directive::NONE) continue;
+			if (directive == Directive::IF || directive == Directive::IFDEF || directive == Directive::IFNDEF) {
+				++depth;
+				continue;
+			}
+			if (depth) {
+				if (directive == Directive::ENDIF) --depth;
+				continue;
+			}
+
+			Condition& condition = frame.Conditions.back();
+			switch (directive) {
+			case Directive::ENDIF:
+				frame.Conditions.pop_back();
+				return;
+			case Directive::ELSE:
+				if (condition.HasElse) Report(ConfConditionError::Kind::DUPLICATED_ELSE, frame.Line);
+				condition.HasElse = true;
+				if (!condition.IsTaken) {
+					condition.IsTaken = true;
+					return;
+				}
+				break;
+			case Directive::ELIF:
+				if (condition.HasElse) Report(ConfConditionError::Kind::ELIF_AFTER_ELSE, frame.Line);
+				if (!condition.IsTaken && m_Parser->EvaluateCondition(frame.Scope, trimmed(argument))) {
+					condition.IsTaken = true;
+					return;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	void ConfParseTask::Report(ConfConditionError::Kind error, std::size_t line) {
+		m_Parser->m_ConditionErrors.push_back({ error, m_Frames.back().File, line });
+	}
+
+	bool ConfParseTask::Defer(string_t& line) {
+		constexpr std::size_t keywordSize = std::size(TOKENS_STRING_KEYWORD_CLASS) - 1;
+		auto isClass = [](const string_t& it) {
+			return it.compare(0, keywordSize, TOKENS_STRING_KEYWORD_CLASS) == 0 &&
+				it.size() > keywordSize && cp_isspace(it[keywordSize]);
+		};
+		if (!isClass(line)) return false;
+		std::size_t begin{ keywordSize };
+		while (begin < line.size() && cp_isspace(line[begin])) ++begin;
+		std::size_t end{ begin };
+		while (end < line.size() && (cp_isalnum(line[end]) || line[end] == CP_TEXT('_'))) ++end;
+		const string_t name = line.substr(begin, end - begin);
+		Frame& frame = m_Frames.back();
+		//Extending an existing type changes what is already built
+		if (name.empty() || frame.Scope->GetByName(name)) return false;
+
+		//Find the closing brace without evaluating anything
+		std::size_t depth{ 1 }, last{ frame.Line };
+		for (; last < frame.Lines.size(); ++last) {
+			string_view_t it = frame.Lines[last];
+			while (!it.empty() && cp_isspace(it.front())) it.remove_prefix(1);
+			if (it.empty()) continue;
+			//Directives act on the parser state when reached
+			if (it.front() == TOKEN_CHAR_SPECIAL) return false;
+			if (it.front() == TOKEN_CHAR_SCOPE_END && !--depth) break;
+			if (isClass(string_t{ it })) ++depth;
+		}
+		if (last == frame.Lines.size()) return false;
+
+		const std::size_t declaration{ frame.Line };
+		auto lines = std::make_shared<std::vector<string_t>>();
+		lines->push_back(std::move(line));
+		for (; frame.Line <= last; ++frame.Line) {
+			string_t& it = frame.Lines[frame.Line];
+			trim(it);
+			if (!it.empty()) lines->push_back(std::move(it));
+		}
+		frame.Scope->AddTypeStub(name, { m_Parser, std::move(lines), frame.File, declaration, m_Parser->SnapshotMacros() });
+		return true;
+	}
+
+	void ConfParseTask::Finish(State state) {
+		m_State = state;
+		while (!m_Frames.empty()) Pop();
+		if (m_Completion) m_Completion(*this);
+	}
+}
\ No newline at end of file
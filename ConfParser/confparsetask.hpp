@@ -0,0 +1,235 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confparsetask.hpp
+ * \brief Resumable parse related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief A malformed conditional block, reported instead of stopping the parse
+	*/
+	struct ConfConditionError {
+		enum class Kind {
+			UNTERMINATED, //! %if without %endif, Line is the %if
+			UNMATCHED, //! %elif, %else or %endif without %if, ignored
+			DUPLICATED_ELSE, //! Its lines are disabled
+			ELIF_AFTER_ELSE //! Its lines are disabled
+		};
+
+		Kind Error;
+		std::filesystem::path File;
+
+		/*!
+		 * \brief The line of the directive, 1 based
+		*/
+		std::size_t Line;
+	};
+
+	/*!
+	 * \brief A parse which can be run step by step
+	 *
+	 * Each step either reads one file or evaluates one statement, so an event
+	 * loop can interleave a large load with other work and cancel it between
+	 * two steps. Included files are read and evaluated by the same task, in
+	 * place of the directive including them.
+	 *
+	 * The conditional directives are handled here, per file:
+	 * \code
+	 * %ifdef NAME     (a macro is defined, %ifndef for the opposite)
+	 * %if EXPRESSION  (evaluates to non zero, unknown names are 0)
+	 * %elif EXPRESSION
+	 * %else
+	 * %endif
+	 * \endcode
+	 * Disabled lines are skipped by looking at their first char only, they
+	 * are never tokenized nor evaluated. Malformed blocks are reported by
+	 * ConfParser::GetConditionErrors, a block left open ends with its file.
+	 *
+	 * \see ConfParser::ParseAsync
+	*/
+	class ConfParseTask {
+	public:
+		enum class State {
+			RUNNING,
+			DONE,
+			CANCELLED
+		};
+
+		enum class Directive {
+			NONE,
+			IF,
+			IFDEF,
+			IFNDEF,
+			ELIF,
+			ELSE,
+			ENDIF
+		};
+
+		/*!
+		 * \brief Get the conditional directive of a line, reading its first chars only
+		 * \param argument Receives the rest of the line
+		*/
+		static Directive GetDirective(string_view_t line, string_view_t& argument);
+
+		/*!
+		 * \brief Called once when the task is done or cancelled
+		*/
+		using Completion_t = std::function<void(ConfParseTask&)>;
+
+		/*!
+		 * \brief Create a task, nothing is read before the first step
+		 * \param parser The parser evaluating the statements, must outlive the task
+		 * \param file The path to the source file
+		 * \param root The scope where to declare the top level objects
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		*/
+		ConfParseTask(ConfParser* parser, std::filesystem::path file, ConfScope* root,
+			StringFormater_t format = nullptr);
+
+		/*!
+		 * \brief Create a task parsing a source held in memory
+		 * \param parser The parser evaluating the statements, must outlive the task
+		 * \param name The path identifying the source, never opened
+		 * \param text The source text
+		 * \param root The scope where to declare the top level objects
+		*/
+		ConfParseTask(ConfParser* parser, std::filesystem::path name, string_t text, ConfScope* root);
+
+		ConfParseTask(ConfParseTask&&) = default;
+		ConfParseTask& operator=(ConfParseTask&&) = default;
+
+		/*!
+		 * \brief Read one file or evaluate one statement
+		 * \return If the task is over
+		*/
+		bool Step();
+
+		/*!
+		 * \brief Run steps until the task is over or the budget is spent
+		 * \param steps Maximum number of steps to run
+		 * \return If the task is over
+		*/
+		bool Run(std::size_t steps);
+
+		/*!
+		 * \brief Stop the task before its next step
+		 *
+		 * The statements already evaluated stay declared in the root scope
+		*/
+		void Cancel();
+
+		/*!
+		 * \brief Queue a file to be read and evaluated before the rest of the
+		 *		  current file
+		 * \param file The included file
+		 * \param scope The scope where to declare its top level objects
+		*/
+		void Include(std::filesystem::path file, ConfScope* scope);
+
+		/*!
+		 * \brief Get the canonical path of the file being evaluated, empty if none
+		*/
+		std::filesystem::path GetCurrentFile() const;
+
+		State GetState() const {
+			return m_State;
+		}
+
+		bool IsOver() const {
+			return m_State != State::RUNNING;
+		}
+
+		/*!
+		 * \brief Get the root scope given at creation
+		*/
+		ConfScope* GetResult() const {
+			return m_Root;
+		}
+
+		void SetCompletion(Completion_t completion) {
+			m_Completion = std::move(completion);
+		}
+
+	private:
+		/*!
+		 * \brief A conditional block being evaluated
+		*/
+		struct Condition {
+			bool IsTaken; //! A branch of the block has been evaluated
+			bool HasElse;
+			std::size_t Line; //! The line of the opening directive, 1 based
+		};
+
+		/*!
+		 * \brief A file being evaluated
+		*/
+		struct Frame {
+			std::filesystem::path File;
+			std::vector<string_t> Lines;
+			std::size_t Line;
+			ConfScope* Scope;
+			bool IsRead;
+			std::chrono::steady_clock::time_point Begin{};
+			std::chrono::steady_clock::time_point Evaluate{};
+
+			/*!
+			 * \brief The enclosing conditional blocks, innermost last
+			*/
+			std::vector<Condition> Conditions{};
+
+			/*!
+			 * \brief The source text when given in memory, read instead of File
+			*/
+			string_t Text{};
+			bool IsBuffer = false;
+		};
+
+		void Finish(State state);
+
+		/*!
+		 * \brief Pop the last frame and record its spans on the parser trace
+		*/
+		void Pop();
+
+		/*!
+		 * \brief Apply a conditional directive of the last frame
+		 * \return If the line was a conditional directive
+		*/
+		bool Preprocess(const string_t& line);
+
+		/*!
+		 * \brief Skip the disabled lines of the last frame up to the next
+		 *		  enabled branch or the end of the block
+		*/
+		void Skip();
+
+		/*!
+		 * \brief Report a malformed block of the current file to the parser
+		*/
+		void Report(ConfConditionError::Kind error, std::size_t line);
+
+		/*!
+		 * \brief Record a class declaration of the last frame as a type stub
+		 * \return If the declaration was deferred, false to evaluate it now
+		*/
+		bool Defer(string_t& line);
+
+		ConfParser* m_Parser;
+		ConfScope* m_Root;
+		StringFormater_t m_Format;
+		State m_State;
+		Completion_t m_Completion;
+		std::vector<Frame> m_Frames;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confpath.cpp
+ * \brief Compiled dotted paths related implementations
+ */
+
+#include "confpath.hpp"
+#include "confscope.hpp"
+#include "confinstance.hpp"
+#include <algorithm>
+
+namespace confparser {
+	ConfPath::ConfPath(string_view_t path) : m_Root{ nullptr }, m_Generation{ 0 } {
+		for (std::size_t start{ 0 };;) {
+			std::size_t end = path.find(CP_TEXT('.'), start);
+			m_Names.emplace_back(path.substr(start, end == string_view_t::npos ? end : end - start));
+			if (end == string_view_t::npos) break;
+			start = end + 1;
+		}
+		m_Objects.reserve(m_Names.size());
+	}
+
+	ConfScopeable* ConfPath::Resolve(ConfScope* root) {
+		const std::uint64_t generation = root ? root->GetLookupGeneration() : 0;
+		if (root == m_Root && m_Generation == generation)
+			return m_Objects.size() == m_Names.size() ? m_Objects.back() : nullptr;
+
+		m_Root = root;
+		m_Generation = generation;
+		m_Objects.clear();
+		ConfScopeable* current = root ? root->GetByName(m_Names.front()) : nullptr;
+		for (std::size_t i{ 1 }; current; ++i) {
+			m_Objects.push_back(current);
+			if (i == m_Names.size()) return current;
+
+			ConfScopeable* next = nullptr;
+			if (current->GetCodeObjectType() == CodeObjectType::INSTANCE) {
+				//The instance own values, not the type defaults GetMember may return
+				for (auto it : static_cast<ConfInstance*>(current)->GetSubInstances()) {
+					if (it->GetNameView() == m_Names[i]) {
+						next = it;
+						break;
+					}
+				}
+			}
+			else if (auto scope = dynamic_cast<ConfScope*>(current)) {
+				for (auto it : scope->GetChilds()) {
+					if (it->GetNameView() == m_Names[i]) {
+						next = it;
+						break;
+					}
+				}
+			}
+			current = next;
+		}
+		return nullptr;
+	}
+
+	ConfScopeable* ConfPath::ResolveForWrite(ConfScope* root) {
+		ConfScopeable* ret = Resolve(root);
+		if (!ret || std::none_of(m_Objects.begin(), m_Objects.end(), [](ConfScopeable* it) {
+			return it->GetCodeObjectType() == CodeObjectType::INSTANCE && static_cast<ConfInstance*>(it)->IsShared();
+			})) return ret;
+
+		//The rest of the path lies in the copies
+		for (std::size_t i{ 1 }; i < m_Objects.size(); ++i) {
+			if (m_Objects[i - 1]->GetCodeObjectType() != CodeObjectType::INSTANCE) continue;
+			ConfInstance* owner = static_cast<ConfInstance*>(m_Objects[i - 1]);
+			const auto& members = owner->GetSubInstances();
+			for (std::size_t j{ 0 }; j < members.size(); ++j) {
+				if (members[j]->GetNameView() == m_Names[i]) {
+					m_Objects[i] = owner->Detach(j);
+					break;
+				}
+			}
+		}
+		m_Generation = root->GetLookupGeneration();
+		return m_Objects.back();
+	}
+
+	ConfScopeable* ConfPathCache::Get(ConfScope* root, const string_t& path) {
+		auto it = m_Paths.find(path);
+		if (it == m_Paths.end()) it = m_Paths.emplace(path, ConfPath{ path }).first;
+		return it->second.ResolveForWrite(root);
+	}
+}
\ No newline at end of file
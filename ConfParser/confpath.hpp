@@ -0,0 +1,91 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confpath.hpp
+ * \brief Compiled dotted paths related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace confparser {
+	/*!
+	 * \brief A dotted path split once and resolved lazily
+	 * 
+	 * The objects met along the path are kept with the lookup generation of
+	 * the root they were resolved at, so resolving again the same root is a
+	 * comparison until a child or a subinstance is added or removed in the
+	 * root or its parents. The root must outlive the path resolutions. Not
+	 * thread safe: use one path per thread.
+	 * 
+	 * \see ConfScope::GetLookupGeneration
+	*/
+	class ConfPath {
+		std::vector<string_t> m_Names;
+		std::vector<ConfScopeable*> m_Objects;
+		ConfScope* m_Root;
+		std::uint64_t m_Generation;
+
+	public:
+		/*!
+		 * \brief Compile a path
+		 * \param path Names separated by dots
+		*/
+		explicit ConfPath(string_view_t path);
+
+		/*!
+		 * \brief Get the object designated by the path
+		 * \param root The scope where the first name is searched
+		 * \return The object or nullptr if not found
+		*/
+		ConfScopeable* Resolve(ConfScope* root);
+
+		/*!
+		 * \brief Get the object designated by the path to write to
+		 * 
+		 * Shared instances met along the path are replaced by private copies
+		 * first, so writing does not reach their other owners
+		 * \param root The scope where the first name is searched
+		 * \return The object or nullptr if not found
+		 * \see ConfInstance::Detach
+		*/
+		ConfScopeable* ResolveForWrite(ConfScope* root);
+
+		const std::vector<string_t>& GetNames() const {
+			return m_Names;
+		}
+
+		/*!
+		 * \brief Get the objects met by the last resolution, one per name
+		 *		  found
+		*/
+		const std::vector<ConfScopeable*>& GetObjects() const {
+			return m_Objects;
+		}
+	};
+
+	/*!
+	 * \brief Compiled paths of a scope, keyed by their text
+	 * \see ConfScope::GetByPath
+	*/
+	class ConfPathCache {
+		std::unordered_map<string_t, ConfPath> m_Paths;
+
+	public:
+		ConfScopeable* Get(ConfScope* root, const string_t& path);
+
+		void Clear() {
+			m_Paths.clear();
+		}
+
+		std::size_t GetCount() const {
+			return m_Paths.size();
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confprofiler.cpp
+ * \brief Profiling related implementations
+ */
+
+#include "confprofiler.hpp"
+#include "confjson.hpp"
+#include "confmemory.hpp"
+#include <algorithm>
+
+namespace confparser {
+	namespace {
+		std::size_t bucketOf(std::uint64_t ns) {
+			std::size_t ret{ 0 };
+			while (ns > 1 && ret < ConfFunctionProfile::BUCKETS_COUNT - 1) {
+				ns >>= 1;
+				++ret;
+			}
+			return ret;
+		}
+	}
+
+	void ConfFunctionProfile::Add(std::uint64_t ns) {
+		Calls.fetch_add(1, std::memory_order_relaxed);
+		Nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+		Histogram[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+		auto max = MaxNanoseconds.load(std::memory_order_relaxed);
+		while (ns > max && !MaxNanoseconds.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+	}
+
+	std::uint64_t ConfFunctionProfile::GetPercentile(double ratio) const {
+		const auto calls = Calls.load(std::memory_order_relaxed);
+		if (!calls) return 0;
+		const auto target = static_cast<std::uint64_t>(ratio * calls);
+		std::uint64_t seen{ 0 };
+		for (std::size_t i{ 0 }; i < BUCKETS_COUNT; ++i) {
+			seen += Histogram[i].load(std::memory_order_relaxed);
+			if (seen > target || seen == calls)
+				return std::min(std::uint64_t{ 2 } << i, MaxNanoseconds.load(std::memory_order_relaxed));
+		}
+		return MaxNanoseconds.load(std::memory_order_relaxed);
+	}
+
+	ConfFunctionProfile* ConfFunctionProfiler::GetProfile(const string_t& type, const string_t& name) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto& ret = m_Profiles[{ type, name }];
+		if (!ret) {
+			ret = std::make_unique<ConfFunctionProfile>();
+			ret->Type = type;
+			ret->Name = name;
+		}
+		return ret.get();
+	}
+
+	std::vector<const ConfFunctionProfile*> ConfFunctionProfiler::GetProfiles() const {
+		std::vector<const ConfFunctionProfile*> ret;
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			for (const auto& it : m_Profiles) ret.push_back(it.second.get());
+		}
+		std::stable_sort(ret.begin(), ret.end(), [](const ConfFunctionProfile* a, const ConfFunctionProfile* b) {
+			return a->Nanoseconds.load(std::memory_order_relaxed) > b->Nanoseconds.load(std::memory_order_relaxed);
+		});
+		return ret;
+	}
+
+	void ConfFunctionProfiler::Reset() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		for (auto& it : m_Profiles) {
+			it.second->Calls.store(0, std::memory_order_relaxed);
+			it.second->Nanoseconds.store(0, std::memory_order_relaxed);
+			it.second->MaxNanoseconds.store(0, std::memory_order_relaxed);
+			for (auto& bucket : it.second->Histogram) bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void ConfFunctionProfiler::Dump(std::basic_ostream<char_t>& os) const {
+		os << CP_TEXT("function calls total_ns mean_ns p50_ns p99_ns max_ns\n");
+		for (auto it : GetProfiles()) {
+			const auto calls = it->Calls.load(std::memory_order_relaxed);
+			if (!calls) continue;
+			const auto ns = it->Nanoseconds.load(std::memory_order_relaxed);
+			os << it->Type << CP_TEXT('.') << it->Name << CP_TEXT(' ') << calls << CP_TEXT(' ')
+				<< ns << CP_TEXT(' ') << ns / calls << CP_TEXT(' ') << it->GetPercentile(0.5)
+				<< CP_TEXT(' ') << it->GetPercentile(0.99) << CP_TEXT(' ')
+				<< it->MaxNanoseconds.load(std::memory_order_relaxed) << CP_TEXT('\n');
+		}
+	}
+
+	void ConfFunctionProfiler::DumpJson(std::basic_ostream<char_t>& os) const {
+		os << CP_TEXT('[');
+		bool first{ true };
+		for (auto it : GetProfiles()) {
+			const auto calls = it->Calls.load(std::memory_order_relaxed);
+			if (!calls) continue;
+			if (!first) os << CP_TEXT(',');
+			first = false;
+			os << CP_TEXT("\n  {\"type\": ");
+			writeJsonString(os, it->Type);
+			os << CP_TEXT(", \"name\": ");
+			writeJsonString(os, it->Name);
+			os << CP_TEXT(", \"calls\": ") << calls
+				<< CP_TEXT(", \"total_ns\": ") << it->Nanoseconds.load(std::memory_order_relaxed)
+				<< CP_TEXT(", \"max_ns\": ") << it->MaxNanoseconds.load(std::memory_order_relaxed)
+				<< CP_TEXT(", \"histogram\": [");
+			//Trailing empty buckets are omitted, index n is the [2^n, 2^(n+1)) ns bucket
+			std::size_t last{ ConfFunctionProfile::BUCKETS_COUNT };
+			while (last > 1 && !it->Histogram[last - 1].load(std::memory_order_relaxed)) --last;
+			for (std::size_t i{ 0 }; i < last; ++i) {
+				if (i) os << CP_TEXT(", ");
+				os << it->Histogram[i].load(std::memory_order_relaxed);
+			}
+			os << CP_TEXT("]}");
+		}
+		os << CP_TEXT("\n]\n");
+	}
+
+	void ConfLineProfiler::Reset() {
+		m_Stacks.clear();
+		m_Lines.clear();
+	}
+
+	void ConfLineProfiler::DumpFolded(std::basic_ostream<char_t>& os, Metric metric) const {
+		for (const auto& it : m_Stacks) {
+			std::uint64_t weight;
+			switch (metric) {
+			case Metric::BYTES: weight = it.second.Bytes; break;
+			case Metric::HITS: weight = it.second.Hits; break;
+			default: weight = it.second.Nanoseconds; break;
+			}
+			if (weight) os << it.first << CP_TEXT(' ') << weight << CP_TEXT('\n');
+		}
+	}
+
+	void ConfLineProfiler::Dump(std::basic_ostream<char_t>& os, std::size_t count) const {
+		std::vector<const std::pair<const std::pair<string_t, std::size_t>, Counters>*> lines;
+		for (const auto& it : m_Lines) lines.push_back(&it);
+		std::sort(lines.begin(), lines.end(), [](auto a, auto b) {
+			return a->second.Nanoseconds > b->second.Nanoseconds;
+		});
+		if (lines.size() > count) lines.resize(count);
+		os << CP_TEXT("self_ns bytes hits line\n");
+		for (auto it : lines) {
+			os << it->second.Nanoseconds << CP_TEXT(' ') << it->second.Bytes << CP_TEXT(' ')
+				<< it->second.Hits << CP_TEXT(' ') << it->first.first << CP_TEXT(':')
+				<< it->first.second << CP_TEXT('\n');
+		}
+	}
+
+	void ConfLineProfiler::Push(const string_t& frames) {
+		m_Stack.push_back({ m_Key.size(), std::chrono::steady_clock::now(),
+			ConfMemoryTracker::GetThreadBytes(), 0, 0 });
+		if (!m_Key.empty()) m_Key.push_back(CP_TEXT(';'));
+		m_Key += frames;
+	}
+
+	void ConfLineProfiler::Pop(const string_t& file, std::size_t line) {
+		const Frame frame = m_Stack.back();
+		m_Stack.pop_back();
+		const std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - frame.Begin).count();
+		const std::uint64_t bytes = ConfMemoryTracker::GetThreadBytes() - frame.BeginBytes;
+
+		//Nested statements (cached includes) are charged to their own stacks
+		for (Counters* it : { &m_Stacks[m_Key], &m_Lines[{ file, line }] }) {
+			++it->Hits;
+			it->Nanoseconds += ns - std::min(ns, frame.ChildNanoseconds);
+			it->Bytes += bytes - std::min(bytes, frame.ChildBytes);
+		}
+		m_Key.resize(frame.KeySize);
+		if (!m_Stack.empty()) {
+			m_Stack.back().ChildNanoseconds += ns;
+			m_Stack.back().ChildBytes += bytes;
+		}
+	}
+}
\ No newline at end of file
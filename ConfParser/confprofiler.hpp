@@ -0,0 +1,236 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confprofiler.hpp
+ * \brief Profiling related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief Counters of every function sharing a type and a name
+	 * 
+	 * Latencies are bucketed by power of two nanoseconds: bucket n holds
+	 * the calls which took [2^n, 2^(n+1)) ns, bucket 0 also the null ones
+	*/
+	struct ConfFunctionProfile {
+		static constexpr std::size_t BUCKETS_COUNT = 40;
+
+		string_t Type;
+		string_t Name;
+		std::atomic<std::uint64_t> Calls{ 0 };
+		std::atomic<std::uint64_t> Nanoseconds{ 0 };
+		std::atomic<std::uint64_t> MaxNanoseconds{ 0 };
+		std::array<std::atomic<std::uint64_t>, BUCKETS_COUNT> Histogram{};
+
+		/*!
+		 * \brief Record a call
+		*/
+		void Add(std::uint64_t ns);
+
+		/*!
+		 * \brief Get the latency under which a ratio of the calls are, rounded to
+		 *		  the upper bound of the bucket and capped by the slowest call
+		 * \param ratio The ratio in [0, 1], 0.5 for the median
+		*/
+		std::uint64_t GetPercentile(double ratio) const;
+	};
+
+	/*!
+	 * \brief Process wide profiler of ConfFunctionIntrinsic::Call
+	 * 
+	 * Disabled by default. Once enabled each intrinsic function and operator
+	 * resolves its profile on first call, keyed by its type and its name so
+	 * clones share counters. Thread safe.
+	*/
+	class ConfFunctionProfiler {
+		std::atomic<bool> m_IsEnabled;
+		std::map<std::pair<string_t, string_t>, std::unique_ptr<ConfFunctionProfile>> m_Profiles;
+		mutable std::mutex m_Mutex;
+
+		ConfFunctionProfiler() : m_IsEnabled{ false } {}
+	public:
+		static ConfFunctionProfiler& Instance() {
+			static ConfFunctionProfiler instance;
+			return instance;
+		}
+
+		void SetEnabled(bool enabled) {
+			m_IsEnabled.store(enabled, std::memory_order_relaxed);
+		}
+
+		bool IsEnabled() const {
+			return m_IsEnabled.load(std::memory_order_relaxed);
+		}
+
+		/*!
+		 * \brief Get or create the profile of a function, valid for the process life
+		*/
+		ConfFunctionProfile* GetProfile(const string_t& type, const string_t& name);
+
+		/*!
+		 * \brief Get the profiles sorted by decreasing cumulative time
+		*/
+		std::vector<const ConfFunctionProfile*> GetProfiles() const;
+
+		/*!
+		 * \brief Zero every counter, profiles are kept
+		*/
+		void Reset();
+
+		/*!
+		 * \brief Print one line per called function, slowest first
+		*/
+		void Dump(std::basic_ostream<char_t>& os) const;
+
+		/*!
+		 * \brief Print the profiles and their histograms as a JSON array
+		*/
+		void DumpJson(std::basic_ostream<char_t>& os) const;
+	};
+
+	/*!
+	 * \brief Time a call for the life of the object, does nothing without profile
+	*/
+	class ConfFunctionTimer {
+		ConfFunctionProfile* m_Profile;
+		std::chrono::steady_clock::time_point m_Begin;
+	public:
+		ConfFunctionTimer(ConfFunctionProfile* profile) : m_Profile{ profile } {
+			if (m_Profile) m_Begin = std::chrono::steady_clock::now();
+		}
+
+		~ConfFunctionTimer() {
+			if (m_Profile) m_Profile->Add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - m_Begin).count());
+		}
+
+		ConfFunctionTimer(const ConfFunctionTimer&) = delete;
+		ConfFunctionTimer& operator=(const ConfFunctionTimer&) = delete;
+	};
+
+	/*!
+	 * \brief Source lines profile of the parses of a parser
+	 * 
+	 * Each evaluated statement is charged its self time and the bytes of
+	 * scopeable objects allocated while evaluating it, under the stack of
+	 * lines including its file. Not thread safe, one per parser.
+	 * 
+	 * \see ConfParser::SetLineProfiler
+	*/
+	class ConfLineProfiler {
+	public:
+		struct Counters {
+			std::uint64_t Hits = 0;
+			std::uint64_t Nanoseconds = 0;
+			std::uint64_t Bytes = 0;
+		};
+
+		/*!
+		 * \brief Weight of the folded stacks
+		*/
+		enum class Metric {
+			TIME, //! Self nanoseconds
+			BYTES, //! Self allocated bytes
+			HITS //! Evaluations
+		};
+
+		/*!
+		 * \brief Get the self counters by stack, frames are "file:line", the
+		 *		  file relative to the root file directory, separated by ';',
+		 *		  outermost first
+		*/
+		const std::unordered_map<string_t, Counters>& GetStacks() const {
+			return m_Stacks;
+		}
+
+		/*!
+		 * \brief Get the self counters by source line, whatever the includer
+		*/
+		const std::map<std::pair<string_t, std::size_t>, Counters>& GetLines() const {
+			return m_Lines;
+		}
+
+		void Reset();
+
+		/*!
+		 * \brief Print the stacks in the folded format read by flamegraph tools
+		*/
+		void DumpFolded(std::basic_ostream<char_t>& os, Metric metric = Metric::TIME) const;
+
+		/*!
+		 * \brief Print the most expensive source lines
+		 * \param count Maximum number of lines to print
+		*/
+		void Dump(std::basic_ostream<char_t>& os, std::size_t count = 20) const;
+
+	private:
+		struct Frame {
+			std::size_t KeySize;
+			std::chrono::steady_clock::time_point Begin;
+			std::uint64_t BeginBytes;
+			std::uint64_t ChildNanoseconds;
+			std::uint64_t ChildBytes;
+		};
+
+		std::unordered_map<string_t, Counters> m_Stacks;
+		std::map<std::pair<string_t, std::size_t>, Counters> m_Lines;
+		string_t m_Key;
+		std::vector<Frame> m_Stack;
+
+		/*!
+		 * \brief Begin a statement
+		 * \param frames The including lines and the statement line, ';' separated
+		*/
+		void Push(const string_t& frames);
+
+		/*!
+		 * \brief End the last statement and charge its self cost
+		 * \param file The statement file
+		 * \param line The statement line, from 1
+		*/
+		void Pop(const string_t& file, std::size_t line);
+
+		friend class ConfLineTimer;
+	};
+
+	/*!
+	 * \brief Profile a statement for the life of the object, does nothing
+	 *		  without profiler
+	*/
+	class ConfLineTimer {
+		ConfLineProfiler* m_Profiler;
+		string_t m_File;
+		std::size_t m_Line;
+	public:
+		/*!
+		 * \param frames Where the statement is, \see ConfLineProfiler::Push
+		*/
+		ConfLineTimer(ConfLineProfiler* profiler, const string_t& frames, string_t file, std::size_t line) :
+			m_Profiler{ profiler }, m_File{ std::move(file) }, m_Line{ line } {
+			if (m_Profiler) m_Profiler->Push(frames);
+		}
+
+		~ConfLineTimer() {
+			if (m_Profiler) m_Profiler->Pop(m_File, m_Line);
+		}
+
+		ConfLineTimer(const ConfLineTimer&) = delete;
+		ConfLineTimer& operator=(const ConfLineTimer&) = delete;
+	};
+}
\ No newline at end of file
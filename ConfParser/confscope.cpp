@@ -11,22 +11,47 @@
 #include "confscope.hpp"
 #include "confparser.hpp"
 #include "confinstance.hpp"
+#include "confpath.hpp"
+#include "conftypestub.hpp"
+#include "confinitializer.hpp"
 #include <string>
+#include <algorithm>
 
 namespace confparser {
+	thread_local std::size_t ConfScopeable::PendingSize = 0;
+
 	ConfScope::~ConfScope() {
+		ClearChilds();
+		CP_SF(m_PathCache);
+		CP_SF(m_TypeStubs);
+		CP_SF(m_Initializers);
+	}
+
+	void ConfScope::ClearChilds() {
 		for (ConfScopeable* it : m_Childs) {
 			//!\deprecated Intrinsic scope should not be any scope child but check needed
-			if (_ADDRESSOF(*it) == _ADDRESSOF(*ConfParser::GetIntrinsicScope())) continue;
+			if (it == ConfParser::GetIntrinsicScope()) continue;
 			CP_SF(it);
 		}
+		m_Childs.clear();
+		if (m_Initializers) m_Initializers->Clear();
+		Touch();
 	}
 
 	ConfScopeable* ConfScope::GetByName(const string_t& name, CodeObjectType filter) const {
 		for (const auto& c : m_Childs) {
 			if ((filter != CodeObjectType::NONE ? c->GetCodeObjectType() == filter : true)
-				&& c->GetName() == name)
+				&& c->GetName() == name) {
+				//Initializing a declared instance is not an observable change of the scope
+				if (m_Initializers) m_Initializers->Run(const_cast<ConfScope*>(this), c);
 				return c;
+			}
+		}
+		if (m_TypeStubs && m_TypeStubs->Contains(name)) {
+			//Building a declared type is not an observable change of the scope
+			ConfScope* self = const_cast<ConfScope*>(this);
+			ConfTypeStubs::Materialize(self, m_TypeStubs->Take(name));
+			return GetByName(name, filter);
 		}
 		if (m_Parent) return m_Parent->GetByName(name);
 		return nullptr;
@@ -34,18 +59,89 @@ namespace confparser {
 
 	void ConfScope::AddChild(ConfScopeable* child) {
 		m_Childs.push_back(child);
+		SetOwner(child, this);
+		Touch();
+	}
+
+	void ConfScope::InsertChild(std::size_t index, ConfScopeable* child) {
+		m_Childs.insert(m_Childs.begin() + std::min(index, m_Childs.size()), child);
+		SetOwner(child, this);
+		Touch();
+	}
+
+	std::size_t ConfScope::RemoveChild(ConfScopeable* child) {
+		auto it = std::find(m_Childs.begin(), m_Childs.end(), child);
+		std::size_t ret = it - m_Childs.begin();
+		if (it != m_Childs.end()) {
+			m_Childs.erase(it);
+			if (child->GetOwner() == this) SetOwner(child, nullptr);
+		}
+		if (m_Initializers) m_Initializers->Remove(child);
+		Touch();
+		return ret;
+	}
+
+	ConfScopeable* ConfScope::RemoveChildAt(std::size_t index) {
+		ConfScopeable* ret = m_Childs[index];
+		m_Childs.erase(m_Childs.begin() + index);
+		if (ret->GetOwner() == this) SetOwner(ret, nullptr);
+		if (m_Initializers) m_Initializers->Remove(ret);
+		Touch();
+		return ret;
+	}
+
+	void ConfScope::AddTypeStub(const string_t& name, ConfTypeStub stub) {
+		if (!m_TypeStubs) m_TypeStubs = new ConfTypeStubs();
+		m_TypeStubs->Add(name, std::move(stub));
+	}
+
+	void ConfScope::MaterializeTypes() {
+		//Building a type may declare others
+		while (m_TypeStubs && !m_TypeStubs->IsEmpty()) ConfTypeStubs::Materialize(this, m_TypeStubs->TakeAll());
+	}
+
+	std::size_t ConfScope::GetTypeStubsCount() const {
+		return m_TypeStubs ? m_TypeStubs->GetCount() : 0;
+	}
+
+	void ConfScope::AddInitializer(const ConfScopeable* target, ConfInitializer initializer) {
+		if (!m_Initializers) m_Initializers = new ConfInitializers();
+		m_Initializers->Add(target, std::move(initializer));
+	}
+
+	void ConfScope::EvaluateInitializers() {
+		if (m_Initializers) m_Initializers->RunAll(this);
+	}
+
+	void ConfScope::EvaluateInitializersReading(const string_t& name) {
+		for (ConfScope* it = this; it; it = it->m_Parent)
+			if (it->m_Initializers) it->m_Initializers->RunReading(it, name);
+	}
+
+	std::size_t ConfScope::GetInitializersCount() const {
+		return m_Initializers ? m_Initializers->GetCount() : 0;
 	}
 
 	ConfScope& ConfScope::operator+=(const ConfScope& scope) {
+		//Initializers are bound to the instances of their scope, copies get values
+		const_cast<ConfScope&>(scope).EvaluateInitializers();
+		if (scope.m_TypeStubs && !scope.m_TypeStubs->IsEmpty()) {
+			if (!m_TypeStubs) m_TypeStubs = new ConfTypeStubs();
+			*m_TypeStubs += *scope.m_TypeStubs;
+		}
 
 		for (auto oc : scope.m_Childs) {
 			auto c = GetByName(oc->GetName());
 
 			if (c) {
 				switch (c->GetCodeObjectType()) {
-				case CodeObjectType::INSTANCE:
-					*static_cast<ConfInstance*>(c) = *static_cast<ConfInstance*>(oc);
-					break;
+				case CodeObjectType::INSTANCE: {
+					EvaluateInitializersReading(oc->GetName());
+					//A copy would share the subinstances of the merged scope, which may be a cached unit
+					ConfScope* owner = c->GetOwner() ? static_cast<ConfScope*>(c->GetOwner()) : this;
+					owner->InsertChild(owner->RemoveChild(c), oc->Clone(oc->GetName(), nullptr));
+					CP_SF(c);
+				}break;
 				case CodeObjectType::TYPE:
 					[[fallthrough]];
 				case CodeObjectType::SCOPE:
@@ -64,14 +160,49 @@ namespace confparser {
 	}
 
 
+	std::uint64_t ConfScope::GetLookupGeneration() const {
+		std::uint64_t ret = 0;
+		for (const ConfScope* it = this; it; it = it->m_Parent) ret += it->GetGeneration();
+		return ret;
+	}
+
+	ConfScopeable* ConfScope::GetByPath(const string_t& path) {
+		if (!m_PathCache) m_PathCache = new ConfPathCache();
+		return m_PathCache->Get(this, path);
+	}
+
+	std::size_t ConfScope::GetSize() const {
+		std::size_t ret = ConfScopeable::GetSize() + m_Childs.capacity() * sizeof(ConfScopeable*);
+		for (auto it : m_Childs) {
+			if (it == ConfParser::GetIntrinsicScope()) continue;
+			ret += it->GetSize();
+		}
+		return ret;
+	}
+
+	std::uint64_t ConfScope::ComputeHash() const {
+		std::uint64_t ret = ConfScopeable::ComputeHash();
+		for (auto it : m_Childs) {
+			if (it == ConfParser::GetIntrinsicScope()) continue;
+			const std::uint64_t hash = it->GetHash();
+			ret = hashBytes(&hash, sizeof(hash), ret);
+		}
+		return ret;
+	}
+
 	ConfScopeable* ConfScope::Clone(string_t name, ConfScopeable* buf) const {
 		if (!buf) buf = new ConfScope();
 		ConfScope* ret = static_cast<ConfScope*>(buf);
+		const_cast<ConfScope*>(this)->EvaluateInitializers();
 		ret->m_Name = name;
 		ret->m_Parent = m_Parent;
 		for (auto c : m_Childs) {
 			ret->AddChild(c->Clone(c->GetName(), nullptr));
 		}
+		if (m_TypeStubs) {
+			if (!ret->m_TypeStubs) ret->m_TypeStubs = new ConfTypeStubs();
+			*ret->m_TypeStubs += *m_TypeStubs;
+		}
 		return ret;
 	}
 }
\ No newline at end of file
@@ -24,7 +24,9 @@ namespace confparser {
 	*/
 	class ConfScope : public ConfScopeable {
 	public:
-		ConfScope(ConfScope* parent = nullptr) : m_Parent{ parent } {}
+		ConfScope(ConfScope* parent = nullptr) : m_Parent{ parent } {
+			Account(CodeObjectType::SCOPE);
+		}
 		~ConfScope();
 
 		virtual CodeObjectType GetCodeObjectType() const override {
@@ -53,13 +55,120 @@ namespace confparser {
 
 		void AddChild(ConfScopeable* child);
 
+		/*!
+		 * \brief Insert a child at a given position of the childs list
+		 * \param index The position, clamped to the childs count
+		 * \param child The child to insert
+		*/
+		void InsertChild(std::size_t index, ConfScopeable* child);
+
+		/*!
+		 * \brief Unregister a child without deleting it
+		 * \param child The child to remove
+		 * \return The index the child had or the childs count if not found
+		*/
+		std::size_t RemoveChild(ConfScopeable* child);
+
+		/*!
+		 * \brief Unregister the child at a known position without deleting it
+		 * \param index The position, lower than the childs count
+		 * \return The removed child
+		*/
+		ConfScopeable* RemoveChildAt(std::size_t index);
+
+		/*!
+		 * \brief Safe delete all childs
+		*/
+		void ClearChilds();
+
 		/*!
 		 * \brief Return a child or upper child by its name
+		 * 
+		 * A type declared but not built yet is built by its first lookup, an
+		 * instance declared but not initialized yet is initialized by it.
+		 * Such a lookup runs the parser and changes the tree, it is not thread
+		 * safe: call MaterializeTypes and EvaluateInitializers before sharing
+		 * the tree with other threads or read-only walkers
 		 * \param name The name of the child to retrieve
 		 * \param filter An optional filter to retrieve a specific CodeObjectType child
 		*/
 		ConfScopeable* GetByName(const string_t& name, CodeObjectType filter = CodeObjectType::NONE) const;
 
+		/*!
+		 * \brief Declare a type to build on its first lookup
+		 * \param name The type name
+		 * \param stub The declaration
+		 * \see ConfParser::SetLazyTypes
+		*/
+		void AddTypeStub(const string_t& name, ConfTypeStub stub);
+
+		/*!
+		 * \brief Build the types of this scope not built yet
+		 * 
+		 * Needed before walking the childs of a scope parsed with lazy types
+		*/
+		void MaterializeTypes();
+
+		/*!
+		 * \brief Get the number of type names declared and not built yet
+		*/
+		std::size_t GetTypeStubsCount() const;
+
+		/*!
+		 * \brief Set the initializer of an instance to evaluate on its first lookup
+		 * \param target A child instance
+		 * \param initializer The compiled initializer
+		 * \see ConfParser::SetLazyInitializers
+		*/
+		void AddInitializer(const ConfScopeable* target, ConfInitializer initializer);
+
+		/*!
+		 * \brief Evaluate the initializers of this scope not evaluated yet
+		 * 
+		 * Needed before walking the childs of a scope parsed with lazy initializers
+		*/
+		void EvaluateInitializers();
+
+		/*!
+		 * \brief Evaluate the initializers of this scope and of its parents
+		 *		  which read a name, before it is written
+		 * 
+		 * Keeps lazy initializers equal to in place ones: they never see a
+		 * write made after their declaration
+		 * \param name The written name, the first one of a dotted path
+		*/
+		void EvaluateInitializersReading(const string_t& name);
+
+		/*!
+		 * \brief Get the number of instances not initialized yet
+		*/
+		std::size_t GetInitializersCount() const;
+
+		/*!
+		 * \brief Return an object by its dotted path
+		 * 
+		 * "a.b.c" is the member or child c of b, itself in a. The first name is
+		 * searched like GetByName. The path is compiled once per scope then
+		 * resolved again only when the lookup generation changes. Shared
+		 * members met along the path are copied so the object can be written
+		 * 
+		 * \warning Not safe for concurrent callers, even readers: the compiled
+		 *			 paths are cached in the scope. Use a ConfPath per thread
+		 * \param path The dotted path
+		 * \return The object or nullptr if not found
+		 * \see ConfPath::ResolveForWrite
+		*/
+		ConfScopeable* GetByPath(const string_t& path);
+
+		/*!
+		 * \brief Get the structure generation of everything GetByName may reach:
+		 *		  the scope subtree and its parents subtrees
+		 * 
+		 * A change in an unrelated tree does not change it
+		 * \see ConfScopeable::GetGeneration
+		*/
+		std::uint64_t GetLookupGeneration() const;
+
 		/*!
 		 * \brief Fusion 2 scopes by overriding left by right
 		 * 
@@ -68,10 +177,26 @@ namespace confparser {
 		*/
 		ConfScope& operator+=(const ConfScope& scope);
 
+		/*!
+		 * \brief Get the memory used by the scope and its childs
+		 * \see ConfScopeable::GetSize
+		*/
+		virtual std::size_t GetSize() const override;
+
 		virtual ConfScopeable* Clone(string_t name, ConfScopeable* buf = nullptr) const override;
 
+	protected:
+		/*!
+		 * \brief Hash the childs in order too, not built types and not
+		 *		  evaluated initializers excluded
+		*/
+		virtual std::uint64_t ComputeHash() const override;
+
 	private:
 		ConfScope* m_Parent;
 		std::vector<ConfScopeable*> m_Childs;
+		ConfPathCache* m_PathCache = nullptr;
+		ConfTypeStubs* m_TypeStubs = nullptr;
+		ConfInitializers* m_Initializers = nullptr;
 	};
 }
\ No newline at end of file
@@ -10,6 +10,8 @@
 
 #pragma once
 #include "global.hpp"
+#include "confmemory.hpp"
+#include <atomic>
 
 namespace confparser {
 	/*!
@@ -29,12 +31,130 @@ namespace confparser {
 		 * \brief Define wherever the object is temporary and should be delete at
 		 *		  the end of the instruction (functions returns for example)
 		*/
-		bool m_IsTemporary;
+		bool m_IsTemporary = false;
+
+		/*!
+		 * \brief Incremented by every structural change of the object subtree
+		 * \see GetGeneration
+		*/
+		std::uint64_t m_Generation = 1;
+
+		/*!
+		 * \brief The scope or instance holding the object, nullptr for a root
+		 * 
+		 * A shared object keeps its first owner only, changes are propagated
+		 * up to it
+		*/
+		ConfScopeable* m_Owner = nullptr;
+
+		/*!
+		 * \brief Structural hash, valid while m_IsHashed is set
+		 * \see GetHash
+		*/
+		mutable std::atomic<std::uint64_t> m_Hash{ 0 };
+		mutable std::atomic<bool> m_IsHashed{ false };
+
+		/*!
+		 * \brief Size asked to operator new by the object being constructed
+		*/
+		static thread_local std::size_t PendingSize;
+
+		/*!
+		 * \brief Size of the allocation holding the object, 0 if not on heap
+		*/
+		std::uint32_t m_AllocatedSize;
+
+		/*!
+		 * \brief Kind the object is counted as by the memory tracker
+		*/
+		CodeObjectType m_AccountedKind = CodeObjectType::NONE;
+
+		bool m_IsAccounted;
+
+		/*!
+		 * \brief Count the object as kind from now on
+		 * 
+		 * Called by each level of constructor, the most derived wins
+		*/
+		void Account(CodeObjectType kind) {
+			if (m_IsAccounted && kind != m_AccountedKind)
+				ConfMemoryTracker::Instance().OnReclassify(m_AccountedKind, kind, GetAllocatedSize());
+			m_AccountedKind = kind;
+		}
+
+		std::size_t GetAllocatedSize() const {
+			return m_AllocatedSize ? m_AllocatedSize : sizeof(ConfScopeable);
+		}
+
+		/*!
+		 * \brief Heap memory owned by a string
+		*/
+		static std::size_t GetHeapSize(const string_t& str) {
+			//Short strings are stored inline
+			return str.capacity() * sizeof(char_t) > sizeof(string_t) ?
+				(str.capacity() + 1) * sizeof(char_t) : 0;
+		}
+
+		/*!
+		 * \brief Link a child to the scope or instance holding it
+		*/
+		static void SetOwner(ConfScopeable* child, ConfScopeable* owner) {
+			child->m_Owner = owner;
+		}
+
+		/*!
+		 * \brief Hash the object from its kind, its name and its childs hashes
+		*/
+		virtual std::uint64_t ComputeHash() const {
+			const CodeObjectType kind = GetCodeObjectType();
+			return hashBytes(m_Name.data(), m_Name.size() * sizeof(char_t), hashBytes(&kind, sizeof(kind)));
+		}
 	public:
-		ConfScopeable() = default;
+		ConfScopeable() : m_AllocatedSize{ static_cast<std::uint32_t>(PendingSize) },
+			m_IsAccounted{ ConfMemoryTracker::Instance().IsEnabled() } {
+			PendingSize = 0;
+			if (m_IsAccounted) ConfMemoryTracker::Instance().OnCreate(m_AccountedKind, GetAllocatedSize());
+		}
+
+		/*!
+		 * \brief Copy the name and the temporary flag, the copy is accounted apart
+		*/
+		ConfScopeable(const ConfScopeable& other) : ConfScopeable() {
+			m_Name = other.m_Name;
+			m_IsTemporary = other.m_IsTemporary;
+		}
+
+		ConfScopeable& operator=(const ConfScopeable& other) {
+			m_Name = other.m_Name;
+			m_IsTemporary = other.m_IsTemporary;
+			return *this;
+		}
+
+		virtual ~ConfScopeable() {
+			if (m_IsAccounted) ConfMemoryTracker::Instance().OnDestroy(m_AccountedKind, GetAllocatedSize());
+		}
+
+		/*!
+		 * \brief Remember the allocated size for the memory tracker
+		*/
+		static void* operator new(std::size_t size) {
+			PendingSize = size;
+			if (ConfMemoryTracker::IsCountingThreadBytes()) ConfMemoryTracker::ThreadBytes += size;
+			if (ConfMemoryTracker::Instance().IsEnabled()) ConfMemoryTracker::Instance().OnAllocate(size);
+			return ::operator new(size);
+		}
+
+		static void operator delete(void* ptr) {
+			::operator delete(ptr);
+		}
 
 		virtual string_t GetName() const { return m_Name; }
 
+		/*!
+		 * \brief Get the name without copying it, valid while the object lives
+		*/
+		string_view_t GetNameView() const { return m_Name; }
+
 		/*!
 		 * \brief Get the object type of the current object
 		 * \see CodeObjectType
@@ -60,10 +180,78 @@ namespace confparser {
 
 		void SetTemp(bool v) {
 			m_IsTemporary = v;
+			Account(v ? CodeObjectType::RVALUE : GetCodeObjectType());
+		}
+
+		/*!
+		 * \brief Get the memory used by the object and everything it owns, in bytes
+		 * \see ConfMemoryTracker::DumpTree
+		*/
+		virtual std::size_t GetSize() const {
+			return GetAllocatedSize() + GetHeapSize(m_Name);
 		}
 
 		bool IsTemp() const {
 			return m_IsTemporary;
 		}
+
+		/*!
+		 * \brief Get the structure generation of the object subtree
+		 * 
+		 * Adding, removing or replacing a child or a subinstance in the
+		 * subtree changes it, so a cached lookup is valid while it is
+		 * unchanged. Values changes and other trees do not count
+		 * \see ConfScope::GetLookupGeneration
+		*/
+		std::uint64_t GetGeneration() const {
+			return m_Generation;
+		}
+
+		/*!
+		 * \brief Mark a structural change of the object, counted by the object
+		 *		  and its owners
+		*/
+		void Touch() {
+			for (ConfScopeable* it = this; it; it = it->m_Owner) {
+				++it->m_Generation;
+				it->m_IsHashed.store(false, std::memory_order_release);
+			}
+		}
+
+		/*!
+		 * \brief Mark a value change of the object, the hashes of the object
+		 *		  and of its owners are computed again at their next use
+		*/
+		void TouchValue() {
+			for (ConfScopeable* it = this; it; it = it->m_Owner)
+				it->m_IsHashed.store(false, std::memory_order_release);
+		}
+
+		/*!
+		 * \brief Get the scope or instance holding the object
+		*/
+		ConfScopeable* GetOwner() const {
+			return m_Owner;
+		}
+
+		/*!
+		 * \brief Get the Merkle hash of the object: its kind, name, type, value
+		 *		  and childs
+		 * 
+		 * Equal hashes mean equal subtrees. A change only invalidates the
+		 * hashes on the path from the changed object to its root, the other
+		 * subtrees hashes are reused.
+		 * 
+		 * \warning Concurrent calls are safe, calls concurrent with a change
+		 *			 of the tree are not
+		 * \see diff
+		*/
+		std::uint64_t GetHash() const {
+			if (!m_IsHashed.load(std::memory_order_acquire)) {
+				m_Hash.store(ComputeHash(), std::memory_order_relaxed);
+				m_IsHashed.store(true, std::memory_order_release);
+			}
+			return m_Hash.load(std::memory_order_relaxed);
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confstats.cpp
+ * \brief Parse statistics related implementations
+ */
+
+#include "confstats.hpp"
+#include "confscope.hpp"
+#include <numeric>
+
+namespace confparser {
+	thread_local ConfParsePhase ConfPhaseTimer::Current = ConfParsePhase::COUNT;
+	std::atomic<bool> ConfPhaseTimer::IsTracking{ false };
+
+	std::uint64_t ConfParseStats::Counters::GetTotal() const {
+		return std::accumulate(Nanoseconds.begin(), Nanoseconds.end(), std::uint64_t{ 0 });
+	}
+
+	void ConfParseStats::Reset() {
+		Total = {};
+		Files.clear();
+		PeakTreeSize = 0;
+		m_FileIndexes.clear();
+		//A running parse keeps its phases but not its files
+		for (auto& it : m_Stack) it.File = NO_FILE;
+	}
+
+	const ConfParseStats::File* ConfParseStats::GetFile(const std::filesystem::path& file) const {
+		auto it = m_FileIndexes.find(file);
+		return it == m_FileIndexes.end() ? nullptr : &Files[it->second];
+	}
+
+	std::size_t ConfParseStats::FileIndex(const std::filesystem::path& file) {
+		auto it = m_FileIndexes.find(file);
+		if (it != m_FileIndexes.end()) return it->second;
+		Files.emplace_back();
+		Files.back().Path = file;
+		return m_FileIndexes[file] = Files.size() - 1;
+	}
+
+	void ConfParseStats::Charge() {
+		auto now = std::chrono::steady_clock::now();
+		if (!m_Stack.empty()) {
+			const std::uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_Last).count();
+			const std::size_t phase = static_cast<std::size_t>(m_Stack.back().Phase);
+			Total.Nanoseconds[phase] += elapsed;
+			if (m_Stack.back().File != NO_FILE) Files[m_Stack.back().File].Nanoseconds[phase] += elapsed;
+		}
+		m_Last = now;
+	}
+
+	void ConfParseStats::Push(ConfParsePhase phase, std::size_t file) {
+		Charge();
+		m_Stack.push_back({ phase, file });
+	}
+
+	void ConfParseStats::Pop() {
+		Charge();
+		m_Stack.pop_back();
+	}
+
+	void ConfParseStats::Count(std::size_t lines, std::size_t tokens, std::size_t statements, std::size_t includes) {
+		Total.Lines += lines;
+		Total.Tokens += tokens;
+		Total.Statements += statements;
+		Total.Includes += includes;
+		if (m_Stack.empty() || m_Stack.back().File == NO_FILE) return;
+		File& file = Files[m_Stack.back().File];
+		file.Lines += lines;
+		file.Tokens += tokens;
+		file.Statements += statements;
+		file.Includes += includes;
+	}
+
+	void ConfParseStats::Tree(ConfScope* root) {
+		PeakTreeSize = std::max(PeakTreeSize, root->GetSize());
+	}
+}
\ No newline at end of file
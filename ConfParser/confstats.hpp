@@ -0,0 +1,186 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confstats.hpp
+ * \brief Parse statistics related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <vector>
+#include <cstdint>
+
+namespace confparser {
+	/*!
+	 * \brief Stages of a parse, timings are exclusive: a nested stage pauses
+	 *		  the one it is nested in
+	*/
+	enum class ConfParsePhase {
+		READ, //! Reading source files and compiled images
+		SPLIT, //! Splitting files into lines
+		TOKENIZE, //! Splitting lines and expressions into tokens
+		RESOLVE, //! Dispatching statements: directives, keywords, names, declarations
+		EVALUATE, //! Evaluating expressions and operators
+		INCLUDE, //! Include directives, excluding the included files own stages
+		COUNT
+	};
+
+	constexpr std::size_t CONF_PARSE_PHASES_COUNT = static_cast<std::size_t>(ConfParsePhase::COUNT);
+
+	/*!
+	 * \brief Statistics filled by the parses of a parser
+	 * 
+	 * Values accumulate across parses until Reset.
+	 * \see ConfParser::SetStats
+	*/
+	class ConfParseStats {
+	public:
+		using Nanoseconds_t = std::array<std::uint64_t, CONF_PARSE_PHASES_COUNT>;
+
+		struct Counters {
+			Nanoseconds_t Nanoseconds{};
+			std::size_t Lines = 0;
+			std::size_t Tokens = 0;
+			std::size_t Statements = 0;
+			std::size_t Includes = 0;
+
+			std::uint64_t GetPhase(ConfParsePhase phase) const {
+				return Nanoseconds[static_cast<std::size_t>(phase)];
+			}
+
+			/*!
+			 * \brief Get the sum of the phases
+			*/
+			std::uint64_t GetTotal() const;
+		};
+
+		struct File : Counters {
+			std::filesystem::path Path;
+		};
+
+		/*!
+		 * \brief Whole parse counters
+		*/
+		Counters Total;
+
+		/*!
+		 * \brief Per source file counters, in first read order. An included
+		 *		  file does not count in its includer
+		*/
+		std::vector<File> Files;
+
+		/*!
+		 * \brief Largest estimated size of a parsed tree, in bytes
+		 * 
+		 * Trees only grow during a parse so they are measured when done
+		*/
+		std::size_t PeakTreeSize = 0;
+
+		void Reset();
+
+		/*!
+		 * \brief Get the counters of a file, nullptr if it was not parsed
+		 * \param file A canonical path
+		*/
+		const File* GetFile(const std::filesystem::path& file) const;
+
+	private:
+		friend class ConfPhaseTimer;
+		friend class ConfParser;
+		friend class ConfParseTask;
+
+		static constexpr std::size_t NO_FILE = static_cast<std::size_t>(-1);
+
+		struct Frame {
+			ConfParsePhase Phase;
+			std::size_t File;
+		};
+
+		std::vector<Frame> m_Stack;
+		std::chrono::steady_clock::time_point m_Last;
+		std::map<std::filesystem::path, std::size_t> m_FileIndexes;
+
+		std::size_t FileIndex(const std::filesystem::path& file);
+
+		/*!
+		 * \brief Charge the time elapsed since the last change to the running phase
+		*/
+		void Charge();
+		void Push(ConfParsePhase phase, std::size_t file);
+		void Pop();
+
+		/*!
+		 * \brief Add counts to the total and the running file
+		*/
+		void Count(std::size_t lines, std::size_t tokens, std::size_t statements, std::size_t includes);
+		void Tree(ConfScope* root);
+	};
+
+	/*!
+	 * \brief Time a phase for the life of the object
+	 * 
+	 * Without stats it only tracks the running phase of the thread, and only
+	 * while the memory tracker needs it
+	*/
+	class ConfPhaseTimer {
+		ConfParseStats* m_Stats;
+		ConfParsePhase m_Previous;
+		bool m_IsTracked;
+
+		static thread_local ConfParsePhase Current;
+
+		/*!
+		 * \brief Set while the running phases are observed without stats
+		 * \see ConfMemoryTracker::SetEnabled
+		*/
+		static std::atomic<bool> IsTracking;
+
+		friend class ConfMemoryTracker;
+	public:
+		ConfPhaseTimer(ConfParseStats* stats, ConfParsePhase phase) : m_Stats{ stats },
+			m_Previous{ ConfParsePhase::COUNT }, m_IsTracked{ stats || IsTracking.load(std::memory_order_relaxed) } {
+			if (!m_IsTracked) return;
+			m_Previous = Current;
+			Current = phase;
+			if (m_Stats) m_Stats->Push(phase, m_Stats->m_Stack.empty() ?
+				ConfParseStats::NO_FILE : m_Stats->m_Stack.back().File);
+		}
+
+		/*!
+		 * \brief Time a phase of a file, the nested phases are charged to it
+		*/
+		ConfPhaseTimer(ConfParseStats* stats, ConfParsePhase phase, const std::filesystem::path& file) :
+			m_Stats{ stats }, m_Previous{ ConfParsePhase::COUNT }, m_IsTracked{ stats || IsTracking.load(std::memory_order_relaxed) } {
+			if (!m_IsTracked) return;
+			m_Previous = Current;
+			Current = phase;
+			if (m_Stats) m_Stats->Push(phase, m_Stats->FileIndex(file));
+		}
+
+		~ConfPhaseTimer() {
+			if (!m_IsTracked) return;
+			Current = m_Previous;
+			if (m_Stats) m_Stats->Pop();
+		}
+
+		/*!
+		 * \brief Get the phase running on this thread, ConfParsePhase::COUNT
+		 *		  out of any parse or when neither stats nor the memory tracker
+		 *		  observe it
+		*/
+		static ConfParsePhase GetCurrentPhase() {
+			return Current;
+		}
+
+		ConfPhaseTimer(const ConfPhaseTimer&) = delete;
+		ConfPhaseTimer& operator=(const ConfPhaseTimer&) = delete;
+	};
+}
\ No newline at end of file
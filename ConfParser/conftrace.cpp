@@ -0,0 +1,66 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file conftrace.cpp
+ * \brief Timeline trace related implementations
+ */
+
+#include "conftrace.hpp"
+#include "confjson.hpp"
+#include <iomanip>
+#include <map>
+
+namespace confparser {
+	namespace {
+		constexpr const char_t* CATEGORY_NAMES[] = { CP_TEXT("file"), CP_TEXT("phase"), CP_TEXT("wait") };
+	}
+
+	void ConfTrace::Add(string_t name, Category category, Clock_t::time_point begin,
+		Clock_t::time_point end, string_t detail) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Spans.push_back({ std::move(name), std::move(detail), category, begin, end,
+			std::this_thread::get_id() });
+	}
+
+	void ConfTrace::Clear() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Spans.clear();
+	}
+
+	std::size_t ConfTrace::GetCount() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Spans.size();
+	}
+
+	void ConfTrace::Write(std::basic_ostream<char_t>& os) const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		//Small stable thread ids in order of appearance
+		std::map<std::thread::id, std::size_t> threads;
+		const auto flags = os.flags();
+		const auto precision = os.precision();
+		os << std::fixed << std::setprecision(3) << CP_TEXT("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+		for (std::size_t i{ 0 }; i < m_Spans.size(); ++i) {
+			const Span& span = m_Spans[i];
+			const auto tid = threads.emplace(span.Thread, threads.size() + 1).first->second;
+			const auto ts = std::chrono::duration<double, std::micro>(span.Begin - m_Origin).count();
+			const auto dur = std::chrono::duration<double, std::micro>(span.End - span.Begin).count();
+			os << (i ? CP_TEXT(",\n  ") : CP_TEXT("\n  ")) << CP_TEXT("{\"name\": ");
+			writeJsonString(os, span.Name);
+			os << CP_TEXT(", \"cat\": \"") << CATEGORY_NAMES[static_cast<std::size_t>(span.Kind)]
+				<< CP_TEXT("\", \"ph\": \"X\", \"pid\": 1, \"tid\": ") << tid
+				<< CP_TEXT(", \"ts\": ") << ts << CP_TEXT(", \"dur\": ") << dur;
+			if (!span.Detail.empty()) {
+				os << CP_TEXT(", \"args\": {\"detail\": ");
+				writeJsonString(os, span.Detail);
+				os << CP_TEXT('}');
+			}
+			os << CP_TEXT('}');
+		}
+		os << CP_TEXT("\n]}\n");
+		os.flags(flags);
+		os.precision(precision);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file conftrace.hpp
+ * \brief Timeline trace related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief Timeline of the parses of a parser, in the Chrome trace format
+	 * 
+	 * Each file gets a span holding its read, lex and evaluate spans, the
+	 * files it includes nest in its evaluate span. Includes served by the
+	 * unit cache show as merge spans. The output loads in chrome://tracing
+	 * and Perfetto. Thread safe.
+	 * 
+	 * \see ConfParser::SetTrace
+	*/
+	class ConfTrace {
+	public:
+		using Clock_t = std::chrono::steady_clock;
+
+		/*!
+		 * \brief Kind of a span, the trace event category
+		*/
+		enum class Category {
+			FILE, //! A whole file
+			PHASE, //! A part of a file parse
+			WAIT //! Time spent blocked on another file or thread
+		};
+
+		ConfTrace() : m_Origin{ Clock_t::now() } {}
+
+		/*!
+		 * \brief Record a span
+		 * \param name The displayed name
+		 * \param detail Optional string shown in the span arguments
+		*/
+		void Add(string_t name, Category category, Clock_t::time_point begin,
+			Clock_t::time_point end, string_t detail = {});
+
+		/*!
+		 * \brief Drop the recorded spans
+		*/
+		void Clear();
+
+		std::size_t GetCount() const;
+
+		/*!
+		 * \brief Write the trace as a Chrome trace JSON object
+		*/
+		void Write(std::basic_ostream<char_t>& os) const;
+
+	private:
+		struct Span {
+			string_t Name;
+			string_t Detail;
+			Category Kind;
+			Clock_t::time_point Begin;
+			Clock_t::time_point End;
+			std::thread::id Thread;
+		};
+
+		Clock_t::time_point m_Origin;
+		std::vector<Span> m_Spans;
+		mutable std::mutex m_Mutex;
+	};
+
+	/*!
+	 * \brief Record a span for the life of the object, does nothing without trace
+	*/
+	class ConfTraceSpan {
+		ConfTrace* m_Trace;
+		const char_t* m_Name;
+		ConfTrace::Category m_Category;
+		string_t m_Detail;
+		ConfTrace::Clock_t::time_point m_Begin;
+	public:
+		ConfTraceSpan(ConfTrace* trace, const char_t* name,
+			ConfTrace::Category category = ConfTrace::Category::PHASE, string_t detail = {}) :
+			m_Trace{ trace }, m_Name{ name }, m_Category{ category } {
+			if (m_Trace) {
+				m_Detail = std::move(detail);
+				m_Begin = ConfTrace::Clock_t::now();
+			}
+		}
+
+		~ConfTraceSpan() {
+			if (m_Trace) m_Trace->Add(m_Name, m_Category, m_Begin, ConfTrace::Clock_t::now(), std::move(m_Detail));
+		}
+
+		ConfTraceSpan(const ConfTraceSpan&) = delete;
+		ConfTraceSpan& operator=(const ConfTraceSpan&) = delete;
+	};
+}
\ No newline at end of file
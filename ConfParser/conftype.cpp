@@ -9,12 +9,12 @@
  */
 #include "conftype.hpp"
 #include "confinstance.hpp"
+#include "confintrinsics.hpp"
+#include "confparser.hpp"
 #include <cctype>
 #include <algorithm>
 
 namespace confparser {
-	std::unordered_map<string_t, ConfTypeIntrinsic*> ConfTypeIntrinsic::IntrinsicTypesRegistry;
-
 	ConfInstance* ConfType::_CreateInstance(ConfType* type, string_t name) {
 		ConfInstance* inst = new ConfInstance(type, std::move(name));
 		for (auto c : type->GetChilds()) {
@@ -28,6 +28,8 @@ namespace confparser {
 
 	ConfScopeable* ConfType::Clone(string_t name, ConfScopeable* buf) const {
 		if (!buf) buf = new ConfType(name);
+		//Members must follow the type, file units are merged through clones
+		ConfScope::Clone(name, buf);
 		static_cast<ConfType*>(buf)->CreateInstanceCallback = CreateInstanceCallback;
 		return buf;
 	}
@@ -66,21 +68,31 @@ namespace confparser {
 		return 500;
 	}
 
-	ConfTypeIntrinsic::ConfTypeIntrinsic(string_t name) : ConfType{ name } {
-		IntrinsicTypesRegistry[name] = this;
-	}
-
 	int ConfTypeIntrinsic::IsExprCompatible(string_t expr, ConfScope* scope) {
 		return -1;
 	}
 
+	ConfTypeIntrinsic* ConfTypeIntrinsic::GetIntrinsicType(string_view_t name) {
+		//A handful of types, compared without building a name string. The scope
+		//only holds the types its descriptors created
+		for (auto it : ConfParser::GetIntrinsicScope()->GetChilds()) {
+			if (it->GetNameView() == name) return static_cast<ConfTypeIntrinsic*>(it);
+		}
+		return nullptr;
+	}
+
 	ConfTypeIntrinsic* ConfTypeIntrinsic::TypeFromExpression(string_t expr, ConfScope* scope) {
 		int betterCompat = -1;
 		ConfTypeIntrinsic* betterType = nullptr;
-		for (const auto& ty : IntrinsicTypesRegistry) {
-			if (int curComp = ty.second->IsExprCompatible(expr, scope); curComp > betterCompat) {
-				betterType = ty.second;
-				betterCompat = curComp;
+		//Types replaced by an upper layer are found twice, the scope holds the upper one
+		for (auto layer = ConfParser::GetIntrinsicLayer(); layer; layer = layer->Base) {
+			for (std::size_t i{ 0 }; i < layer->TypesCount; ++i) {
+				ConfTypeIntrinsic* type = GetIntrinsicType(layer->Types[i].Name);
+				if (!type) continue;
+				if (int curComp = type->IsExprCompatible(expr, scope); curComp > betterCompat) {
+					betterType = type;
+					betterCompat = curComp;
+				}
 			}
 		}
 		return betterType;
@@ -95,14 +107,17 @@ namespace confparser {
 	}
 
 	int ConfTypeObject::IsExprCompatible(string_t expr, ConfScope* scope) {
-		return IntrinsicTypesRegistry[NAME_TYPE_FLOAT]->IsExprCompatible(expr, scope) > 0 || 
-			IntrinsicTypesRegistry[NAME_TYPE_STRING]->IsExprCompatible(expr, scope) > 0 ||
-			IntrinsicTypesRegistry[NAME_TYPE_INT]->IsExprCompatible(expr, scope) > 0 ? 1 : -1;
+		//Read only, parsers of other threads share the intrinsic scope
+		for (auto name : { NAME_TYPE_FLOAT, NAME_TYPE_STRING, NAME_TYPE_INT }) {
+			ConfTypeIntrinsic* type = GetIntrinsicType(name);
+			if (type && type->IsExprCompatible(expr, scope) > 0) return 1;
+		}
+		return -1;
 	}
 	ConfInstance* ConfTypeExpr::_CreateExprInstance(ConfType* type, string_t name) {
 		return nullptr;
 	}
 	int ConfTypeExpr::IsExprCompatible(string_t expr, ConfScope* scope) {
-		return IntrinsicTypesRegistry[NAME_TYPE_OBJECT] ? -1 : 1;
+		return GetIntrinsicType(NAME_TYPE_OBJECT) ? -1 : 1;
 	}
 }
\ No newline at end of file
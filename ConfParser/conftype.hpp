@@ -11,7 +11,6 @@
 #pragma once
 #include "global.hpp"
 #include "confscope.hpp"
-#include <unordered_map>
 
 namespace confparser {
 	constexpr char_t NAME_TYPE_STRING[] = CP_TEXT("string");
@@ -40,6 +39,7 @@ namespace confparser {
 		ConfType(string_t name, ConfScope* parent = nullptr) : ConfScope{ parent } {
 			m_Name = std::move(name);
 			CreateInstanceCallback = _CreateInstance;
+			Account(CodeObjectType::TYPE);
 		}
 
 		virtual CodeObjectType GetCodeObjectType() const override {
@@ -64,17 +64,14 @@ namespace confparser {
 	 * rvalues (values which are not properly variables but must be converted to like 1 or "hello")
 	*/
 	class ConfTypeIntrinsic : public ConfType {
-	protected:
-		/*!
-		 * \brief Registry of all intrinsic types
-		*/
-		static std::unordered_map<string_t, ConfTypeIntrinsic*> IntrinsicTypesRegistry;
 	public:
-		static const std::unordered_map<string_t, ConfTypeIntrinsic*>& GetTypesRegistry() {
-			return IntrinsicTypesRegistry;
-		}
+		ConfTypeIntrinsic(string_t name) : ConfType{ std::move(name) } {}
 
-		ConfTypeIntrinsic(string_t name);
+		/*!
+		 * \brief Get an intrinsic type of the intrinsic scope by name, nullptr if
+		 *		  it declares none
+		*/
+		static ConfTypeIntrinsic* GetIntrinsicType(string_view_t name);
 
 		/*!
 		 * \brief Returns a compatibility indice where a greater value is a better type compatibility
@@ -88,6 +85,9 @@ namespace confparser {
 
 		/*!
 		 * \brief Get the best compatible type from an expression otherwise nullptr
+		 * 
+		 * The types are tried in the order of the intrinsic layer tables, the
+		 * first of the best compatible ones is returned
 		 * \param expr The expression to extract the type from
 		 * \param scope The scope where the expression is
 		*/
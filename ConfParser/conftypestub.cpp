@@ -0,0 +1,57 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file conftypestub.cpp
+ * \brief Lazily built types related implementations
+ */
+
+#include "conftypestub.hpp"
+#include "confparser.hpp"
+
+namespace confparser {
+	std::vector<ConfTypeStub> ConfTypeStubs::Take(const string_t& name) {
+		auto it = m_Stubs.find(name);
+		if (it == m_Stubs.end()) return {};
+		auto ret = std::move(it->second);
+		m_Stubs.erase(it);
+		return ret;
+	}
+
+	std::vector<ConfTypeStub> ConfTypeStubs::TakeAll() {
+		std::vector<ConfTypeStub> ret;
+		for (auto& it : m_Stubs)
+			for (auto& stub : it.second) ret.push_back(std::move(stub));
+		m_Stubs.clear();
+		return ret;
+	}
+
+	ConfTypeStubs& ConfTypeStubs::operator+=(const ConfTypeStubs& stubs) {
+		for (const auto& it : stubs.m_Stubs) {
+			auto& dest = m_Stubs[it.first];
+			dest.insert(dest.end(), it.second.begin(), it.second.end());
+		}
+		return *this;
+	}
+
+	void ConfTypeStubs::Materialize(ConfScope* scope, const std::vector<ConfTypeStub>& stubs) {
+		for (const auto& stub : stubs) {
+			//A later %define must not change an earlier declaration
+			ConfMacroTable& macros = stub.Parser->GetMacros();
+			const bool isSwapped = (stub.Macros ? stub.Macros->GetHash() : 0) != macros.GetHash();
+			ConfMacroTable previous;
+			if (isSwapped) {
+				previous = std::move(macros);
+				macros = stub.Macros ? *stub.Macros : ConfMacroTable{};
+			}
+
+			//The class keyword moves the current scope into the type, its brace out
+			ConfScope* current = scope;
+			for (const auto& line : *stub.Lines) stub.Parser->ParseLine(&current, line);
+			//Bodies holding directives are not deferred, nothing was defined
+			if (isSwapped) macros = std::move(previous);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file conftypestub.hpp
+ * \brief Lazily built types related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief A class declaration kept as source until its type is used
+	 * \see ConfParser::SetLazyTypes
+	*/
+	struct ConfTypeStub {
+		/*!
+		 * \brief The parser evaluating the declaration, must outlive the stub
+		*/
+		ConfParser* Parser;
+
+		/*!
+		 * \brief The declaration lines, from "class" to the closing brace,
+		 *		  shared by the copies of the stub
+		*/
+		std::shared_ptr<const std::vector<string_t>> Lines;
+		std::filesystem::path File;
+
+		/*!
+		 * \brief The line of the declaration in File, from 1
+		*/
+		std::size_t Line;
+
+		/*!
+		 * \brief The macros defined at the declaration, shared by the stubs
+		 *		  declared under the same definitions, nullptr if none
+		*/
+		std::shared_ptr<const ConfMacroTable> Macros;
+	};
+
+	/*!
+	 * \brief The types declared but not built yet in a scope
+	 * \see ConfScope::AddTypeStub
+	*/
+	class ConfTypeStubs {
+		std::unordered_map<string_t, std::vector<ConfTypeStub>> m_Stubs;
+	public:
+		void Add(const string_t& name, ConfTypeStub stub) {
+			m_Stubs[name].push_back(std::move(stub));
+		}
+
+		/*!
+		 * \brief Remove and return the declarations of a type, in order
+		*/
+		std::vector<ConfTypeStub> Take(const string_t& name);
+
+		/*!
+		 * \brief Remove and return every declaration, in no particular order
+		*/
+		std::vector<ConfTypeStub> TakeAll();
+
+		bool Contains(const string_t& name) const {
+			return m_Stubs.find(name) != m_Stubs.end();
+		}
+
+		bool IsEmpty() const {
+			return m_Stubs.empty();
+		}
+
+		std::size_t GetCount() const {
+			return m_Stubs.size();
+		}
+
+		/*!
+		 * \brief Add the declarations of another scope after the ones of this one
+		*/
+		ConfTypeStubs& operator+=(const ConfTypeStubs& stubs);
+
+		/*!
+		 * \brief Build types by evaluating declarations in a scope, with the
+		 *		  macros of their declaration
+		*/
+		static void Materialize(ConfScope* scope, const std::vector<ConfTypeStub>& stubs);
+	};
+}
\ No newline at end of file
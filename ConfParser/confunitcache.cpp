@@ -0,0 +1,150 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confunitcache.cpp
+ * \brief Process wide cache of parsed files related implementations
+ */
+
+#include "confunitcache.hpp"
+#include "confparser.hpp"
+#include "confscope.hpp"
+
+namespace confparser {
+	ConfUnit::~ConfUnit() {
+		CP_SF(Scope);
+	}
+
+	std::shared_ptr<const ConfUnit> ConfUnitCache::Find(const std::filesystem::path& file, std::uint64_t macros) {
+		const Key_t key{ file, macros };
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		auto it = m_Units.find(key);
+		if (it == m_Units.end()) {
+			++m_Misses;
+			return nullptr;
+		}
+		std::shared_ptr<const ConfUnit> unit = *it->second;
+		std::vector<Stamp> stamps;
+		Collect(unit.get(), stamps);
+		lock.unlock();
+
+		//Stat and hash out of the lock, a touched file may be unchanged
+		bool isCurrent = true;
+		for (auto& stamp : stamps) {
+			std::error_code ec;
+			auto size = std::filesystem::file_size(stamp.Unit->File, ec);
+			auto time = ec ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(stamp.Unit->File, ec);
+			if (ec) {
+				isCurrent = false;
+				break;
+			}
+			if (stamp.FileSize == size && stamp.WriteTime == time) continue;
+			std::uint64_t hash;
+			if (!ConfParser::HashFile(stamp.Unit->File, hash) || hash != stamp.Unit->Hash) {
+				isCurrent = false;
+				break;
+			}
+			stamp.FileSize = size;
+			stamp.WriteTime = time;
+			stamp.IsTouched = true;
+		}
+
+		lock.lock();
+		it = m_Units.find(key);
+		if (!isCurrent || it == m_Units.end() || *it->second != unit) {
+			if (!isCurrent && it != m_Units.end() && *it->second == unit) Erase(it);
+			++m_Misses;
+			return nullptr;
+		}
+		//Not hashed again until touched again
+		for (const auto& stamp : stamps) {
+			if (!stamp.IsTouched) continue;
+			stamp.Unit->FileSize = stamp.FileSize;
+			stamp.Unit->WriteTime = stamp.WriteTime;
+		}
+		m_Lru.splice(m_Lru.begin(), m_Lru, it->second);
+		++m_Hits;
+		return unit;
+	}
+
+	void ConfUnitCache::Insert(std::shared_ptr<const ConfUnit> unit) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		const Key_t key{ unit->File, unit->Macros };
+		auto it = m_Units.find(key);
+		if (it != m_Units.end()) Erase(it);
+		m_Size += unit->Size;
+		m_Lru.push_front(unit);
+		m_Units[key] = m_Lru.begin();
+		Evict();
+	}
+
+	void ConfUnitCache::Invalidate(const std::filesystem::path& file) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto it = m_Units.lower_bound({ file, 0 });
+		while (it != m_Units.end() && it->first.first == file) Erase(it++);
+	}
+
+	void ConfUnitCache::Clear() {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Units.clear();
+		m_Lru.clear();
+		m_Size = 0;
+	}
+
+	void ConfUnitCache::SetCapacity(std::size_t capacity) {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Capacity = capacity;
+		Evict();
+	}
+
+	std::size_t ConfUnitCache::GetCapacity() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Capacity;
+	}
+
+	std::size_t ConfUnitCache::GetSize() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Size;
+	}
+
+	std::size_t ConfUnitCache::GetCount() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Units.size();
+	}
+
+	std::uint64_t ConfUnitCache::GetHits() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Hits;
+	}
+
+	std::uint64_t ConfUnitCache::GetMisses() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Misses;
+	}
+
+	std::uint64_t ConfUnitCache::GetEvictions() const {
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		return m_Evictions;
+	}
+
+	void ConfUnitCache::Evict() {
+		while (m_Size > m_Capacity && !m_Lru.empty()) {
+			Erase(m_Units.find({ m_Lru.back()->File, m_Lru.back()->Macros }));
+			++m_Evictions;
+		}
+	}
+
+	void ConfUnitCache::Collect(const ConfUnit* unit, std::vector<Stamp>& stamps) {
+		for (const auto& it : stamps) if (it.Unit == unit) return;
+		stamps.push_back({ unit, unit->FileSize, unit->WriteTime });
+		for (const auto& it : unit->Dependencies) Collect(it.get(), stamps);
+	}
+
+	void ConfUnitCache::Erase(std::map<Key_t, Lru_t::iterator>::iterator it) {
+		m_Size -= (*it->second)->Size;
+		m_Lru.erase(it->second);
+		m_Units.erase(it);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confunitcache.hpp
+ * \brief Process wide cache of parsed files related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace confparser {
+	/*!
+	 * \brief A file parsed alone in its own scope
+	 * 
+	 * Merged instances keep referencing the types of the unit, so a unit
+	 * holds the units it included and is shared by the trees it was merged in
+	*/
+	struct ConfUnit {
+		std::filesystem::path File;
+		std::uint64_t Hash = 0;
+
+		/*!
+		 * \brief Hash of the macros defined when the file was included, the
+		 *		  same file parses differently under other macros
+		 * \see ConfMacroTable::GetHash
+		*/
+		std::uint64_t Macros = 0;
+
+		/*!
+		 * \brief Stamps of File when hashed, refreshed by the cache under its
+		 *		  lock when a touched file is found unchanged
+		*/
+		mutable std::uintmax_t FileSize = 0;
+		mutable std::filesystem::file_time_type WriteTime;
+		ConfScope* Scope = nullptr;
+
+		/*!
+		 * \brief Memory used by Scope when inserted, in bytes
+		*/
+		std::size_t Size = 0;
+		std::vector<std::shared_ptr<const ConfUnit>> Dependencies;
+
+		/*!
+		 * \brief The %define directives run by the file and the files it
+		 *		  included, in order, replayed in the includer when cached
+		*/
+		std::vector<string_t> Defines;
+
+		ConfUnit() = default;
+		ConfUnit(const ConfUnit&) = delete;
+		ConfUnit& operator=(const ConfUnit&) = delete;
+		~ConfUnit();
+	};
+
+	/*!
+	 * \brief Process wide cache of file units, shared by every parser
+	 * 
+	 * Units are keyed by canonical path and macros, and checked against the
+	 * content hash: a file is parsed once however many times it is included
+	 * under the same macros, until its content changes.
+	 * The least recently used units are dropped when the estimated size
+	 * exceeds the capacity, the trees they were merged in keep them alive.
+	 * Units outlive the parsers building them, the intrinsic scope is not
+	 * released while units are cached. All the functions are thread safe.
+	 * 
+	 * \see ConfParser::SetIncludeCache
+	*/
+	class ConfUnitCache {
+		using Lru_t = std::list<std::shared_ptr<const ConfUnit>>;
+		using Key_t = std::pair<std::filesystem::path, std::uint64_t>;
+
+		/*!
+		 * \brief The stamps of a unit as read under the lock, checked out of it
+		*/
+		struct Stamp {
+			const ConfUnit* Unit;
+			std::uintmax_t FileSize;
+			std::filesystem::file_time_type WriteTime;
+			bool IsTouched = false;
+		};
+
+		Lru_t m_Lru;
+		std::map<Key_t, Lru_t::iterator> m_Units;
+		std::size_t m_Size;
+		std::size_t m_Capacity;
+		std::uint64_t m_Hits;
+		std::uint64_t m_Misses;
+		std::uint64_t m_Evictions;
+		mutable std::mutex m_Mutex;
+
+		ConfUnitCache() : m_Size{ 0 }, m_Capacity{ DEFAULT_CAPACITY }, m_Hits{ 0 },
+			m_Misses{ 0 }, m_Evictions{ 0 } {}
+
+		void Evict();
+
+		/*!
+		 * \brief Append the stamps of a unit and of the units it merged, once each
+		*/
+		static void Collect(const ConfUnit* unit, std::vector<Stamp>& stamps);
+		void Erase(std::map<Key_t, Lru_t::iterator>::iterator it);
+
+	public:
+		static constexpr std::size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+		static ConfUnitCache& Instance() {
+			static ConfUnitCache instance;
+			return instance;
+		}
+
+		/*!
+		 * \brief Get the unit of a file if its content and the content of the
+		 *		  files it includes are unchanged
+		 * 
+		 * The size and modification time of each file are checked first, the
+		 * content hash only if they differ. A stale included file makes the
+		 * unit stale. Counts a hit or a miss
+		 * \param file A canonical path
+		 * \param macros The hash of the macros defined at the inclusion
+		 * \return The unit, nullptr if none is up to date
+		*/
+		std::shared_ptr<const ConfUnit> Find(const std::filesystem::path& file, std::uint64_t macros);
+
+		/*!
+		 * \brief Add or replace the unit of a file under its macros then evict
+		 *		  if needed
+		*/
+		void Insert(std::shared_ptr<const ConfUnit> unit);
+
+		/*!
+		 * \brief Drop the units of a file, under any macros
+		 * \param file A canonical path
+		*/
+		void Invalidate(const std::filesystem::path& file);
+
+		/*!
+		 * \brief Drop every unit, the counters are kept
+		*/
+		void Clear();
+
+		/*!
+		 * \brief Set the maximum estimated size of the cached units, in bytes
+		*/
+		void SetCapacity(std::size_t capacity);
+
+		std::size_t GetCapacity() const;
+
+		/*!
+		 * \brief Get the estimated size of the cached units, in bytes
+		*/
+		std::size_t GetSize() const;
+
+		std::size_t GetCount() const;
+		std::uint64_t GetHits() const;
+		std::uint64_t GetMisses() const;
+		std::uint64_t GetEvictions() const;
+	};
+}
\ No newline at end of file
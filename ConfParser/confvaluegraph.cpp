@@ -0,0 +1,273 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confvaluegraph.cpp
+ * \brief Values dependency graph related implementations
+ */
+
+#include "confvaluegraph.hpp"
+#include "confscope.hpp"
+#include "confinstance.hpp"
+#include "confpath.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace confparser {
+	namespace {
+		bool isName(const string_t& token) {
+			return !token.empty() && (cp_isalnum(token[0]) || token[0] == CP_TEXT('_')) &&
+				(token[0] < CP_TEXT('0') || token[0] > CP_TEXT('9'));
+		}
+
+		/*!
+		 * \brief Check if reading a path depends on another: the same value,
+		 *		  a member of it or one of its owners
+		*/
+		bool overlaps(const string_t& read, const string_t& path) {
+			const std::size_t size = std::min(read.size(), path.size());
+			return read.compare(0, size, path, 0, size) == 0 &&
+				(read.size() == path.size() || (read.size() > size ? read[size] : path[size]) == CP_TEXT('.'));
+		}
+
+		string_t rootOf(const string_t& path) {
+			return path.substr(0, path.find(CP_TEXT('.')));
+		}
+
+		/*!
+		 * \brief Get a comparable snapshot of a value
+		*/
+		string_t valueOf(ConfScopeable* obj) {
+			if (!obj || obj->GetCodeObjectType() != CodeObjectType::INSTANCE) return {};
+			if (auto value = dynamic_cast<ConfInstanceInt*>(obj)) return cp_tostring(value->Get());
+			if (auto value = dynamic_cast<ConfInstanceFloat*>(obj)) return cp_tostring(value->Get());
+			if (auto value = dynamic_cast<ConfInstanceString*>(obj)) return value->Get();
+			string_t ret;
+			for (auto it : static_cast<ConfInstance*>(obj)->GetSubInstances())
+				ret += it->GetName() + CP_TEXT('=') + valueOf(it) + CP_TEXT(';');
+			return ret;
+		}
+	}
+
+	void ConfValueGraph::Record(ConfParser* parser, ConfScope* scope, const std::vector<string_t>& tokens) {
+		std::vector<string_t> statement;
+		for (const auto& it : tokens)
+			if (!it.empty()) statement.push_back(it);
+
+		//"name(.name)* = expression" only, compound assignations depend on the
+		//order of evaluation
+		std::size_t i{ 0 };
+		string_t target;
+		while (i < statement.size() && isName(statement[i])) {
+			target += statement[i++];
+			if (i < statement.size() && statement[i] == CP_TEXT(".")) target += statement[i++];
+			else break;
+		}
+		if (target.empty() || target.back() == CP_TEXT('.') || i + 1 >= statement.size() ||
+			statement[i] != CP_TEXT("="))
+			return;
+		statement.erase(statement.begin(), statement.begin() + i + 1);
+
+		Node node{ scope, target, parenthesisOperatorParser(statement), {} };
+		for (std::size_t j{ 0 }; j < statement.size(); ++j) {
+			if (!isName(statement[j]) || (j && statement[j - 1] == CP_TEXT("."))) continue;
+			string_t read = statement[j];
+			while (j + 2 < statement.size() && statement[j + 1] == CP_TEXT(".") && isName(statement[j + 2])) {
+				read += CP_TEXT('.') + statement[j + 2];
+				j += 2;
+			}
+			if (std::find(node.Reads.begin(), node.Reads.end(), read) == node.Reads.end())
+				node.Reads.push_back(std::move(read));
+		}
+
+		m_Parser = parser;
+		Graph& graph = m_Graphs[GetRootOf(scope)];
+		auto writer = graph.Writers.find(target);
+		std::size_t index;
+		if (writer == graph.Writers.end()) {
+			index = graph.Nodes.size();
+			graph.Nodes.push_back(std::move(node));
+			graph.Writers.emplace(target, index);
+		}
+		else {
+			index = writer->second;
+			graph.Nodes[index] = std::move(node);
+		}
+		for (const auto& read : graph.Nodes[index].Reads) {
+			auto& readers = graph.Readers[rootOf(read)];
+			if (std::find(readers.begin(), readers.end(), index) == readers.end()) readers.push_back(index);
+		}
+	}
+
+	std::vector<string_t> ConfValueGraph::Set(ConfScope* scope, const string_t& path, const string_t& expression) {
+		std::vector<string_t> changed;
+		m_Cycles.clear();
+		if (!m_Parser) {
+			//Nothing recorded, no parser to evaluate with
+			assert(false);
+			return changed;
+		}
+		const string_t before = valueOf(scope->GetByPath(path));
+		//Records the new statement through the parser
+		ConfScope* current = scope;
+		m_Parser->ParseLine(&current, path + CP_TEXT(" = ") + expression);
+		if (valueOf(scope->GetByPath(path)) == before) return changed;
+
+		changed.push_back(path);
+		Propagate(GetRootOf(scope), changed, 0);
+		return changed;
+	}
+
+	std::vector<string_t> ConfValueGraph::Update(ConfScope* root, const std::vector<string_t>& paths) {
+		std::vector<string_t> changed = paths;
+		m_Cycles.clear();
+		Propagate(GetRootOf(root), changed, paths.size());
+		changed.erase(changed.begin(), changed.begin() + paths.size());
+		return changed;
+	}
+
+	ConfScope* ConfValueGraph::GetRootOf(ConfScope* scope) {
+		const ConfScope* intrinsic = ConfParser::GetIntrinsicScope();
+		while (scope->GetParent() && scope->GetParent() != intrinsic) scope = scope->GetParent();
+		return scope;
+	}
+
+	std::vector<std::size_t> ConfValueGraph::GetReaders(const Graph& graph, const string_t& path) {
+		std::vector<std::size_t> ret;
+		auto it = graph.Readers.find(rootOf(path));
+		if (it == graph.Readers.end()) return ret;
+		for (std::size_t index : it->second) {
+			const Node& node = graph.Nodes[index];
+			if (std::any_of(node.Reads.begin(), node.Reads.end(),
+				[&path](const string_t& read) { return overlaps(read, path); }))
+				ret.push_back(index);
+		}
+		return ret;
+	}
+
+	void ConfValueGraph::Propagate(ConfScope* root, std::vector<string_t>& changed, std::size_t from) {
+		auto found = m_Graphs.find(root);
+		if (found == m_Graphs.end()) return;
+		const Graph& graph = found->second;
+
+		//Affected nodes and the number of affected nodes each one reads
+		std::unordered_map<std::size_t, std::size_t> pending;
+		std::vector<std::size_t> stack;
+		for (const auto& path : changed)
+			for (std::size_t index : GetReaders(graph, path)) stack.push_back(index);
+		while (!stack.empty()) {
+			const std::size_t index = stack.back();
+			stack.pop_back();
+			if (!pending.emplace(index, 0).second) continue;
+			for (std::size_t reader : GetReaders(graph, graph.Nodes[index].Target)) stack.push_back(reader);
+		}
+		for (const auto& it : pending)
+			for (std::size_t reader : GetReaders(graph, graph.Nodes[it.first].Target))
+				if (reader != it.first) ++pending[reader];
+
+		//Evaluated after their affected dependencies, skipped when none changed
+		std::vector<std::size_t> ready;
+		for (const auto& it : pending)
+			if (!it.second) ready.push_back(it.first);
+		std::unordered_set<std::size_t> evaluated;
+		while (evaluated.size() < pending.size()) {
+			if (ready.empty()) ready.push_back(BreakCycle(graph, pending, evaluated));
+			const std::size_t index = ready.back();
+			ready.pop_back();
+			evaluated.insert(index);
+			const Node& node = graph.Nodes[index];
+			const bool isDirty = std::any_of(node.Reads.begin(), node.Reads.end(), [&](const string_t& read) {
+				return std::any_of(changed.begin(), changed.end(),
+					[&read](const string_t& path) { return overlaps(read, path); });
+			});
+			if (isDirty) {
+				ConfScopeable* target = ConfPath{ node.Target }.ResolveForWrite(node.Scope);
+				if (target && target->GetCodeObjectType() == CodeObjectType::INSTANCE) {
+					const string_t before = valueOf(target);
+					ConfParenthesized_t expression = node.Expression;
+					m_Parser->RunInitializer(node.Scope, static_cast<ConfInstance*>(target), expression);
+					if (valueOf(target) != before) changed.push_back(node.Target);
+				}
+			}
+			for (std::size_t reader : GetReaders(graph, node.Target))
+				if (reader != index && !evaluated.count(reader) && !--pending[reader]) ready.push_back(reader);
+		}
+
+		if (m_Callback && changed.size() > from)
+			m_Callback(root, std::vector<string_t>(changed.begin() + from, changed.end()));
+	}
+
+	std::size_t ConfValueGraph::BreakCycle(const Graph& graph, const std::unordered_map<std::size_t, std::size_t>& pending,
+		const std::unordered_set<std::size_t>& evaluated) {
+		//Nodes left reachable from a node through the nodes left
+		auto reachable = [&](std::size_t from) {
+			std::unordered_set<std::size_t> ret;
+			std::vector<std::size_t> stack{ from };
+			while (!stack.empty()) {
+				const std::size_t index = stack.back();
+				stack.pop_back();
+				for (std::size_t reader : GetReaders(graph, graph.Nodes[index].Target)) {
+					if (reader == index || evaluated.count(reader) || !pending.count(reader)) continue;
+					if (ret.insert(reader).second) stack.push_back(reader);
+				}
+			}
+			return ret;
+		};
+
+		std::vector<std::size_t> left;
+		for (const auto& it : pending)
+			if (!evaluated.count(it.first)) left.push_back(it.first);
+		std::sort(left.begin(), left.end());
+		//The first recorded node of a cycle, the dependents of cycles are left
+		//to be evaluated after it
+		std::size_t ret = left.front();
+		for (std::size_t index : left) {
+			const auto cycle = reachable(index);
+			if (!cycle.count(index)) continue;
+			ret = index;
+			for (std::size_t it : left) {
+				if (!cycle.count(it) || !reachable(it).count(index)) continue;
+				if (std::find(m_Cycles.begin(), m_Cycles.end(), graph.Nodes[it].Target) == m_Cycles.end())
+					m_Cycles.push_back(graph.Nodes[it].Target);
+			}
+			break;
+		}
+		return ret;
+	}
+
+	std::vector<string_t> ConfValueGraph::GetDependencies(ConfScope* root, const string_t& path) const {
+		auto graph = m_Graphs.find(GetRootOf(root));
+		if (graph == m_Graphs.end()) return {};
+		auto it = graph->second.Writers.find(path);
+		return it == graph->second.Writers.end() ? std::vector<string_t>{} : graph->second.Nodes[it->second].Reads;
+	}
+
+	std::vector<string_t> ConfValueGraph::GetDependents(ConfScope* root, const string_t& path) const {
+		std::vector<string_t> ret;
+		auto found = m_Graphs.find(GetRootOf(root));
+		if (found == m_Graphs.end()) return ret;
+		const Graph& graph = found->second;
+		std::vector<std::size_t> stack = GetReaders(graph, path);
+		while (!stack.empty()) {
+			const Node& node = graph.Nodes[stack.back()];
+			stack.pop_back();
+			if (std::find(ret.begin(), ret.end(), node.Target) != ret.end()) continue;
+			ret.push_back(node.Target);
+			for (std::size_t reader : GetReaders(graph, node.Target)) stack.push_back(reader);
+		}
+		return ret;
+	}
+
+	std::size_t ConfValueGraph::GetCount() const {
+		std::size_t ret = 0;
+		for (const auto& it : m_Graphs) ret += it.second.Writers.size();
+		return ret;
+	}
+
+	void ConfValueGraph::Clear() {
+		m_Graphs.clear();
+		m_Cycles.clear();
+	}
+}
\ No newline at end of file
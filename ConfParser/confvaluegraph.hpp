@@ -0,0 +1,184 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confvaluegraph.hpp
+ * \brief Values dependency graph related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include "confparser.hpp"
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief Which values are computed from which others, to recompute only
+	 *		  the dependents of a changed value
+	 * 
+	 * Each "path = expression" statement evaluated in a scope (declarations
+	 * included, types excluded) records its target and the dotted paths its
+	 * expression reads. The last statement assigning a path is the one
+	 * evaluated again. Reading "a" depends on "a.b" and the opposite.
+	 * 
+	 * Statements are kept apart by root scope (the ancestor child of the
+	 * intrinsic scope), so several trees parsed with the same graph do not
+	 * share values. A root must be forgotten before it is deleted.
+	 * 
+	 * Values depending on themselves through other statements are evaluated
+	 * once per update, from the first recorded statement of their cycle, and
+	 * reported by GetCycles. Their dependents are evaluated after them.
+	 * \see ConfParser::SetValueGraph
+	*/
+	class ConfValueGraph {
+	public:
+		/*!
+		 * \brief Called with the paths whose value changed by an update, in
+		 *		  evaluation order
+		*/
+		using Callback_t = std::function<void(ConfScope* root, const std::vector<string_t>&)>;
+
+	private:
+		struct Node {
+			ConfScope* Scope;
+			string_t Target;
+			ConfParenthesized_t Expression;
+			std::vector<string_t> Reads;
+		};
+
+		/*!
+		 * \brief The statements recorded in a root
+		*/
+		struct Graph {
+			std::vector<Node> Nodes;
+
+			/*!
+			 * \brief Target path -> its node
+			*/
+			std::unordered_map<string_t, std::size_t> Writers;
+
+			/*!
+			 * \brief First name of a read path -> the nodes reading it, may
+			 *		  hold nodes which do not anymore
+			*/
+			std::unordered_map<string_t, std::vector<std::size_t>> Readers;
+		};
+
+		/*!
+		 * \brief The parser recording the statements, evaluates them again
+		*/
+		ConfParser* m_Parser = nullptr;
+		std::unordered_map<ConfScope*, Graph> m_Graphs;
+		Callback_t m_Callback;
+
+		/*!
+		 * \brief Targets of the cycles met by the last update
+		*/
+		std::vector<string_t> m_Cycles;
+
+		/*!
+		 * \brief Get the root scope of a scope, the graph it records in
+		*/
+		static ConfScope* GetRootOf(ConfScope* scope);
+
+		/*!
+		 * \brief Get the nodes of a graph directly reading a path
+		*/
+		static std::vector<std::size_t> GetReaders(const Graph& graph, const string_t& path);
+
+		/*!
+		 * \brief Evaluate again the dependents of changed paths
+		 * \param root The root of the changed paths
+		 * \param changed The changed paths, the changed dependents are added
+		 * \param from Number of paths of changed already reported
+		*/
+		void Propagate(ConfScope* root, std::vector<string_t>& changed, std::size_t from);
+
+		/*!
+		 * \brief Pick the node to evaluate when every node left waits for
+		 *		  another, records the targets of its cycle
+		 * \param graph The graph being updated
+		 * \param pending The affected nodes
+		 * \param evaluated The affected nodes already evaluated
+		 * \return The first recorded node of a cycle
+		*/
+		std::size_t BreakCycle(const Graph& graph, const std::unordered_map<std::size_t, std::size_t>& pending,
+			const std::unordered_set<std::size_t>& evaluated);
+
+	public:
+		/*!
+		 * \brief Record an evaluated statement
+		 * \param parser The parser evaluating it, must outlive the graph
+		 * \param scope The scope where it is
+		 * \param tokens The expanded tokens of the statement
+		*/
+		void Record(ConfParser* parser, ConfScope* scope, const std::vector<string_t>& tokens);
+
+		/*!
+		 * \brief Override a value and evaluate its dependents again
+		 * 
+		 * The expression replaces the statement assigning the path, its own
+		 * dependencies are recorded. Only the dependents of the root of scope
+		 * are evaluated
+		 * \param scope The scope where the path is declared
+		 * \param path The dotted path of the value
+		 * \param expression The new expression, evaluated in scope
+		 * \return The paths whose value changed, path first if it did
+		 * \see GetCycles
+		*/
+		std::vector<string_t> Set(ConfScope* scope, const string_t& path, const string_t& expression);
+
+		/*!
+		 * \brief Evaluate again the dependents of values changed by the host
+		 * \param root The root scope of the changed values
+		 * \param paths The changed paths
+		 * \return The dependents whose value changed
+		 * \see GetCycles
+		*/
+		std::vector<string_t> Update(ConfScope* root, const std::vector<string_t>& paths);
+
+		/*!
+		 * \brief Get the paths read by the statement assigning a path of a root
+		*/
+		std::vector<string_t> GetDependencies(ConfScope* root, const string_t& path) const;
+
+		/*!
+		 * \brief Get the targets of a root reading a path, directly or not
+		*/
+		std::vector<string_t> GetDependents(ConfScope* root, const string_t& path) const;
+
+		/*!
+		 * \brief Get the targets depending on themselves met by the last Set
+		 *		  or Update, empty if none
+		*/
+		const std::vector<string_t>& GetCycles() const {
+			return m_Cycles;
+		}
+
+		/*!
+		 * \brief Get the number of recorded targets, of every root
+		*/
+		std::size_t GetCount() const;
+
+		/*!
+		 * \brief Drop the statements recorded in a root, before deleting it
+		*/
+		void Forget(ConfScope* root) {
+			m_Graphs.erase(root);
+		}
+
+		void Clear();
+
+		/*!
+		 * \brief Be notified of the changes of Set and Update
+		*/
+		void SetCallback(Callback_t callback) {
+			m_Callback = std::move(callback);
+		}
+	};
+}
\ No newline at end of file
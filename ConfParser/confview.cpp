@@ -0,0 +1,118 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confview.cpp
+ * \brief Read only views over scope trees and compiled images related implementations
+ */
+
+#include "confview.hpp"
+#include "confscope.hpp"
+#include "conftype.hpp"
+#include "confinstance.hpp"
+
+namespace confparser {
+	string_view_t ConfNodeView::GetName() const {
+		if (!IsValid()) return {};
+		return IsImage() ? m_Image->GetString(Node().Name) : m_Object->GetNameView();
+	}
+
+	CodeObjectType ConfNodeView::GetKind() const {
+		if (!IsValid()) return CodeObjectType::NONE;
+		return IsImage() ? static_cast<CodeObjectType>(Node().Kind) : m_Object->GetCodeObjectType();
+	}
+
+	ConfScopeView ConfNodeView::AsScope() const {
+		switch (GetKind()) {
+		case CodeObjectType::SCOPE:
+		case CodeObjectType::TYPE:
+		case CodeObjectType::FUNCTION:
+			return IsImage() ? ConfScopeView{ m_Image, m_Index } : ConfScopeView{ m_Object };
+		default:
+			return {};
+		}
+	}
+
+	ConfInstanceView ConfNodeView::AsInstance() const {
+		if (GetKind() != CodeObjectType::INSTANCE) return {};
+		return IsImage() ? ConfInstanceView{ m_Image, m_Index } : ConfInstanceView{ m_Object };
+	}
+
+	ConfImageValue ConfValueView::GetKind() const {
+		if (!IsValid()) return ConfImageValue::NONE;
+		if (IsImage()) return Node().ValueKind;
+		const string_view_t type = static_cast<ConfInstance*>(m_Object)->GetType()->GetNameView();
+		if (type == NAME_TYPE_INT) return ConfImageValue::INT;
+		if (type == NAME_TYPE_FLOAT) return ConfImageValue::FLOAT;
+		if (type == NAME_TYPE_STRING) return ConfImageValue::STRING;
+		return ConfImageValue::NONE;
+	}
+
+	int ConfValueView::AsInt(int def) const {
+		if (GetKind() != ConfImageValue::INT) return def;
+		return IsImage() ? Node().Value.Int : static_cast<ConfInstanceInt*>(m_Object)->GetRef();
+	}
+
+	float ConfValueView::AsFloat(float def) const {
+		if (GetKind() != ConfImageValue::FLOAT) return def;
+		return IsImage() ? Node().Value.Float : static_cast<ConfInstanceFloat*>(m_Object)->GetRef();
+	}
+
+	string_view_t ConfValueView::AsString() const {
+		if (GetKind() != ConfImageValue::STRING) return {};
+		return IsImage() ? m_Image->GetString(Node().Value.String) :
+			string_view_t(static_cast<ConfInstanceString*>(m_Object)->GetRef());
+	}
+
+	ConfInstanceView::ConfInstanceView(ConfInstance* instance) : ConfNodeView{ instance } {}
+
+	string_view_t ConfInstanceView::GetTypeName() const {
+		if (!IsValid()) return {};
+		return IsImage() ? m_Image->GetString(Node().Type) :
+			static_cast<ConfInstance*>(m_Object)->GetType()->GetNameView();
+	}
+
+	ConfValueView ConfInstanceView::GetValue() const {
+		return IsImage() ? ConfValueView{ m_Image, m_Index } : ConfValueView{ m_Object };
+	}
+
+	std::size_t ConfInstanceView::GetMemberCount() const {
+		if (!IsValid()) return 0;
+		return IsImage() ? m_Image->GetChildCount(m_Index) : static_cast<ConfInstance*>(m_Object)->GetSubInstances().size();
+	}
+
+	ConfInstanceView ConfInstanceView::GetMember(std::size_t index) const {
+		if (IsImage()) return { m_Image, Node().FirstChild + static_cast<std::uint32_t>(index) };
+		return static_cast<ConfInstance*>(m_Object)->GetSubInstances()[index];
+	}
+
+	ConfInstanceView ConfInstanceView::FindMember(string_view_t name) const {
+		for (std::size_t i{ 0 }, count{ GetMemberCount() }; i < count; ++i) {
+			ConfInstanceView member = GetMember(i);
+			if (member.GetName() == name) return member;
+		}
+		return {};
+	}
+
+	ConfScopeView::ConfScopeView(ConfScope* scope) : ConfNodeView{ scope } {}
+
+	std::size_t ConfScopeView::GetChildCount() const {
+		if (!IsValid()) return 0;
+		return IsImage() ? m_Image->GetChildCount(m_Index) : static_cast<ConfScope*>(m_Object)->GetChilds().size();
+	}
+
+	ConfNodeView ConfScopeView::GetChild(std::size_t index) const {
+		if (IsImage()) return { m_Image, Node().FirstChild + static_cast<std::uint32_t>(index) };
+		return static_cast<ConfScope*>(m_Object)->GetChilds()[index];
+	}
+
+	ConfNodeView ConfScopeView::Find(string_view_t name) const {
+		for (std::size_t i{ 0 }, count{ GetChildCount() }; i < count; ++i) {
+			ConfNodeView child = GetChild(i);
+			if (child.GetName() == name) return child;
+		}
+		return {};
+	}
+}
\ No newline at end of file
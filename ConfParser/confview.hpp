@@ -0,0 +1,203 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confview.hpp
+ * \brief Read only views over scope trees and compiled images related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include "confimage.hpp"
+
+namespace confparser {
+	class ConfScopeView;
+	class ConfInstanceView;
+
+	/*!
+	 * \brief Non owning handle on an object of a parsed tree or of an image
+	 * 
+	 * Views are two words copied by value: an object pointer, or an image
+	 * and a node index. They never allocate and the names they give are
+	 * views on the tree or on the mapped file, valid while it lives and is
+	 * not modified. Functions are only seen in parsed trees, images do not
+	 * store them.
+	*/
+	class ConfNodeView {
+		friend class ConfValueView;
+		friend class ConfInstanceView;
+		friend class ConfScopeView;
+	protected:
+		/*!
+		 * \brief The active member is given by m_Index
+		 * \see IsImage
+		*/
+		union {
+			ConfScopeable* m_Object;
+			const ConfImage* m_Image;
+		};
+
+		/*!
+		 * \brief Node index in m_Image, CONF_IMAGE_NPOS for a parsed object
+		*/
+		std::uint32_t m_Index;
+
+		bool IsImage() const {
+			return m_Index != CONF_IMAGE_NPOS;
+		}
+
+		const ConfImageNode& Node() const {
+			return m_Image->GetNode(m_Index);
+		}
+
+	public:
+		ConfNodeView() : m_Object{ nullptr }, m_Index{ CONF_IMAGE_NPOS } {}
+		ConfNodeView(ConfScopeable* object) : m_Object{ object }, m_Index{ CONF_IMAGE_NPOS } {}
+		ConfNodeView(const ConfImage* image, std::uint32_t index) : m_Image{ image }, m_Index{ index } {}
+
+		/*!
+		 * \brief Check if the view designates an object, lookups return
+		 *		  invalid views when nothing is found
+		*/
+		bool IsValid() const {
+			if (!IsImage()) return m_Object != nullptr;
+			return m_Image && m_Image->IsOpen() && m_Index < m_Image->GetNodeCount();
+		}
+
+		explicit operator bool() const {
+			return IsValid();
+		}
+
+		string_view_t GetName() const;
+
+		/*!
+		 * \brief Get the object type, NONE if invalid
+		*/
+		CodeObjectType GetKind() const;
+
+		/*!
+		 * \brief View a scope, a type or a function as a scope, invalid otherwise
+		*/
+		ConfScopeView AsScope() const;
+
+		/*!
+		 * \brief View an instance as such, invalid otherwise
+		*/
+		ConfInstanceView AsInstance() const;
+	};
+
+	/*!
+	 * \brief Raw value of an intrinsic instance
+	*/
+	class ConfValueView : public ConfNodeView {
+	public:
+		using ConfNodeView::ConfNodeView;
+
+		/*!
+		 * \brief Get the raw value kind, NONE for non intrinsic instances
+		*/
+		ConfImageValue GetKind() const;
+
+		int AsInt(int def = 0) const;
+		float AsFloat(float def = 0.f) const;
+
+		/*!
+		 * \brief Get a string value without copying it, empty if not a string
+		*/
+		string_view_t AsString() const;
+	};
+
+	/*!
+	 * \brief View of an instance and its members
+	*/
+	class ConfInstanceView : public ConfNodeView {
+	public:
+		using ConfNodeView::ConfNodeView;
+		ConfInstanceView(ConfInstance* instance);
+
+		string_view_t GetTypeName() const;
+
+		ConfValueView GetValue() const;
+
+		std::size_t GetMemberCount() const;
+
+		/*!
+		 * \brief Get a member, index must be lower than GetMemberCount
+		*/
+		ConfInstanceView GetMember(std::size_t index) const;
+
+		/*!
+		 * \brief Find a member by its name
+		*/
+		ConfInstanceView FindMember(string_view_t name) const;
+	};
+
+	/*!
+	 * \brief View of a scope and its childs
+	*/
+	class ConfScopeView : public ConfNodeView {
+	public:
+		using ConfNodeView::ConfNodeView;
+		ConfScopeView(ConfScope* scope);
+
+		/*!
+		 * \brief View the root scope of an image
+		*/
+		ConfScopeView(const ConfImage& image) : ConfNodeView{ image.IsOpen() ? &image : nullptr, 0 } {}
+
+		std::size_t GetChildCount() const;
+
+		/*!
+		 * \brief Get a child, index must be lower than GetChildCount
+		*/
+		ConfNodeView GetChild(std::size_t index) const;
+
+		/*!
+		 * \brief Find a child by its name, upper scopes are not searched
+		*/
+		ConfNodeView Find(string_view_t name) const;
+
+		ConfScopeView FindScope(string_view_t name) const {
+			return Find(name).AsScope();
+		}
+
+		ConfInstanceView FindInstance(string_view_t name) const {
+			return Find(name).AsInstance();
+		}
+
+		class Iterator;
+
+		Iterator begin() const;
+		Iterator end() const;
+	};
+
+	class ConfScopeView::Iterator {
+		ConfScopeView m_Scope;
+		std::size_t m_Index;
+	public:
+		Iterator(ConfScopeView scope, std::size_t index) : m_Scope{ scope }, m_Index{ index } {}
+
+		ConfNodeView operator*() const {
+			return m_Scope.GetChild(m_Index);
+		}
+
+		Iterator& operator++() {
+			++m_Index;
+			return *this;
+		}
+
+		bool operator!=(const Iterator& other) const {
+			return m_Index != other.m_Index;
+		}
+	};
+
+	inline ConfScopeView::Iterator ConfScopeView::begin() const {
+		return { *this, 0 };
+	}
+
+	inline ConfScopeView::Iterator ConfScopeView::end() const {
+		return { *this, GetChildCount() };
+	}
+}
\ No newline at end of file
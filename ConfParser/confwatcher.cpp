@@ -0,0 +1,269 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confwatcher.cpp
+ * \brief Hot reload related implementations
+ */
+
+#include "confwatcher.hpp"
+#include "confscope.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace confparser {
+	namespace {
+		std::filesystem::file_time_type writeTime(const std::filesystem::path& file) {
+			std::error_code ec;
+			auto ret = std::filesystem::last_write_time(file, ec);
+			return ec ? std::filesystem::file_time_type::min() : ret;
+		}
+
+		std::vector<string_t> readLines(const std::filesystem::path& file) {
+			std::vector<string_t> ret{ {} };
+			ifstream_t ifs{ file };
+			osstream_t sstream;
+			if (ifs) sstream << ifs.rdbuf();
+			for (auto ch : sstream.str()) {
+				if (ch == CP_TEXT('\r')) continue;
+				if (ch == CP_TEXT('\n')) ret.emplace_back();
+				else ret.back().push_back(ch);
+			}
+			return ret;
+		}
+
+		/*!
+		 * \brief Get the file included by a %use or %default line, tokenized as
+		 *		  the parser does
+		*/
+		bool includedFile(string_t line, std::filesystem::path& file) {
+			trim(line);
+			if (line.empty() || line[0] != TOKEN_CHAR_SPECIAL) return false;
+			auto tokens = filtersplit(line, { " =#%+-*/.", {false}, true }, true, true);
+			if (tokens.size() < 3 || (tokens[1] != TOKEN_STRING_SPECIAL_USE && tokens[1] != TOKEN_STRING_SPECIAL_DEFAULT))
+				return false;
+			unStringify(tokens[2]);
+			file = ConfParser::CanonicalPath(tokens[2]);
+			return true;
+		}
+
+		string_t joinLines(const std::vector<string_t>& lines, std::size_t begin, std::size_t end) {
+			string_t ret;
+			for (std::size_t i{ begin }; i < end; ++i) {
+				if (i != begin) ret.push_back(CP_TEXT('\n'));
+				ret += lines[i];
+			}
+			return ret;
+		}
+	}
+
+	ConfWatcher::Generation::~Generation() {
+		for (auto it : Types) CP_SF(it);
+	}
+
+	ConfWatcher::ConfWatcher(std::filesystem::path file, StringFormater_t format) :
+		m_File{ ConfParser::CanonicalPath(file) }, m_Evaluated{ 0 }, m_Notify{ -1 } {
+#ifdef __linux__
+		m_Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+		std::vector<string_t> lines;
+		std::vector<std::filesystem::path> including;
+		Flatten(m_File, lines, m_Regions, including);
+		m_Document = std::make_shared<ConfDocument>(joinLines(lines, 0, lines.size()), format);
+		m_Document->SetKeepTypes(true);
+		m_Generation = std::make_shared<Generation>();
+		m_Generation->Document = m_Document;
+		Publish();
+	}
+
+	ConfWatcher::~ConfWatcher() {
+#ifdef __linux__
+		if (m_Notify >= 0) close(m_Notify);
+#endif
+	}
+
+	bool ConfWatcher::Read(const std::filesystem::path& file) {
+		auto it = m_Sources.find(file);
+		const bool isNew = it == m_Sources.end();
+		if (isNew) {
+			it = m_Sources.emplace(file, Source{}).first;
+			Watch(file);
+		}
+		it->second.WriteTime = writeTime(file);
+		auto lines = readLines(file);
+		if (!isNew && lines == it->second.Lines) return false;
+		it->second.Lines = std::move(lines);
+		return true;
+	}
+
+	void ConfWatcher::Flatten(const std::filesystem::path& file, std::vector<string_t>& lines,
+		std::vector<Region>& regions, std::vector<std::filesystem::path>& including) {
+		if (m_Sources.find(file) == m_Sources.end()) Read(file);
+		const std::size_t region = regions.size();
+		regions.push_back({ file, lines.size(), 0 });
+		m_Graph[file].clear();
+		m_Cycles.erase(file);
+
+		including.push_back(file);
+		//Reading included files inserts sources
+		const std::vector<string_t> source = m_Sources[file].Lines;
+		for (const auto& it : source) {
+			std::filesystem::path included;
+			if (!includedFile(it, included)) {
+				lines.push_back(it);
+				continue;
+			}
+			m_Graph[file].push_back(included);
+			if (std::find(including.begin(), including.end(), included) != including.end()) {
+				//Include cycle, the line keeps its place
+				m_Cycles[file].push_back(included);
+				lines.emplace_back();
+				continue;
+			}
+			Flatten(included, lines, regions, including);
+		}
+		including.pop_back();
+		regions[region].End = lines.size();
+	}
+
+	std::size_t ConfWatcher::Relayout(std::size_t index) {
+		const Region old = m_Regions[index];
+		//The regions nested in the old one and the ones including it
+		std::size_t last = index + 1;
+		while (last < m_Regions.size() && m_Regions[last].Begin < old.End) ++last;
+		std::vector<std::filesystem::path> including;
+		for (std::size_t i{ 0 }; i < index; ++i) {
+			if (m_Regions[i].End >= old.End) including.push_back(m_Regions[i].File);
+		}
+
+		std::vector<string_t> lines;
+		std::vector<Region> regions;
+		Flatten(old.File, lines, regions, including);
+		m_Evaluated += m_Document->Edit({ { old.Begin, 0 }, { old.End - 1, string_t::npos },
+			joinLines(lines, 0, lines.size()) });
+
+		const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(lines.size()) -
+			static_cast<std::ptrdiff_t>(old.End - old.Begin);
+		for (std::size_t i{ 0 }; i < index; ++i) {
+			if (m_Regions[i].End >= old.End) m_Regions[i].End += delta;
+		}
+		for (std::size_t i{ last }; i < m_Regions.size(); ++i) {
+			m_Regions[i].Begin += delta;
+			m_Regions[i].End += delta;
+		}
+		for (auto& it : regions) {
+			it.Begin += old.Begin;
+			it.End += old.Begin;
+		}
+		m_Regions.erase(m_Regions.begin() + index, m_Regions.begin() + last);
+		m_Regions.insert(m_Regions.begin() + index, regions.begin(), regions.end());
+		return index + regions.size();
+	}
+
+	void ConfWatcher::Prune() {
+		std::set<std::filesystem::path> included;
+		for (const auto& it : m_Regions) included.insert(it.File);
+		for (auto it = m_Sources.begin(); it != m_Sources.end();) {
+			if (included.count(it->first)) ++it;
+			else it = m_Sources.erase(it);
+		}
+		for (auto it = m_Graph.begin(); it != m_Graph.end();) {
+			if (included.count(it->first)) ++it;
+			else it = m_Graph.erase(it);
+		}
+		for (auto it = m_Cycles.begin(); it != m_Cycles.end();) {
+			if (included.count(it->first)) ++it;
+			else it = m_Cycles.erase(it);
+		}
+	}
+
+	void ConfWatcher::Publish() {
+		auto removed = m_Document->TakeRemovedTypes();
+		if (!removed.empty()) {
+			//The previous roots keep the removed types, the next ones reference the new ones
+			m_Generation->Types = std::move(removed);
+			m_Generation = std::make_shared<Generation>();
+			m_Generation->Document = m_Document;
+		}
+
+		ConfScope* source = m_Document->GetRoot();
+		ConfScope* root = static_cast<ConfScope*>(source->Clone(source->GetName()));
+		//Readers only look up, nothing is left to build on their threads
+		root->MaterializeTypes();
+		root->EvaluateInitializers();
+		std::shared_ptr<ConfScope> published{ root, [generation = m_Generation](ConfScope* it) { delete it; } };
+		std::atomic_store(&m_Root, published);
+		if (m_Callback) m_Callback(published);
+	}
+
+	bool ConfWatcher::Reload(const std::set<std::filesystem::path>& files) {
+		std::set<std::filesystem::path> changed;
+		for (const auto& it : files)
+			if (m_Sources.find(it) != m_Sources.end() && Read(it)) changed.insert(it);
+		if (changed.empty()) return false;
+
+		//The regions of the changed files not nested in another one, the layout
+		//out of them is unchanged. Nested ones are flattened with their includer
+		m_Evaluated = 0;
+		for (std::size_t i{ 0 }; i < m_Regions.size();) {
+			if (changed.count(m_Regions[i].File)) i = Relayout(i);
+			else ++i;
+		}
+		Prune();
+		Publish();
+		return true;
+	}
+
+	bool ConfWatcher::Poll(int timeout) {
+		return Reload(ChangedFiles(timeout));
+	}
+
+	void ConfWatcher::Watch(const std::filesystem::path& file) {
+#ifdef __linux__
+		if (m_Notify < 0) return;
+		auto dir = file.parent_path();
+		int wd = inotify_add_watch(m_Notify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd >= 0) m_Watches[wd] = std::move(dir);
+#endif
+	}
+
+	std::set<std::filesystem::path> ConfWatcher::ChangedFiles(int timeout) {
+		std::set<std::filesystem::path> ret;
+#ifdef __linux__
+		if (m_Notify >= 0) {
+			pollfd pfd{ m_Notify, POLLIN, 0 };
+			if (poll(&pfd, 1, timeout) <= 0) return ret;
+
+			alignas(inotify_event) char buffer[4096];
+			ssize_t len;
+			while ((len = read(m_Notify, buffer, sizeof(buffer))) > 0) {
+				for (char* ptr = buffer; ptr < buffer + len;) {
+					const inotify_event* ev = reinterpret_cast<const inotify_event*>(ptr);
+					ptr += sizeof(inotify_event) + ev->len;
+					auto dir = m_Watches.find(ev->wd);
+					if (!ev->len || dir == m_Watches.end()) continue;
+					auto file = dir->second / ev->name;
+					if (m_Sources.find(file) != m_Sources.end()) ret.insert(std::move(file));
+				}
+			}
+			return ret;
+		}
+#endif
+		if (timeout > 0) std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+		for (const auto& it : m_Sources) {
+			if (writeTime(it.first) != it.second.WriteTime) ret.insert(it.first);
+		}
+		return ret;
+	}
+}
\ No newline at end of file
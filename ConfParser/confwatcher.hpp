@@ -0,0 +1,225 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*!
+ * \file confwatcher.hpp
+ * \brief Hot reload related definitions
+ */
+
+#pragma once
+#include "global.hpp"
+#include "confparser.hpp"
+#include "confdocument.hpp"
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace confparser {
+	/*!
+	 * \brief Watch a conf source file and its includes and reload them on change
+	 *
+	 * The include graph is flattened into one ConfDocument: each %use or
+	 * %default line is replaced by the lines of the included file, so a file
+	 * sees the declarations of the files including it, as with Parse. When
+	 * files change, only their lines are flattened again and replaced in the
+	 * document, which evaluates again the statements of these files and the
+	 * statements reading a name they declare or write. The other statements
+	 * are not run again, see ConfDocument for the edits falling back to a
+	 * full evaluation (conditional blocks, classes).
+	 *
+	 * Each reload publishes a new root, a copy of the document, swapped
+	 * atomically with the previous one. A root got from GetRoot stays valid
+	 * and unchanged as long as it is held, readers on other threads never
+	 * see a reload in progress. The types its instances reference are kept
+	 * with it. Writes of the host to a published root are not carried to the
+	 * next one: the sources are the reference.
+	 *
+	 * An include cycle is reported by GetIncludeCycles, the %use line closing
+	 * it is left empty.
+	 *
+	 * Changes are reported by inotify on Linux, other platforms compare the
+	 * files modification times on each poll.
+	 *
+	 * \see ConfDocument
+	*/
+	class ConfWatcher {
+	public:
+		/*!
+		 * \brief Called with the new root each time one is published, on the
+		 *		  thread of Poll and Reload
+		*/
+		using ReloadCallback_t = std::function<void(const std::shared_ptr<ConfScope>&)>;
+
+		/*!
+		 * \brief Parse the file and its includes and start watching them
+		 * \param file The path to the root source file
+		 * \param format [NOT IMPLEMENTED, DEPRECATED] A static line pre-formater
+		*/
+		ConfWatcher(std::filesystem::path file, StringFormater_t format = nullptr);
+		~ConfWatcher();
+
+		ConfWatcher(const ConfWatcher&) = delete;
+		ConfWatcher& operator=(const ConfWatcher&) = delete;
+
+		/*!
+		 * \brief Get the last published root, safe to call from any thread
+		*/
+		std::shared_ptr<ConfScope> GetRoot() const {
+			return std::atomic_load(&m_Root);
+		}
+
+		void SetReloadCallback(ReloadCallback_t callback) {
+			m_Callback = std::move(callback);
+		}
+
+		/*!
+		 * \brief Get the include graph of the watched files: file -> files it
+		 *		  includes, in order
+		*/
+		const ConfParser::DependencyGraph_t& GetIncludeGraph() const {
+			return m_Graph;
+		}
+
+		/*!
+		 * \brief Get the include cycles: file -> files it includes which
+		 *		  include it back, their %use lines are ignored
+		*/
+		const ConfParser::DependencyGraph_t& GetIncludeCycles() const {
+			return m_Cycles;
+		}
+
+		/*!
+		 * \brief Get the number of statements evaluated by the last reload
+		*/
+		std::size_t GetEvaluatedCount() const {
+			return m_Evaluated;
+		}
+
+		/*!
+		 * \brief Wait for file changes and reload the changed files
+		 * \param timeout Maximum wait in milliseconds, 0 to return immediately
+		 * \return If a new root has been published
+		*/
+		bool Poll(int timeout = 0);
+
+		/*!
+		 * \brief Reload files and publish a new root
+		 * \param files Canonical paths of the changed files, unknown and
+		 *		  unchanged ones are ignored
+		 * \return If a new root has been published
+		*/
+		bool Reload(const std::set<std::filesystem::path>& files);
+
+	private:
+		/*!
+		 * \brief A watched file
+		*/
+		struct Source {
+			std::vector<string_t> Lines;
+			std::filesystem::file_time_type WriteTime;
+		};
+
+		/*!
+		 * \brief The lines [Begin, End) of the document coming from a file and
+		 *		  the files it includes
+		*/
+		struct Region {
+			std::filesystem::path File;
+			std::size_t Begin;
+			std::size_t End;
+		};
+
+		/*!
+		 * \brief The types referenced by the roots published between two
+		 *		  full evaluations of the document
+		 *
+		 * Held by these roots, the document lives as long as one of them
+		*/
+		struct Generation {
+			std::shared_ptr<ConfDocument> Document;
+			std::vector<ConfScopeable*> Types;
+
+			~Generation();
+		};
+
+		/*!
+		 * \brief Read a file and watch it
+		 * \param file Canonical path of the file
+		 * \return If its lines changed
+		*/
+		bool Read(const std::filesystem::path& file);
+
+		/*!
+		 * \brief Append the lines of a file, its includes replaced by their lines
+		 * \param file Canonical path of the file
+		 * \param lines The document lines
+		 * \param regions Receives the regions of the file and its includes
+		 * \param including The files being flattened, to detect include cycles
+		*/
+		void Flatten(const std::filesystem::path& file, std::vector<string_t>& lines,
+			std::vector<Region>& regions, std::vector<std::filesystem::path>& including);
+
+		/*!
+		 * \brief Flatten again a changed region and replace its lines in the document
+		 * \param index The index of the region in m_Regions
+		 * \return The index of the region following the new ones
+		*/
+		std::size_t Relayout(std::size_t index);
+
+		/*!
+		 * \brief Forget the files no longer included
+		*/
+		void Prune();
+
+		/*!
+		 * \brief Publish a copy of the document root
+		*/
+		void Publish();
+
+		/*!
+		 * \brief Register the directory of a file to the change notifications
+		*/
+		void Watch(const std::filesystem::path& file);
+
+		/*!
+		 * \brief Collect the watched files changed since the last call
+		 * \param timeout Maximum wait in milliseconds
+		*/
+		std::set<std::filesystem::path> ChangedFiles(int timeout);
+
+		std::filesystem::path m_File;
+		std::shared_ptr<ConfDocument> m_Document;
+		std::shared_ptr<Generation> m_Generation;
+
+		/*!
+		 * \brief The last published root, accessed atomically
+		*/
+		std::shared_ptr<ConfScope> m_Root;
+
+		ReloadCallback_t m_Callback;
+		std::map<std::filesystem::path, Source> m_Sources;
+		ConfParser::DependencyGraph_t m_Graph;
+		ConfParser::DependencyGraph_t m_Cycles;
+		std::size_t m_Evaluated;
+
+		/*!
+		 * \brief The regions of the document, in order of their first line
+		*/
+		std::vector<Region> m_Regions;
+
+		/*!
+		 * \brief inotify descriptor, -1 when polling modification times
+		*/
+		int m_Notify;
+
+		/*!
+		 * \brief Watched directories by watch descriptor
+		*/
+		std::map<int, std::filesystem::path> m_Watches;
+	};
+}
\ No newline at end of file
@@ -10,6 +10,11 @@
 
 #pragma once
 #include <unordered_map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
 
 #ifdef UNICODE
 #define CP_CHAR_T wchar_t
@@ -42,16 +47,25 @@ namespace confparser {
 	class ConfFunctionIntrinsic;
 	class ConfInstance;
 	class ConfType;
+	class ConfTypeIntrinsic;
+	class ConfPathCache;
+	class ConfTypeStubs;
+	struct ConfTypeStub;
+	class ConfInitializers;
+	struct ConfInitializer;
+	class ConfValueGraph;
+	class ConfMacroTable;
 
 	using char_t = CP_CHAR_T;
 	using string_t = std::basic_string<char_t>;
+	using string_view_t = std::basic_string_view<char_t>;
 	using ifstream_t = std::basic_ifstream<char_t>;
 	using osstream_t = std::basic_ostringstream<char_t>;
 
 	using StringFormater_t = string_t(*)(string_t); //No reference for C# easy compatibility !
 
 	using ApplySpecialFunction_t = void(*)(ConfParser*, ConfScope*,
-		const std::vector<string_t>&, StringFormater_t);
+		const std::vector<string_t>&, const string_t&, StringFormater_t);
 	using ApplyKeywordFunction_t = void(*)(ConfParser*, ConfScope**,
 		const std::vector<string_t>&);
 
@@ -68,6 +82,12 @@ namespace confparser {
 	constexpr char_t TOKEN_STRING_SPECIAL_DEFAULT[] = CP_TEXT("default");
 	constexpr char_t TOKEN_STRING_SPECIAL_DEFINE[] = CP_TEXT("define");
 	constexpr char_t TOKEN_STRING_SPECIAL_TYPE[] = CP_TEXT("type");
+	constexpr char_t TOKEN_STRING_SPECIAL_IF[] = CP_TEXT("if");
+	constexpr char_t TOKEN_STRING_SPECIAL_IFDEF[] = CP_TEXT("ifdef");
+	constexpr char_t TOKEN_STRING_SPECIAL_IFNDEF[] = CP_TEXT("ifndef");
+	constexpr char_t TOKEN_STRING_SPECIAL_ELIF[] = CP_TEXT("elif");
+	constexpr char_t TOKEN_STRING_SPECIAL_ELSE[] = CP_TEXT("else");
+	constexpr char_t TOKEN_STRING_SPECIAL_ENDIF[] = CP_TEXT("endif");
 	constexpr char_t TOKEN_STRING_PREFIX_OPERATOR[] = CP_TEXT("operator");
 	constexpr char_t TOKEN_STRING_PREFIX_FUNCTION[] = CP_TEXT("function");
 
@@ -82,6 +102,15 @@ namespace confparser {
 		NONE //Used in filters or error detection
 	};
 
+	/*!
+	 * \brief Hash a byte buffer (FNV-1a 64 bits)
+	 * \param data The bytes to hash
+	 * \param size The number of bytes
+	 * \param hash The hash to continue from, allows hashing in several calls
+	*/
+	std::uint64_t hashBytes(const void* data, std::size_t size,
+		std::uint64_t hash = 0xcbf29ce484222325ull);
+
 	/*!
 	 * \brief Remove any \r char
 	 * \param str String where to remove chars
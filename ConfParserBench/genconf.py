@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+"""Generate synthetic conf workloads for ConfParserBench.
+
+Each workload is a directory holding a main.conf (and the files it
+includes). The benchmark parses every <out>/<workload>/main.conf.
+
+    genconf.py --out workloads --scale 1
+"""
+
+import argparse
+import os
+import random
+
+
+def write(path, lines, newline="\n"):
+    with open(path, "w", newline="") as f:
+        f.write(newline.join(lines) + newline)
+
+
+def wide(n):
+    """One scope with many declarations"""
+    return ["int v%d = %d" % (i, i) for i in range(2000 * n)]
+
+
+def deep(n):
+    """Classes nested in classes, then instances at each level"""
+    depth = 32 * n
+    lines = []
+    for d in range(depth):
+        lines.append("class L%d {" % d)
+        lines.append("int v%d = %d" % (d, d))
+        lines.append("string s%d = \"level %d\"" % (d, d))
+    for d in range(depth):
+        lines.append("}")
+    lines.append("L0 root")
+    return lines
+
+
+def classes(n):
+    """Many classes, each holding an instance of the previous one.
+
+    The language has no in-code inheritance yet, class chains are built
+    by composition."""
+    lines = []
+    count = 200 * n
+    for c in range(count):
+        lines.append("class C%d {" % c)
+        for m in range(4):
+            lines.append("int m%d = %d" % (m, m))
+        lines.append("string name = \"C%d\"" % c)
+        if c:
+            lines.append("C%d base" % (c - 1))
+        lines.append("}")
+    for c in range(count):
+        lines.append("C%d c%d" % (c, c))
+        lines.append("c%d.m0 = %d" % (c, c))
+    return lines
+
+
+def chains(n, rng):
+    """Long arithmetic expressions with parenthesis
+
+    Binary '-' is not tokenized by the parser yet, chains use '+' and '*'"""
+    lines = []
+    for i in range(500 * n):
+        expr = str(rng.randint(1, 9))
+        for j in range(31):
+            operand = str(rng.randint(1, 9))
+            if j % 8 == 7:
+                operand = "(%s + %d)" % (operand, rng.randint(1, 9))
+            expr += " %s %s" % ("*" if j % 4 == 3 else "+", operand)
+        lines.append("int e%d = %s" % (i, expr))
+    return lines
+
+
+def includes(n, out):
+    """Layered include graph, every file includes the whole next layer"""
+    layers, width = 3 + n, 3
+    for layer in reversed(range(layers)):
+        for j in range(width):
+            prefix = "f%d_%d" % (layer, j)
+            lines = []
+            if layer + 1 < layers:
+                lines += ["%%use \"f%d_%d.conf\"" % (layer + 1, k) for k in range(width)]
+            lines += ["int %s_v%d = %d" % (prefix, i, i) for i in range(20)]
+            if layer + 1 < layers:
+                lines.append("int %s_sum = %s" % (prefix, " + ".join(
+                    "f%d_%d_v0" % (layer + 1, k) for k in range(width))))
+            write(os.path.join(out, prefix + ".conf"), lines)
+    return ["%%use \"f0_%d.conf\"" % k for k in range(width)] + ["int total = f0_0_v1 + f0_1_v1"]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--out", default="workloads", help="output directory")
+    parser.add_argument("--scale", type=int, default=1, help="workloads size multiplier")
+    parser.add_argument("--seed", type=int, default=42, help="random seed")
+    args = parser.parse_args()
+    rng = random.Random(args.seed)
+
+    def workload(name):
+        path = os.path.join(args.out, name)
+        os.makedirs(path, exist_ok=True)
+        return path
+
+    write(os.path.join(workload("wide"), "main.conf"), wide(args.scale))
+    write(os.path.join(workload("wide_crlf"), "main.conf"), wide(args.scale), "\r\n")
+    write(os.path.join(workload("deep"), "main.conf"), deep(args.scale))
+    write(os.path.join(workload("classes"), "main.conf"), classes(args.scale))
+    write(os.path.join(workload("chains"), "main.conf"), chains(args.scale, rng))
+    path = workload("includes")
+    write(os.path.join(path, "main.conf"), includes(args.scale, path))
+
+
+if __name__ == "__main__":
+    main()
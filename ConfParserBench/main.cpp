@@ -0,0 +1,288 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*
+ * ConfParser benchmarks
+ *
+ * Parses every <workloads>/<name>/main.conf generated by genconf.py end to
+ * end then micro-benchmarks the parser stages. Results are printed as a
+ * table and optionally written as JSON to track regressions:
+ *
+ *     ConfParserBench [--workloads dir] [--samples n] [--filter text] [--json file|-]
+ *
+ * The parse_batch cases share the intrinsic scope and the unit cache
+ * between threads, build with -fsanitize=thread and run them alone with
+ * --filter parse_batch to check ParseBatch for data races.
+ */
+
+#include <ConfParser/confparser.hpp>
+#include <ConfParser/confscope.hpp>
+#include <ConfParser/conftype.hpp>
+#include <ConfParser/confinstance.hpp>
+#include <ConfParser/confdiff.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace confparser;
+
+namespace {
+	struct Options {
+		std::filesystem::path Workloads = "workloads";
+		std::size_t Samples = 10;
+		std::string Filter;
+		std::string Json;
+	};
+
+	struct Result {
+		std::string Name;
+		std::size_t Iterations;
+		double Min, Median, Mean;
+		std::uintmax_t Bytes;
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	/*
+	 * Results written here are observable, the calls computing them are kept
+	 */
+	const void* volatile sink;
+
+	void doNotOptimize(const void* result) {
+		sink = result;
+	}
+
+	/*
+	 * Run fn in samples of a calibrated number of iterations, each sample
+	 * lasting at least 10ms. Times are in nanoseconds per iteration
+	 */
+	Result measure(const std::string& name, const Options& options, std::uintmax_t bytes,
+		const std::function<void()>& fn) {
+		fn(); //Warm up
+		std::size_t iterations = 1;
+		for (;;) {
+			auto start = Clock::now();
+			for (std::size_t i{ 0 }; i < iterations; ++i) fn();
+			if (Clock::now() - start >= std::chrono::milliseconds(10) || iterations >= (1u << 24)) break;
+			iterations *= 2;
+		}
+
+		std::vector<double> samples;
+		for (std::size_t s{ 0 }; s < options.Samples; ++s) {
+			auto start = Clock::now();
+			for (std::size_t i{ 0 }; i < iterations; ++i) fn();
+			samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+		}
+		std::sort(samples.begin(), samples.end());
+		double mean = 0;
+		for (auto it : samples) mean += it;
+		return { name, iterations, samples.front(), samples[samples.size() / 2], mean / samples.size(), bytes };
+	}
+
+	std::string jsonEscape(const std::string& str) {
+		std::string ret;
+		for (char ch : str) {
+			if (ch == '"' || ch == '\\') ret += '\\';
+			ret += ch;
+		}
+		return ret;
+	}
+
+	void writeJson(std::ostream& os, const std::vector<Result>& results) {
+#if defined(_MSC_VER)
+		const std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__VERSION__)
+		const std::string compiler = __VERSION__;
+#else
+		const std::string compiler = "unknown";
+#endif
+#ifdef NDEBUG
+		const char* build = "release";
+#else
+		const char* build = "debug";
+#endif
+		os << std::fixed << std::setprecision(1) << "{\n  \"schema\": 1,\n  \"compiler\": \"" << jsonEscape(compiler) << "\",\n  \"build\": \""
+			<< build << "\",\n  \"unit\": \"ns/op\",\n  \"benchmarks\": [";
+		for (std::size_t i{ 0 }; i < results.size(); ++i) {
+			const Result& r = results[i];
+			os << (i ? "," : "") << "\n    {\"name\": \"" << jsonEscape(r.Name) << "\", \"iterations\": " << r.Iterations
+				<< ", \"min\": " << r.Min << ", \"median\": " << r.Median << ", \"mean\": " << r.Mean
+				<< ", \"bytes\": " << r.Bytes << "}";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+	std::uintmax_t directorySize(const std::filesystem::path& dir) {
+		std::uintmax_t ret = 0;
+		for (const auto& it : std::filesystem::directory_iterator(dir))
+			if (it.is_regular_file() && it.path().extension() == ".conf") ret += it.file_size();
+		return ret;
+	}
+
+	string_t repeat(const string_t& str, std::size_t count, const string_t& separator) {
+		string_t ret;
+		for (std::size_t i{ 0 }; i < count; ++i) {
+			if (i) ret += separator;
+			ret += str;
+		}
+		return ret;
+	}
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for (int i{ 1 }; i + 1 < argc; i += 2) {
+		const std::string arg = argv[i];
+		if (arg == "--workloads") options.Workloads = argv[i + 1];
+		else if (arg == "--samples") options.Samples = std::max(1, std::atoi(argv[i + 1]));
+		else if (arg == "--filter") options.Filter = argv[i + 1];
+		else if (arg == "--json") options.Json = argv[i + 1];
+		else {
+			std::cerr << "Unknown option " << arg << "\n";
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+	auto run = [&](const std::string& name, std::uintmax_t bytes, const std::function<void()>& fn) {
+		if (!options.Filter.empty() && name.find(options.Filter) == std::string::npos) return;
+		results.push_back(measure(name, options, bytes, fn));
+		const Result& r = results.back();
+		std::printf("%-32s %12.0f %12.0f %12.0f ns/op", r.Name.c_str(), r.Min, r.Median, r.Mean);
+		if (r.Bytes) std::printf(" %8.2f MB/s", r.Bytes / r.Median * 1e3);
+		std::printf("\n");
+	};
+	std::printf("%-32s %12s %12s %12s\n", "benchmark", "min", "median", "mean");
+
+	//One parser for the whole run: parsers own the intrinsic scope
+	ConfParser parser;
+	parser.Initialize();
+
+	//End to end parses, includes are relative to the working directory
+	const auto cwd = std::filesystem::current_path();
+	std::error_code ec;
+	std::vector<std::filesystem::path> workloads;
+	for (const auto& it : std::filesystem::directory_iterator(options.Workloads, ec))
+		if (std::filesystem::exists(it.path() / "main.conf")) workloads.push_back(std::filesystem::absolute(it.path()));
+	std::sort(workloads.begin(), workloads.end());
+	if (workloads.empty()) std::cerr << "No workload in " << options.Workloads << ", run genconf.py\n";
+	for (const auto& dir : workloads) {
+		std::filesystem::current_path(dir);
+		run("parse/" + dir.filename().string(), directorySize(dir), [&parser]() {
+			ConfScope* root = new ConfScope(ConfParser::GetIntrinsicScope());
+			parser.ParseInto("main.conf", root);
+			delete root;
+		});
+	}
+	//Initializers never looked up cost their compilation only
+	ConfParser lazy;
+	lazy.SetLazyInitializers(true);
+	for (const auto& dir : workloads) {
+		std::filesystem::current_path(dir);
+		run("parse_lazy/" + dir.filename().string(), directorySize(dir), [&lazy]() {
+			ConfScope* root = new ConfScope(ConfParser::GetIntrinsicScope());
+			lazy.ParseInto("main.conf", root);
+			delete root;
+		});
+	}
+
+	//Tenants parsing on 4 threads, the cached pass shares the units between them
+	ConfParser batch;
+	const std::size_t tenants = 8;
+	for (const bool cached : { false, true }) {
+		batch.SetIncludeCache(cached);
+		for (const auto& dir : workloads) {
+			std::filesystem::current_path(dir);
+			const std::vector<std::filesystem::path> files(tenants, dir / "main.conf");
+			run(std::string{ cached ? "parse_batch_cached/" : "parse_batch/" } + dir.filename().string(),
+				directorySize(dir) * tenants, [&batch, &files]() {
+					for (ConfScope* it : batch.ParseBatch(files, 4)) delete it;
+				});
+		}
+	}
+	std::filesystem::current_path(cwd);
+
+	//Parser stages
+	const string_t text = repeat(CP_TEXT("int value = 5 * (4 + 9)"), 4096, CP_TEXT("\n"));
+	run("filtersplit/lines", text.size() * sizeof(char_t), [&text]() {
+		auto lines = filtersplit(text, { '\n', false });
+	});
+
+	const string_t line = CP_TEXT("myVar.aVar = 5 * (4 + 9) + anotherVar");
+	run("filtersplit/tokens", 0, [&line]() {
+		auto tokens = filtersplit(line, { " =#%+-*/.", {false}, true }, true, true);
+	});
+
+	const string_t expr = repeat(CP_TEXT("1 + 2 * (3 + 4)"), 64, CP_TEXT(" + "));
+	run("operatorSplitter/long", 0, [&expr]() {
+		auto tokens = operatorSplitter(expr);
+	});
+
+	//Expanding must stay cheaper than lexing the text using the macros
+	ConfMacroTable macros;
+	macros.Define(CP_TEXT("%define SUM 1 + 2"));
+	macros.Define(CP_TEXT("%define PROD(a, b) a * (b)"));
+	const string_t macroExpr = repeat(CP_TEXT("SUM * PROD(3, 4)"), 64, CP_TEXT(" + "));
+	const auto macroTokens = operatorSplitter(macroExpr);
+	run("macros/expand", 0, [&]() {
+		auto tokens = macroTokens;
+		macros.Expand(tokens);
+	});
+	run("macros/lex_source", 0, [&macroExpr]() {
+		auto tokens = operatorSplitter(macroExpr);
+	});
+
+	ConfScope* scope = new ConfScope(ConfParser::GetIntrinsicScope());
+	auto grouped = parenthesisOperatorParser(operatorSplitter(expr));
+	run("operatorParser/long", 0, [&]() {
+		ConfInstance* r = operatorParser(scope, grouped);
+		if (r && r->IsTemp()) delete r;
+	});
+
+	const std::size_t wide = 4096;
+	for (std::size_t i{ 0 }; i < wide; ++i)
+		parser.ParseLine(&scope, CP_TEXT("int v") + cp_tostring(i) + CP_TEXT(" = 1"));
+	const string_t last = CP_TEXT("v") + cp_tostring(wide - 1), missing = CP_TEXT("missing");
+	run("GetByName/last_of_4096", 0, [&]() {
+		doNotOptimize(scope->GetByName(last));
+	});
+	run("GetByName/missing", 0, [&]() {
+		doNotOptimize(scope->GetByName(missing));
+	});
+
+	//A change rehashes its path to the root only, unchanged subtrees are then skipped
+	ConfScope* copy = static_cast<ConfScope*>(scope->Clone(scope->GetName()));
+	ConfInstanceInt* changed = static_cast<ConfInstanceInt*>(copy->GetByName(last));
+	run("diff/unchanged_4096", 0, [&]() {
+		auto changes = diff(scope, copy);
+	});
+	run("diff/one_of_4096", 0, [&]() {
+		changed->Set(changed->Get() + 1);
+		auto changes = diff(scope, copy);
+	});
+	delete copy;
+	delete scope;
+
+	const string_t literals[] = { CP_TEXT("123456"), CP_TEXT("3.1415"), CP_TEXT("\"a string\""), CP_TEXT("name") };
+	run("TypeFromExpression/mixed", 0, [&literals]() {
+		for (const auto& it : literals) doNotOptimize(ConfTypeIntrinsic::TypeFromExpression(it, nullptr));
+	});
+
+	if (!options.Json.empty()) {
+		if (options.Json == "-") writeJson(std::cout, results);
+		else {
+			std::ofstream ofs{ options.Json };
+			writeJson(ofs, results);
+		}
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,245 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+
+#include "confparser.h"
+#include <ConfParser/confparser.hpp>
+#include <ConfParser/confscope.hpp>
+#include <ConfParser/confimage.hpp>
+#include <ConfParser/confview.hpp>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
+
+using namespace confparser;
+
+struct cp_document {
+	ConfScope* Root = nullptr;
+	ConfImage Image;
+
+	~cp_document() {
+		CP_SF(Root);
+	}
+};
+
+namespace {
+	static_assert(sizeof(ConfNodeView) <= sizeof(cp_node) && std::is_trivially_copyable<ConfNodeView>::value,
+		"cp_node must hold a ConfNodeView");
+
+	cp_node fromView(const ConfNodeView& view) {
+		cp_node ret{};
+		std::memcpy(&ret, &view, sizeof(view));
+		return ret;
+	}
+
+	ConfNodeView toView(cp_node node) {
+		//Same layout, the view is trivially copyable but not trivially constructible
+		ConfNodeView ret{};
+		std::memcpy(static_cast<void*>(&ret), &node, sizeof(ret));
+		return ret;
+	}
+
+	/**
+	* @brief Build a C++ string from UTF-8
+	*/
+	string_t fromUtf8(const char* str) {
+		string_t ret;
+		const unsigned char* s = reinterpret_cast<const unsigned char*>(str);
+		while (*s) {
+			std::uint32_t cp = *s++;
+			int extra = cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 0;
+			if (extra) cp &= 0x3F >> extra;
+			for (; extra > 0 && (*s & 0xC0) == 0x80; --extra) cp = (cp << 6) | (*s++ & 0x3F);
+			if (sizeof(char_t) == 2 && cp > 0xFFFF) {
+				cp -= 0x10000;
+				ret.push_back(static_cast<char_t>(0xD800 + (cp >> 10)));
+				ret.push_back(static_cast<char_t>(0xDC00 + (cp & 0x3FF)));
+			}
+			else ret.push_back(static_cast<char_t>(cp));
+		}
+		return ret;
+	}
+
+	/**
+	* @brief Read a source as UTF-8, wide streams decode it in the C locale
+	*/
+	bool readUtf8(const std::filesystem::path& file, string_t& text) {
+		std::ifstream ifs{ file, std::ios::binary };
+		if (!ifs) return false;
+		std::ostringstream sstream;
+		sstream << ifs.rdbuf();
+		text = fromUtf8(sstream.str().c_str());
+		//Byte order mark
+		if (!text.empty() && text[0] == 0xFEFF) text.erase(0, 1);
+		return true;
+	}
+
+	/**
+	* @brief Shared parser: parsers own the intrinsic scope used by every tree
+	* @description Only used with parserMutex held, reads the sources as UTF-8
+	*/
+	ConfParser& parser() {
+		struct SharedParser {
+			ConfParser Parser;
+
+			SharedParser() {
+				Parser.SetSourceReader(&readUtf8);
+			}
+		};
+		static SharedParser instance;
+		return instance.Parser;
+	}
+
+	/**
+	* @brief Serialize the loads, the parser keeps per parse state
+	*/
+	std::mutex parserMutex;
+
+	/**
+	* @brief Encode a string in UTF-8 into a caller buffer
+	* @return The encoded length, terminator excluded
+	*/
+	std::size_t toUtf8(string_view_t str, char* buffer, std::size_t size) {
+		std::size_t ret = 0;
+		auto put = [&](std::uint32_t byte) {
+			if (ret + 1 < size) buffer[ret] = static_cast<char>(byte);
+			++ret;
+		};
+		for (std::size_t i{ 0 }; i < str.size(); ++i) {
+			std::uint32_t cp = static_cast<std::uint32_t>(str[i]);
+			if (sizeof(char_t) == 2 && cp >= 0xD800 && cp < 0xDC00 && i + 1 < str.size())
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (static_cast<std::uint32_t>(str[++i]) - 0xDC00);
+			if (cp < 0x80) put(cp);
+			else if (cp < 0x800) { put(0xC0 | (cp >> 6)); put(0x80 | (cp & 0x3F)); }
+			else if (cp < 0x10000) { put(0xE0 | (cp >> 12)); put(0x80 | ((cp >> 6) & 0x3F)); put(0x80 | (cp & 0x3F)); }
+			else {
+				put(0xF0 | (cp >> 18)); put(0x80 | ((cp >> 12) & 0x3F));
+				put(0x80 | ((cp >> 6) & 0x3F)); put(0x80 | (cp & 0x3F));
+			}
+		}
+		if (size) buffer[ret < size ? ret : size - 1] = '\0';
+		return ret;
+	}
+
+	/**
+	* @brief Find a direct child of a scope or member of an instance
+	*/
+	ConfNodeView child(const ConfNodeView& node, string_view_t name) {
+		if (auto scope = node.AsScope()) return scope.Find(name);
+		return node.AsInstance().FindMember(name);
+	}
+}
+
+extern "C" {
+	cp_document* cp_load(const char* path, int flags) {
+		if (!path) return nullptr;
+		//Canonical since the reader of the parser only normalizes paths lexically,
+		//u8path since wide paths are narrowed in the C locale
+		std::filesystem::path file{ ConfParser::CanonicalPath(std::filesystem::u8path(path)) };
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(file, ec)) return nullptr;
+
+		cp_document* ret = new cp_document();
+		if (flags & CP_LOAD_IMAGE) {
+			auto image = file;
+			image += CONF_IMAGE_EXTENSION;
+			//Documents are parsed without predefined macros
+			if (ret->Image.Open(image) && ret->Image.IsUpToDate(0)) return ret;
+			ret->Image.Close();
+		}
+		std::lock_guard<std::mutex> lock{ parserMutex };
+		//The macros of a document must not leak in the next ones
+		parser().GetMacros().Clear();
+		ret->Root = parser().ParseInto(file, new ConfScope(ConfParser::GetIntrinsicScope()));
+		if (flags & CP_LOAD_IMAGE) {
+			auto image = file;
+			image += CONF_IMAGE_EXTENSION;
+			ConfImage::Write(image, ret->Root, parser().GetIncludeClosure(file), 0, parser().GetMacros().GetDefinitions());
+		}
+		return ret;
+	}
+
+	void cp_free(cp_document* document) {
+		CP_SF(document);
+	}
+
+	cp_node cp_root(const cp_document* document) {
+		if (!document) return fromView({});
+		if (document->Image.IsOpen()) return fromView(ConfScopeView{ document->Image });
+		return fromView(ConfScopeView{ document->Root });
+	}
+
+	int cp_node_valid(cp_node node) {
+		return toView(node).IsValid();
+	}
+
+	cp_kind cp_node_kind(cp_node node) {
+		return static_cast<cp_kind>(toView(node).GetKind());
+	}
+
+	size_t cp_node_name(cp_node node, char* buffer, size_t size) {
+		return toUtf8(toView(node).GetName(), buffer, size);
+	}
+
+	size_t cp_node_type_name(cp_node node, char* buffer, size_t size) {
+		return toUtf8(toView(node).AsInstance().GetTypeName(), buffer, size);
+	}
+
+	cp_node cp_lookup(cp_node from, const char* path) {
+		if (!path) return fromView({});
+		const string_t str = fromUtf8(path);
+		const string_view_t full{ str };
+		ConfNodeView ret = toView(from);
+		for (std::size_t start{ 0 }; ret.IsValid();) {
+			std::size_t end = full.find(CP_TEXT('.'), start);
+			ret = child(ret, full.substr(start, end == string_view_t::npos ? end : end - start));
+			if (end == string_view_t::npos) break;
+			start = end + 1;
+		}
+		return fromView(ret);
+	}
+
+	cp_value_kind cp_value_kind_of(cp_node node) {
+		return static_cast<cp_value_kind>(toView(node).AsInstance().GetValue().GetKind());
+	}
+
+	int cp_get_int(cp_node node, int32_t* value) {
+		auto v = toView(node).AsInstance().GetValue();
+		if (v.GetKind() != ConfImageValue::INT) return 0;
+		if (value) *value = v.AsInt();
+		return 1;
+	}
+
+	int cp_get_float(cp_node node, float* value) {
+		auto v = toView(node).AsInstance().GetValue();
+		if (v.GetKind() != ConfImageValue::FLOAT) return 0;
+		if (value) *value = v.AsFloat();
+		return 1;
+	}
+
+	size_t cp_get_string(cp_node node, char* buffer, size_t size) {
+		return toUtf8(toView(node).AsInstance().GetValue().AsString(), buffer, size);
+	}
+
+	cp_cursor cp_children(cp_node node) {
+		ConfNodeView view = toView(node);
+		std::size_t count = 0;
+		if (auto scope = view.AsScope()) count = scope.GetChildCount();
+		else count = view.AsInstance().GetMemberCount();
+		return { node, 0, count };
+	}
+
+	int cp_cursor_next(cp_cursor* cursor, cp_node* node) {
+		if (!cursor || cursor->index >= cursor->count) return 0;
+		ConfNodeView parent = toView(cursor->parent);
+		std::size_t index = cursor->index++;
+		if (!node) return 1;
+		if (auto scope = parent.AsScope()) *node = fromView(scope.GetChild(index));
+		else *node = fromView(parent.AsInstance().GetMember(index));
+		return 1;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/**			  ConfParser C Interface
+ *
+ * Provide a C ABI over confparser datastructures for foreign function
+ * interfaces. Nothing is copied before being asked: nodes are handles on the
+ * parsed tree or on the memory mapped compiled image, strings are encoded in
+ * UTF-8 into caller buffers.
+ *
+ * Every function can be called from several threads: loads parsing a source
+ * are serialized, documents are only read once loaded.
+ *
+ */
+
+#ifndef CONFPARSER_C_H
+#define CONFPARSER_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#	ifdef CONFPARSERC_EXPORTS
+#		define CP_API __declspec(dllexport)
+#	else
+#		define CP_API __declspec(dllimport)
+#	endif
+#else
+#	define CP_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	* @brief A loaded configuration, owns the tree or the image its nodes designate
+	*/
+	typedef struct cp_document cp_document;
+
+	/**
+	* @brief Handle on an object of a document, passed by value
+	* @description The content is private. A node stays valid while its
+	*				document is not freed
+	*/
+	typedef struct cp_node {
+		void* opaque[2];
+	} cp_node;
+
+	/**
+	* @brief Iteration state over the childs of a scope or the members of an instance
+	*/
+	typedef struct cp_cursor {
+		cp_node parent;
+		size_t index;
+		size_t count;
+	} cp_cursor;
+
+	/**
+	* @brief C Equivalent of CodeObjectType
+	* @see CodeObjectType
+	*/
+	typedef enum cp_kind {
+		CP_KIND_TYPE,
+		CP_KIND_INSTANCE,
+		CP_KIND_RVALUE,
+		CP_KIND_FUNCTION,
+		CP_KIND_SCOPE,
+		CP_KIND_NONE
+	} cp_kind;
+
+	/**
+	* @brief C Equivalent of ConfImageValue
+	* @see ConfImageValue
+	*/
+	typedef enum cp_value_kind {
+		CP_VALUE_NONE,
+		CP_VALUE_INT,
+		CP_VALUE_FLOAT,
+		CP_VALUE_STRING
+	} cp_value_kind;
+
+	/**
+	* @brief cp_load flags
+	* @description CP_LOAD_IMAGE maps "<file>.confc" when it is up to date,
+	*				without building any tree, and writes it otherwise
+	*/
+	enum {
+		CP_LOAD_DEFAULT = 0,
+		CP_LOAD_IMAGE = 1
+	};
+
+	/**
+	* @brief Load a configuration file
+	* @param path UTF-8 path to the source file
+	* @param flags CP_LOAD_* flags
+	* @return The document, NULL if the file cannot be read
+	*/
+	CP_API cp_document* cp_load(const char* path, int flags);
+
+	/**
+	* @brief Free a document, its nodes must not be used anymore
+	*/
+	CP_API void cp_free(cp_document* document);
+
+	/**
+	* @brief Get the root scope of a document
+	*/
+	CP_API cp_node cp_root(const cp_document* document);
+
+	/**
+	* @brief Check if a node designates an object, lookups return invalid nodes
+	*		 when nothing is found
+	*/
+	CP_API int cp_node_valid(cp_node node);
+
+	CP_API cp_kind cp_node_kind(cp_node node);
+
+	/**
+	* @brief Copy the name of a node as a null terminated UTF-8 string
+	* @param buffer Destination, may be NULL if size is 0
+	* @param size Size of buffer in bytes
+	* @return The length of the name in bytes, terminator excluded. The name is
+	*		  truncated if it is greater or equal to size
+	*/
+	CP_API size_t cp_node_name(cp_node node, char* buffer, size_t size);
+
+	/**
+	* @brief Copy the type name of an instance, empty for other nodes
+	* @see cp_node_name
+	*/
+	CP_API size_t cp_node_type_name(cp_node node, char* buffer, size_t size);
+
+	/**
+	* @brief Find an object by a dotted path relative to a scope or an instance
+	* @description "a.b" is the member b of the child a. Upper scopes are not searched
+	* @param path UTF-8 dotted path
+	*/
+	CP_API cp_node cp_lookup(cp_node from, const char* path);
+
+	CP_API cp_value_kind cp_value_kind_of(cp_node node);
+
+	/**
+	* @brief Read an int instance
+	* @return 1 if node is an int instance and value has been set, 0 otherwise
+	*/
+	CP_API int cp_get_int(cp_node node, int32_t* value);
+
+	/**
+	* @brief Read a float instance
+	* @return 1 if node is a float instance and value has been set, 0 otherwise
+	*/
+	CP_API int cp_get_float(cp_node node, float* value);
+
+	/**
+	* @brief Copy a string instance value, empty for other nodes
+	* @see cp_node_name
+	*/
+	CP_API size_t cp_get_string(cp_node node, char* buffer, size_t size);
+
+	/**
+	* @brief Start iterating the childs of a scope or the members of an instance
+	*/
+	CP_API cp_cursor cp_children(cp_node node);
+
+	/**
+	* @brief Get the next node of a cursor
+	* @return 1 if node has been set, 0 at the end
+	*/
+	CP_API int cp_cursor_next(cp_cursor* cursor, cp_node* node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,270 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*
+ * ConfParser C interface tests
+ *
+ * Compiled as C against the public header and linked to the shared library,
+ * so they check the ABI as foreign callers see it. Each test writes its
+ * sources in the working directory, prefixed by its name. CMake registers
+ * one ctest case per test:
+ *
+ *     ConfParserCTests [test]
+ *
+ * Without argument every test is run.
+ */
+
+#include <ConfParserC/confparser.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct Test {
+	const char* Name;
+	int(*Run)(void);
+} Test;
+
+static void writeSource(const char* file, const char* text) {
+	FILE* f = fopen(file, "wb");
+	if (!f) return;
+	fputs(text, f);
+	fclose(f);
+}
+
+static int expectInt(cp_node from, const char* path, int32_t expected) {
+	int32_t value = 0;
+	if (cp_get_int(cp_lookup(from, path), &value) && value == expected) return 1;
+	printf("  %s: expected %d, got %d\n", path, (int)expected, (int)value);
+	return 0;
+}
+
+static int expectString(const char* what, size_t length, const char* got, const char* expected) {
+	if (length == strlen(expected) && !strcmp(got, expected)) return 1;
+	printf("  %s: expected %s, got %s (%u bytes)\n", what, expected, got, (unsigned)length);
+	return 0;
+}
+
+static const char Source[] =
+	"class Point {\nint x\nint y\n}\nPoint p\np.x = 3\nint a = 7\nfloat f\nstring s = \"hi\"\n";
+
+/*
+ * A missing file is not loaded, a loaded one has a root scope
+ */
+static int load(void) {
+	int ret = 1;
+	cp_document* document;
+	if (cp_load("load_missing.conf", CP_LOAD_DEFAULT)) {
+		printf("  load_missing.conf: expected NULL\n");
+		ret = 0;
+	}
+	cp_free(NULL);
+
+	writeSource("load.conf", Source);
+	document = cp_load("load.conf", CP_LOAD_DEFAULT);
+	if (!document) {
+		printf("  load.conf: expected a document\n");
+		return 0;
+	}
+	if (!cp_node_valid(cp_root(document)) || cp_node_kind(cp_root(document)) != CP_KIND_SCOPE) {
+		printf("  root: expected a valid scope\n");
+		ret = 0;
+	}
+	cp_free(document);
+	return ret;
+}
+
+/*
+ * Dotted paths reach members, unknown names give invalid nodes
+ */
+static int lookup(void) {
+	int ret = 1;
+	char buffer[32];
+	size_t length;
+	cp_document* document;
+	cp_node root, p;
+	writeSource("lookup.conf", Source);
+	document = cp_load("lookup.conf", CP_LOAD_DEFAULT);
+	if (!document) return 0;
+	root = cp_root(document);
+
+	ret &= expectInt(root, "p.x", 3);
+	ret &= expectInt(root, "a", 7);
+	p = cp_lookup(root, "p");
+	ret &= expectInt(p, "x", 3);
+	if (cp_node_kind(p) != CP_KIND_INSTANCE) {
+		printf("  p: expected an instance\n");
+		ret = 0;
+	}
+	length = cp_node_name(p, buffer, sizeof(buffer));
+	ret &= expectString("name", length, buffer, "p");
+	length = cp_node_type_name(p, buffer, sizeof(buffer));
+	ret &= expectString("type name", length, buffer, "Point");
+	if (cp_node_valid(cp_lookup(root, "missing")) || cp_node_valid(cp_lookup(root, "p.z")) ||
+		cp_node_valid(cp_lookup(root, NULL))) {
+		printf("  lookup: expected invalid nodes for unknown paths\n");
+		ret = 0;
+	}
+	cp_free(document);
+	return ret;
+}
+
+/*
+ * Each getter reads its kind only, strings are truncated to the buffer
+ */
+static int typedGetters(void) {
+	int ret = 1;
+	char buffer[32];
+	size_t length;
+	int32_t i = 0;
+	float f = 0.f;
+	cp_document* document;
+	cp_node root;
+	writeSource("typed_getters.conf", Source);
+	document = cp_load("typed_getters.conf", CP_LOAD_DEFAULT);
+	if (!document) return 0;
+	root = cp_root(document);
+
+	if (cp_value_kind_of(cp_lookup(root, "a")) != CP_VALUE_INT ||
+		cp_value_kind_of(cp_lookup(root, "f")) != CP_VALUE_FLOAT ||
+		cp_value_kind_of(cp_lookup(root, "s")) != CP_VALUE_STRING ||
+		cp_value_kind_of(cp_lookup(root, "p")) != CP_VALUE_NONE) {
+		printf("  value kinds: unexpected\n");
+		ret = 0;
+	}
+	f = 1.f;
+	if (!cp_get_float(cp_lookup(root, "f"), &f) || f != 0.f) {
+		printf("  f: expected 0, got %g\n", f);
+		ret = 0;
+	}
+	if (cp_get_int(cp_lookup(root, "f"), &i) || cp_get_float(cp_lookup(root, "a"), &f)) {
+		printf("  getters: expected 0 for another kind\n");
+		ret = 0;
+	}
+	length = cp_get_string(cp_lookup(root, "s"), buffer, sizeof(buffer));
+	ret &= expectString("s", length, buffer, "\"hi\"");
+	//The full length is returned, the copy is truncated and terminated
+	length = cp_get_string(cp_lookup(root, "s"), buffer, 3);
+	if (length != 4 || strcmp(buffer, "\"h")) {
+		printf("  s: expected a truncated copy, got %s (%u bytes)\n", buffer, (unsigned)length);
+		ret = 0;
+	}
+	cp_free(document);
+	return ret;
+}
+
+/*
+ * Cursors walk the childs of a scope and the members of an instance in order
+ */
+static int cursors(void) {
+	int ret = 1;
+	char names[64] = "", buffer[16];
+	cp_document* document;
+	cp_cursor cursor;
+	cp_node node;
+	writeSource("cursors.conf", Source);
+	document = cp_load("cursors.conf", CP_LOAD_DEFAULT);
+	if (!document) return 0;
+
+	cursor = cp_children(cp_root(document));
+	while (cp_cursor_next(&cursor, &node)) {
+		cp_node_name(node, buffer, sizeof(buffer));
+		strcat(names, buffer);
+		strcat(names, " ");
+	}
+	ret &= expectString("root childs", strlen(names), names, "Point p a f s ");
+
+	names[0] = '\0';
+	cursor = cp_children(cp_lookup(cp_root(document), "p"));
+	while (cp_cursor_next(&cursor, &node)) {
+		cp_node_name(node, buffer, sizeof(buffer));
+		strcat(names, buffer);
+		strcat(names, " ");
+	}
+	ret &= expectString("p members", strlen(names), names, "x y ");
+	if (cp_cursor_next(&cursor, &node) || cp_cursor_next(NULL, &node)) {
+		printf("  cursor: expected the end\n");
+		ret = 0;
+	}
+	cp_free(document);
+	return ret;
+}
+
+/*
+ * The image written by a first load is mapped by the next one and reads the
+ * same values
+ */
+static int image(void) {
+	int ret = 1, pass;
+	FILE* f;
+	cp_document* document;
+	writeSource("image.conf", Source);
+	remove("image.conf.confc");
+	for (pass = 0; pass < 2; ++pass) {
+		char buffer[16];
+		size_t length;
+		document = cp_load("image.conf", CP_LOAD_IMAGE);
+		if (!document) return 0;
+		ret &= expectInt(cp_root(document), "p.x", 3);
+		ret &= expectInt(cp_root(document), "a", 7);
+		length = cp_get_string(cp_lookup(cp_root(document), "s"), buffer, sizeof(buffer));
+		ret &= expectString("s", length, buffer, "\"hi\"");
+		cp_free(document);
+		if (pass) continue;
+		f = fopen("image.conf.confc", "rb");
+		if (!f) {
+			printf("  image.conf.confc: expected written by the first load\n");
+			ret = 0;
+		}
+		else fclose(f);
+	}
+	return ret;
+}
+
+/*
+ * Sources and paths are UTF-8, strings are returned in UTF-8
+ */
+static int utf8(void) {
+	int ret = 1;
+	char buffer[32];
+	size_t length;
+	cp_document* document;
+	writeSource("utf8_\xC3\xA9.conf", "\xEF\xBB\xBFstring h = \"h\xC3\xA9\"\nint n = 2\n");
+	document = cp_load("utf8_\xC3\xA9.conf", CP_LOAD_DEFAULT);
+	if (!document) {
+		printf("  utf8_\xC3\xA9.conf: expected a document\n");
+		return 0;
+	}
+	length = cp_get_string(cp_lookup(cp_root(document), "h"), buffer, sizeof(buffer));
+	ret &= expectString("h", length, buffer, "\"h\xC3\xA9\"");
+	ret &= expectInt(cp_root(document), "n", 2);
+	cp_free(document);
+	return ret;
+}
+
+static const Test Tests[] = {
+	{ "load", load },
+	{ "lookup", lookup },
+	{ "typed_getters", typedGetters },
+	{ "cursors", cursors },
+	{ "image", image },
+	{ "utf8", utf8 }
+};
+
+int main(int argc, char** argv) {
+	int ret = 1, found = 0;
+	size_t i;
+	for (i = 0; i < sizeof(Tests) / sizeof(Tests[0]); ++i) {
+		int passed;
+		if (argc > 1 && strcmp(argv[1], Tests[i].Name)) continue;
+		found = 1;
+		passed = Tests[i].Run();
+		printf("%s %s\n", passed ? "PASS" : "FAIL", Tests[i].Name);
+		ret &= passed;
+	}
+	if (!found) {
+		printf("Unknown test %s\n", argv[1]);
+		return 1;
+	}
+	return ret ? 0 : 1;
+}
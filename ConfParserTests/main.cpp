@@ -0,0 +1,740 @@
+/*
+* Copyright (C) 2020 Kilian Jugie - All Rights Reserved
+* Unauthorized copying of this file, via any medium is strictly prohibited
+* Proprietary and confidential
+*/
+/*
+ * ConfParser regression tests
+ *
+ * Each test writes its sources in its own directory under the temporary
+ * directory and runs there. CMake registers one ctest case per test:
+ *
+ *     ConfParserTests [test]
+ *
+ * Without argument every test is run.
+ */
+
+#include <ConfParser/confparser.hpp>
+#include <ConfParser/confscope.hpp>
+#include <ConfParser/confinstance.hpp>
+#include <ConfParser/confimage.hpp>
+#include <ConfParser/confmacro.hpp>
+#include <ConfParser/confdocument.hpp>
+#include <ConfParser/confvaluegraph.hpp>
+#include <ConfParser/confwatcher.hpp>
+#include <ConfParser/confunitcache.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace confparser;
+
+namespace {
+	struct Test {
+		const char* Name;
+		bool(*Run)();
+	};
+
+	void writeSource(const std::filesystem::path& file, const char* text) {
+		std::ofstream{ file, std::ios::binary | std::ios::trunc } << text;
+	}
+
+	bool expectInt(ConfScope* root, const string_t& path, int expected) {
+		auto instance = dynamic_cast<ConfInstanceInt*>(root->GetByPath(path));
+		if (instance && instance->Get() == expected) return true;
+		std::printf("  %ls: expected %d, got %s%d\n", path.c_str(), expected,
+			instance ? "" : "no instance ", instance ? instance->Get() : 0);
+		return false;
+	}
+
+	/*!
+	 * \brief A unit merged twice in a root (diamond include) must not share its
+	 *		  members with the root, writes of a root must not reach the cache
+	*/
+	bool includeDiamondWrite() {
+		writeSource("common.conf", "class Shared {\nint aVar\n}\nShared shared\nshared.aVar = 3\n");
+		writeSource("b.conf", "%use \"common.conf\"\n");
+		writeSource("c.conf", "%use \"common.conf\"\n");
+		writeSource("a.conf", "%use \"b.conf\"\n%use \"c.conf\"\nshared.aVar = 9\n");
+		writeSource("d.conf", "%use \"c.conf\"\n");
+
+		bool ret = true;
+		ConfParser parser;
+		parser.SetIncludeCache(true);
+		ConfScope* a = parser.ParseInto("a.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		ret &= expectInt(a, CP_TEXT("shared.aVar"), 9);
+		ConfScope* d = parser.ParseInto("d.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		ret &= expectInt(d, CP_TEXT("shared.aVar"), 3);
+		CP_SF(a);
+		CP_SF(d);
+		return ret;
+	}
+
+	bool hasChilds(ConfScope* root, std::initializer_list<const char_t*> names) {
+		string_t got;
+		for (auto it : root->GetChilds()) got += it->GetName() + CP_TEXT(" ");
+		string_t expected;
+		for (auto it : names) expected += string_t(it) + CP_TEXT(" ");
+		if (got == expected) return true;
+		std::printf("  childs: expected %ls, got %ls\n", expected.c_str(), got.c_str());
+		return false;
+	}
+
+	/*!
+	 * \brief An image holds the declarations of its file only, not the ones
+	 *		  of previous parses in the same root
+	*/
+	bool imagePreviousParse() {
+		writeSource("one.conf", "int a = 1\n");
+		writeSource("two.conf", "int b = 2\n");
+
+		bool ret = true;
+		{
+			ConfParser parser;
+			parser.SetImageCache(true);
+			ConfScope* root = new ConfScope(ConfParser::GetIntrinsicScope());
+			parser.ParseInto("one.conf", root);
+			parser.ParseInto("two.conf", root);
+			ret &= hasChilds(root, { CP_TEXT("a"), CP_TEXT("b") });
+			CP_SF(root);
+		}
+		for (int i{ 0 }; i < 2; ++i) {
+			//Parsed then loaded from the image
+			ConfParser parser;
+			parser.SetImageCache(true);
+			ConfScope* root = parser.ParseInto("two.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+			ret &= hasChilds(root, { CP_TEXT("b") });
+			CP_SF(root);
+		}
+		return ret;
+	}
+
+	/*!
+	 * \brief An image is used by parses starting with the macros it was
+	 *		  compiled with and defines the macros of its file
+	*/
+	bool imageMacros() {
+		writeSource("m.conf", "%ifdef DEBUG\nint dbg = 1\n%else\nint rel = 1\n%endif\n%define WIDTH 80\n");
+
+		bool ret = true;
+		for (bool debug : { false, true, false }) {
+			ConfParser parser;
+			parser.SetImageCache(true);
+			if (debug) parser.GetMacros().Define(CP_TEXT("%define DEBUG"));
+			ConfScope* root = parser.ParseInto("m.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+			ret &= hasChilds(root, { debug ? CP_TEXT("dbg") : CP_TEXT("rel") });
+			CP_SF(root);
+		}
+
+		ConfImage image;
+		if (!image.Open("m.conf.confc") || !image.IsUpToDate(0)) {
+			std::printf("  m.conf.confc: expected an image compiled without macros\n");
+			ret = false;
+		}
+		ConfParser parser;
+		parser.SetImageCache(true);
+		ConfScope* root = parser.ParseInto("m.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		ret &= hasChilds(root, { CP_TEXT("rel") });
+		if (!parser.GetMacros().IsDefined(CP_TEXT("WIDTH"))) {
+			std::printf("  WIDTH: expected defined after an image load\n");
+			ret = false;
+		}
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief Statements evaluated again by an edit read the values of their
+	 *		  position, not the ones written by later lines
+	*/
+	bool documentLaterWrite() {
+		ConfDocument document{ CP_TEXT("int a = 1\nint b = a\nint c = 2\na = 5\n") };
+		bool ret = true;
+		//Removes c, the slots of the next declarations move
+		document.Edit({ { 2, 0 }, { 3, 0 }, CP_TEXT("") });
+		ret &= hasChilds(document.GetRoot(), { CP_TEXT("a"), CP_TEXT("b") });
+		//Appended to the line of b, both are evaluated before the write of a
+		document.Edit({ { 1, string_t::npos }, { 1, string_t::npos }, CP_TEXT("\nint d = a") });
+		ret &= hasChilds(document.GetRoot(), { CP_TEXT("a"), CP_TEXT("b"), CP_TEXT("d") });
+		ret &= expectInt(document.GetRoot(), CP_TEXT("b"), 1);
+		ret &= expectInt(document.GetRoot(), CP_TEXT("d"), 1);
+		ret &= expectInt(document.GetRoot(), CP_TEXT("a"), 5);
+		return ret;
+	}
+
+	/*!
+	 * \brief A compound statement evaluated again by an edit above it does not
+	 *		  accumulate on its previous result
+	*/
+	bool documentCompound() {
+		ConfDocument document{ CP_TEXT("int x = 1\nint y = 2\nx += y") };
+		document.Edit({ { 1, 0 }, { 1, string_t::npos }, CP_TEXT("int y = 3") });
+		bool ret = expectInt(document.GetRoot(), CP_TEXT("x"), 4);
+		document.Edit({ { 0, 0 }, { 0, string_t::npos }, CP_TEXT("int x = 2") });
+		ret &= expectInt(document.GetRoot(), CP_TEXT("x"), 5);
+		return ret;
+	}
+
+	/*!
+	 * \brief Destroying a document leaves the intrinsic scope to the others
+	*/
+	bool documentLifetime() {
+		ConfDocument* first = new ConfDocument{ CP_TEXT("int a = 1\nint b = a") };
+		{
+			ConfDocument second{ CP_TEXT("int c = 2") };
+		}
+		first->Edit({ { 0, 0 }, { 0, string_t::npos }, CP_TEXT("int a = 3") });
+		bool ret = expectInt(first->GetRoot(), CP_TEXT("b"), 3);
+		CP_SF(first);
+		ConfDocument third{ CP_TEXT("int d = 4") };
+		ret &= expectInt(third.GetRoot(), CP_TEXT("d"), 4);
+		return ret;
+	}
+
+	/*!
+	 * \brief An edit out of the conditional blocks stays incremental, one
+	 *		  touching a block or a name read by a condition evaluates the buffer
+	*/
+	bool documentConditions() {
+		ConfDocument document{ CP_TEXT("int host = 7\nint level = 0\nint a = 1\nint b = a\n%if level\nint hi = 1\n%endif\n") };
+		static_cast<ConfInstanceInt*>(document.GetRoot()->GetByPath(CP_TEXT("host")))->Set(42);
+		bool ret = true;
+		const std::size_t evaluated = document.Edit({ { 2, 0 }, { 2, string_t::npos }, CP_TEXT("int a = 2") });
+		if (evaluated != 2) {
+			std::printf("  a: expected 2 statements evaluated, got %zu\n", evaluated);
+			ret = false;
+		}
+		ret &= expectInt(document.GetRoot(), CP_TEXT("b"), 2);
+		ret &= expectInt(document.GetRoot(), CP_TEXT("host"), 42);
+		//Enables the block
+		document.Edit({ { 1, 0 }, { 1, string_t::npos }, CP_TEXT("int level = 1") });
+		ret &= hasChilds(document.GetRoot(), { CP_TEXT("host"), CP_TEXT("level"), CP_TEXT("a"), CP_TEXT("b"), CP_TEXT("hi") });
+		ret &= expectInt(document.GetRoot(), CP_TEXT("host"), 7);
+		//Inside the block
+		static_cast<ConfInstanceInt*>(document.GetRoot()->GetByPath(CP_TEXT("host")))->Set(42);
+		document.Edit({ { 5, 0 }, { 5, string_t::npos }, CP_TEXT("int hi = 3") });
+		ret &= expectInt(document.GetRoot(), CP_TEXT("hi"), 3);
+		ret &= expectInt(document.GetRoot(), CP_TEXT("host"), 7);
+		return ret;
+	}
+
+	/*!
+	 * \brief Nested blocks are skipped whole, including their own %else
+	*/
+	bool preprocessorNested() {
+		writeSource("nested.conf", "%define OUTER\n%ifdef OUTER\n%ifdef INNER\nint a = 1\n%else\nint a = 2\n%endif\n"
+			"%ifndef INNER\nint b = 3\n%endif\n%else\n%ifdef INNER\nint c = 4\n%else\nint c = 5\n%endif\n"
+			"int d = 6\n%endif\nint e = 7\n");
+
+		ConfParser parser;
+		ConfScope* root = parser.ParseInto("nested.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		bool ret = hasChilds(root, { CP_TEXT("a"), CP_TEXT("b"), CP_TEXT("e") });
+		ret &= expectInt(root, CP_TEXT("a"), 2);
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief %if and %elif evaluate expressions of the scope, unknown names
+	 *		  are 0
+	*/
+	bool preprocessorIf() {
+		writeSource("if.conf", "int level = 2\n%if level * 0\nint a = 1\n%elif level + 1\nint a = 2\n%else\nint a = 3\n%endif\n"
+			"%if missing\nint b = 1\n%else\nint b = 2\n%endif\n");
+
+		ConfParser parser;
+		ConfScope* root = parser.ParseInto("if.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		bool ret = hasChilds(root, { CP_TEXT("level"), CP_TEXT("a"), CP_TEXT("b") });
+		ret &= expectInt(root, CP_TEXT("a"), 2);
+		ret &= expectInt(root, CP_TEXT("b"), 2);
+		CP_SF(root);
+		return ret;
+	}
+
+	bool hasConditionErrors(const std::vector<ConfConditionError>& got,
+		std::initializer_list<ConfConditionError> errors) {
+		bool ret = got.size() == errors.size();
+		for (std::size_t i{ 0 }; ret && i < got.size(); ++i) {
+			const ConfConditionError& expected = errors.begin()[i];
+			ret = got[i].Error == expected.Error && got[i].File == expected.File && got[i].Line == expected.Line;
+		}
+		if (ret) return true;
+		std::printf("  condition errors: got");
+		for (const auto& it : got)
+			std::printf(" %d@%s:%zu", static_cast<int>(it.Error), it.File.filename().string().c_str(), it.Line);
+		std::printf("\n");
+		return false;
+	}
+
+	/*!
+	 * \brief A block left open is reported and ends with its file, the
+	 *		  includer is evaluated as usual
+	*/
+	bool preprocessorUnterminated() {
+		writeSource("open.conf", "%ifndef X\nint shown = 1\n%ifdef X\nint hidden = 1\n");
+		writeSource("main.conf", "%use \"open.conf\"\nint after = 2\n%endif\n");
+
+		using Kind = ConfConditionError::Kind;
+		ConfParser parser;
+		ConfScope* root = parser.ParseInto("main.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		bool ret = hasChilds(root, { CP_TEXT("shown"), CP_TEXT("after") });
+		const auto open = ConfParser::CanonicalPath("open.conf");
+		ret &= hasConditionErrors(parser.GetConditionErrors(), { { Kind::UNTERMINATED, open, 1 },
+			{ Kind::UNTERMINATED, open, 3 }, { Kind::UNMATCHED, ConfParser::CanonicalPath("main.conf"), 3 } });
+		CP_SF(root);
+
+		//Same rules for documents
+		ConfDocument document{ CP_TEXT("%ifdef X\nint a = 1\n%else\nint b = 2\n%else\nint c = 3\n") };
+		ret &= hasChilds(document.GetRoot(), { CP_TEXT("b") });
+		ret &= hasConditionErrors(document.GetConditionErrors(), { { Kind::DUPLICATED_ELSE, {}, 5 },
+			{ Kind::UNTERMINATED, {}, 1 } });
+		document.Edit({ { 4, 0 }, { 5, string_t::npos }, CP_TEXT("%endif") });
+		ret &= hasChilds(document.GetRoot(), { CP_TEXT("b") });
+		ret &= hasConditionErrors(document.GetConditionErrors(), {});
+		return ret;
+	}
+
+	bool expectExpansion(const ConfMacroTable& macros, const char_t* expression, const char_t* expected) {
+		auto tokens = operatorSplitter(expression);
+		macros.Expand(tokens);
+		string_t got;
+		for (const auto& it : tokens) {
+			if (it.empty()) continue;
+			if (!got.empty()) got.push_back(CP_TEXT(' '));
+			got += it;
+		}
+		if (got == expected) return true;
+		std::printf("  %ls: expected %ls, got %ls\n", expression, expected, got.c_str());
+		return false;
+	}
+
+	/*!
+	 * \brief Parameters are substituted by position wherever their slots are,
+	 *		  arguments are expanded first
+	*/
+	bool macroParameters() {
+		ConfMacroTable macros;
+		bool ret = true;
+		for (const char_t* it : { CP_TEXT("%define WIDTH 80"), CP_TEXT("%define AREA(w, h) (w * h)"),
+			CP_TEXT("%define SWAP(a, b) b a"), CP_TEXT("%define SQ(x) x * x"), CP_TEXT("%define PAD(w) width + w"),
+			CP_TEXT("%define NONE() 0") }) {
+			if (macros.Define(it)) continue;
+			std::printf("  %ls: expected well formed\n", it);
+			ret = false;
+		}
+		for (const char_t* it : { CP_TEXT("%define BAD(a b) a"), CP_TEXT("%define BAD(a,) a"), CP_TEXT("%define BAD(a") }) {
+			if (!macros.Define(it)) continue;
+			std::printf("  %ls: expected malformed\n", it);
+			ret = false;
+		}
+		ret &= expectExpansion(macros, CP_TEXT("AREA(WIDTH, 25)"), CP_TEXT("( 80 * 25 )"));
+		ret &= expectExpansion(macros, CP_TEXT("SWAP(1, 2)"), CP_TEXT("2 1"));
+		ret &= expectExpansion(macros, CP_TEXT("SQ((1 + 2))"), CP_TEXT("( 1 + 2 ) * ( 1 + 2 )"));
+		//Only whole tokens are parameters
+		ret &= expectExpansion(macros, CP_TEXT("PAD(3)"), CP_TEXT("width + 3"));
+		ret &= expectExpansion(macros, CP_TEXT("NONE() + 1"), CP_TEXT("0 + 1"));
+		//Without arguments a function-like macro name is a plain token
+		ret &= expectExpansion(macros, CP_TEXT("SQ + 1"), CP_TEXT("SQ + 1"));
+
+		writeSource("area.conf", "%define WIDTH 80\n%define AREA(w, h) (w * h)\nint a = AREA(WIDTH, 25)\n");
+		ConfParser parser;
+		ConfScope* root = parser.ParseInto("area.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		ret &= expectInt(root, CP_TEXT("a"), 2000);
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief Parameterless expansions are reused, but not the partial ones
+	 *		  made while another macro was suppressed
+	*/
+	bool macroExpansionCache() {
+		ConfMacroTable macros;
+		macros.Define(CP_TEXT("%define ONE 1"));
+		macros.Define(CP_TEXT("%define TWO ONE + ONE"));
+		macros.Define(CP_TEXT("%define A B + 1"));
+		macros.Define(CP_TEXT("%define B A"));
+		bool ret = true;
+		for (int i{ 0 }; i < 2; ++i) ret &= expectExpansion(macros, CP_TEXT("TWO * 2"), CP_TEXT("1 + 1 * 2"));
+		//Expanding B expands A with B suppressed, A alone expands B fully
+		for (int i{ 0 }; i < 2; ++i) {
+			ret &= expectExpansion(macros, CP_TEXT("B"), CP_TEXT("B + 1"));
+			ret &= expectExpansion(macros, CP_TEXT("A"), CP_TEXT("A + 1"));
+		}
+		return ret;
+	}
+
+	/*!
+	 * \brief Redefining a macro drops the cached expansions using it
+	*/
+	bool macroRedefinition() {
+		ConfMacroTable macros;
+		macros.Define(CP_TEXT("%define BASE 2"));
+		macros.Define(CP_TEXT("%define NEXT BASE + 1"));
+		macros.Define(CP_TEXT("%define TOP NEXT * 2"));
+		bool ret = expectExpansion(macros, CP_TEXT("TOP"), CP_TEXT("2 + 1 * 2"));
+		macros.Define(CP_TEXT("%define BASE 5"));
+		ret &= expectExpansion(macros, CP_TEXT("TOP"), CP_TEXT("5 + 1 * 2"));
+		ret &= expectExpansion(macros, CP_TEXT("NEXT"), CP_TEXT("5 + 1"));
+		macros.Define(CP_TEXT("%define NEXT BASE"));
+		ret &= expectExpansion(macros, CP_TEXT("TOP"), CP_TEXT("5 * 2"));
+
+		writeSource("redefine.conf", "%define BASE 2\n%define NEXT BASE + 1\nint a = NEXT\n%define BASE 5\nint b = NEXT\n");
+		ConfParser parser;
+		ConfScope* root = parser.ParseInto("redefine.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		ret &= expectInt(root, CP_TEXT("a"), 3);
+		ret &= expectInt(root, CP_TEXT("b"), 6);
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief The macros hash, stored by images, depends on the definitions
+	 *		  only: not on their order, spacing or history
+	*/
+	bool macroHash() {
+		const char_t* definitions[] = { CP_TEXT("%define WIDTH 80"), CP_TEXT("%define AREA(w, h) (w * h)"),
+			CP_TEXT("%define DEBUG") };
+		ConfMacroTable forward, backward;
+		bool ret = true;
+		if (forward.GetHash()) {
+			std::printf("  hash: expected 0 without macros\n");
+			ret = false;
+		}
+		for (std::size_t i{ 0 }; i < std::size(definitions); ++i) {
+			forward.Define(definitions[i]);
+			backward.Define(definitions[std::size(definitions) - 1 - i]);
+		}
+		const std::uint64_t hash = forward.GetHash();
+		auto expect = [&ret, hash](const char* what, std::uint64_t got, bool isSame) {
+			if ((got == hash) == isSame) return;
+			std::printf("  %s: expected %s hash\n", what, isSame ? "the same" : "another");
+			ret = false;
+		};
+		expect("definition order", backward.GetHash(), true);
+		backward.Define(CP_TEXT("%define  WIDTH   80"));
+		expect("spacing", backward.GetHash(), true);
+		backward.Define(CP_TEXT("%define WIDTH 81"));
+		expect("other body", backward.GetHash(), false);
+		backward.Define(CP_TEXT("%define WIDTH 80"));
+		expect("body restored", backward.GetHash(), true);
+		backward.Define(CP_TEXT("%define AREA(w, x) (w * x)"));
+		expect("other parameter", backward.GetHash(), false);
+		backward.Define(CP_TEXT("%define AREA(h, w) (w * h)"));
+		expect("other slots", backward.GetHash(), false);
+
+		ConfMacroTable replayed;
+		for (const auto& it : forward.GetDefinitions()) replayed.Define(it);
+		expect("replayed definitions", replayed.GetHash(), true);
+		replayed.Clear();
+		if (replayed.GetHash()) {
+			std::printf("  hash: expected 0 after Clear\n");
+			ret = false;
+		}
+		return ret;
+	}
+
+	bool hasPaths(const char* what, const std::vector<string_t>& got, std::initializer_list<const char_t*> paths) {
+		std::vector<string_t> expected{ paths.begin(), paths.end() };
+		if (got == expected) return true;
+		string_t text;
+		for (const auto& it : got) text += it + CP_TEXT(" ");
+		std::printf("  %s: got %ls\n", what, text.c_str());
+		return false;
+	}
+
+	/*!
+	 * \brief Parse the value graph source: x and y depend on each other, z
+	 *		  on the cycle
+	*/
+	ConfScope* parseCycle(ConfParser& parser, ConfValueGraph& graph) {
+		writeSource("cycle.conf", "int x = 1\nint y = x + 1\nx = y + 1\nint z = y * 2\n");
+		parser.SetValueGraph(&graph);
+		return parser.ParseInto("cycle.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+	}
+
+	/*!
+	 * \brief A Set entering a cycle evaluates it once and its dependents
+	*/
+	bool valueGraphSet() {
+		ConfParser parser;
+		ConfValueGraph graph;
+		ConfScope* root = parseCycle(parser, graph);
+		bool ret = hasPaths("changed", graph.Set(root, CP_TEXT("x"), CP_TEXT("y + 5")),
+			{ CP_TEXT("x"), CP_TEXT("y"), CP_TEXT("z") });
+		ret &= hasPaths("cycles", graph.GetCycles(), { CP_TEXT("x"), CP_TEXT("y") });
+		ret &= expectInt(root, CP_TEXT("x"), 7);
+		ret &= expectInt(root, CP_TEXT("y"), 8);
+		ret &= expectInt(root, CP_TEXT("z"), 16);
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief An Update of a value of a cycle evaluates the cycle once from its
+	 *		  first statement then its dependents
+	*/
+	bool valueGraphUpdate() {
+		ConfParser parser;
+		ConfValueGraph graph;
+		ConfScope* root = parseCycle(parser, graph);
+		static_cast<ConfInstanceInt*>(root->GetByPath(CP_TEXT("y")))->Set(10);
+		bool ret = hasPaths("changed", graph.Update(root, { CP_TEXT("y") }), { CP_TEXT("x"), CP_TEXT("y"), CP_TEXT("z") });
+		ret &= hasPaths("cycles", graph.GetCycles(), { CP_TEXT("x"), CP_TEXT("y") });
+		ret &= expectInt(root, CP_TEXT("x"), 11);
+		ret &= expectInt(root, CP_TEXT("y"), 12);
+		ret &= expectInt(root, CP_TEXT("z"), 24);
+		//Out of the cycle
+		ret &= hasPaths("changed", graph.Update(root, { CP_TEXT("z") }), {});
+		ret &= hasPaths("cycles", graph.GetCycles(), {});
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief The callback is notified of the values changed through a cycle
+	*/
+	bool valueGraphCallback() {
+		ConfParser parser;
+		ConfValueGraph graph;
+		ConfScope* root = parseCycle(parser, graph);
+		std::vector<string_t> notified;
+		std::size_t calls = 0;
+		graph.SetCallback([&](ConfScope*, const std::vector<string_t>& paths) {
+			notified = paths;
+			++calls;
+		});
+		static_cast<ConfInstanceInt*>(root->GetByPath(CP_TEXT("y")))->Set(10);
+		graph.Update(root, { CP_TEXT("y") });
+		bool ret = hasPaths("notified", notified, { CP_TEXT("x"), CP_TEXT("y"), CP_TEXT("z") });
+		graph.Set(root, CP_TEXT("z"), CP_TEXT("0"));
+		ret &= hasPaths("notified", notified, { CP_TEXT("z") });
+		if (calls != 2) {
+			std::printf("  calls: expected 2, got %zu\n", calls);
+			ret = false;
+		}
+		CP_SF(root);
+		return ret;
+	}
+
+	/*!
+	 * \brief Roots parsed with the same graph keep their own statements, a
+	 *		  forgotten root leaves the others usable
+	*/
+	bool valueGraphRoots() {
+		writeSource("roots.conf", "int a = 1\nint b = a + 1\n");
+		ConfParser parser;
+		ConfValueGraph graph;
+		parser.SetValueGraph(&graph);
+		ConfScope* first = parser.ParseInto("roots.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		ConfScope* second = parser.ParseInto("roots.conf", new ConfScope(ConfParser::GetIntrinsicScope()));
+		bool ret = hasPaths("changed", graph.Set(first, CP_TEXT("a"), CP_TEXT("10")), { CP_TEXT("a"), CP_TEXT("b") });
+		ret &= expectInt(first, CP_TEXT("b"), 11);
+		ret &= expectInt(second, CP_TEXT("a"), 1);
+		ret &= expectInt(second, CP_TEXT("b"), 2);
+
+		graph.Forget(first);
+		CP_SF(first);
+		ret &= hasPaths("changed", graph.Set(second, CP_TEXT("a"), CP_TEXT("5")), { CP_TEXT("a"), CP_TEXT("b") });
+		ret &= expectInt(second, CP_TEXT("b"), 6);
+		graph.Forget(second);
+		CP_SF(second);
+		if (graph.GetCount()) {
+			std::printf("  count: expected 0 after forgetting the roots, got %zu\n", graph.GetCount());
+			ret = false;
+		}
+		return ret;
+	}
+
+	/*!
+	 * \brief A reloaded leaf read by a compound statement of its includer does
+	 *		  not accumulate on the previous value, destroying another watcher
+	 *		  leaves the tree usable
+	*/
+	bool watcherCompound() {
+		writeSource("step.conf", "int step = 1\n");
+		writeSource("main.conf", "%use \"step.conf\"\nint port = 8000\nport += step\n");
+
+		ConfWatcher watcher{ "main.conf" };
+		bool ret = expectInt(watcher.GetRoot().get(), CP_TEXT("port"), 8001);
+		{
+			ConfWatcher other{ "main.conf" };
+		}
+		writeSource("step.conf", "int step = 5\n");
+		if (!watcher.Reload({ ConfParser::CanonicalPath("step.conf") })) {
+			std::printf("  step.conf: expected a reload\n");
+			ret = false;
+		}
+		ret &= expectInt(watcher.GetRoot().get(), CP_TEXT("port"), 8005);
+		return ret;
+	}
+
+	/*!
+	 * \brief A published root stays unchanged after the next reloads, and
+	 *		  readable once its types are replaced and the watcher destroyed.
+	 *		  A conditional block of another file does not make a reload full
+	*/
+	bool watcherSnapshot() {
+		writeSource("types.conf", "class Shared {\nint aVar\n}\nShared shared\nshared.aVar = 3\n");
+		writeSource("step.conf", "int step = 1\n");
+		writeSource("main.conf", "%use \"types.conf\"\n%use \"step.conf\"\n%ifdef DBG\nint dbg = 1\n%endif\nint port = 8000\n");
+
+		std::shared_ptr<ConfScope> first, second;
+		bool ret = true;
+		{
+			ConfWatcher watcher{ "main.conf" };
+			first = watcher.GetRoot();
+			writeSource("step.conf", "int step = 5\n");
+			watcher.Reload({ ConfParser::CanonicalPath("step.conf") });
+			//The statement and the empty last line of the file
+			if (watcher.GetEvaluatedCount() != 2) {
+				std::printf("  step.conf: expected 2 lines evaluated, got %zu\n", watcher.GetEvaluatedCount());
+				ret = false;
+			}
+			second = watcher.GetRoot();
+			//A class body changes, every statement is evaluated again
+			writeSource("types.conf", "class Shared {\nint aVar\nint bVar\n}\nShared shared\nshared.aVar = 4\n");
+			watcher.Reload({ ConfParser::CanonicalPath("types.conf") });
+			ret &= expectInt(watcher.GetRoot().get(), CP_TEXT("shared.aVar"), 4);
+		}
+		ret &= expectInt(first.get(), CP_TEXT("step"), 1);
+		ret &= expectInt(first.get(), CP_TEXT("shared.aVar"), 3);
+		ret &= expectInt(second.get(), CP_TEXT("step"), 5);
+		ret &= expectInt(second.get(), CP_TEXT("shared.aVar"), 3);
+		return ret;
+	}
+
+	/*!
+	 * \brief An include cycle is reported, the files are still loaded, and
+	 *		  forgotten once a reload breaks it
+	*/
+	bool watcherIncludeCycle() {
+		writeSource("a.conf", "%use \"b.conf\"\nint a = 1\n");
+		writeSource("b.conf", "%use \"a.conf\"\nint b = 2\n");
+
+		ConfWatcher watcher{ "a.conf" };
+		bool ret = hasChilds(watcher.GetRoot().get(), { CP_TEXT("b"), CP_TEXT("a") });
+		const auto& cycles = watcher.GetIncludeCycles();
+		auto cycle = cycles.find(ConfParser::CanonicalPath("b.conf"));
+		if (cycles.size() != 1 || cycle == cycles.end() ||
+			cycle->second != std::vector<std::filesystem::path>{ ConfParser::CanonicalPath("a.conf") }) {
+			std::printf("  cycles: expected b.conf -> a.conf\n");
+			ret = false;
+		}
+		writeSource("b.conf", "int b = 3\n");
+		watcher.Reload({ ConfParser::CanonicalPath("b.conf") });
+		ret &= expectInt(watcher.GetRoot().get(), CP_TEXT("b"), 3);
+		if (!watcher.GetIncludeCycles().empty()) {
+			std::printf("  cycles: expected none after the reload\n");
+			ret = false;
+		}
+		return ret;
+	}
+
+	/*!
+	 * \brief Check the roots of parseBatchSharedInclude and the cache counters
+	 *		  since a batch
+	*/
+	bool expectBatch(const std::vector<ConfScope*>& roots, std::uint64_t hits, std::uint64_t misses,
+		std::uint64_t expectedHits, std::uint64_t expectedMisses) {
+		bool ret = true;
+		for (std::size_t i{ 0 }; i < roots.size(); ++i) {
+			ret &= expectInt(roots[i], CP_TEXT("own"), static_cast<int>(i));
+			//The writes of a root reach neither the others nor the cached unit
+			ret &= expectInt(roots[i], CP_TEXT("shared.base"), static_cast<int>(i));
+		}
+		hits = ConfUnitCache::Instance().GetHits() - hits;
+		misses = ConfUnitCache::Instance().GetMisses() - misses;
+		if (hits != expectedHits || misses != expectedMisses) {
+			std::printf("  cache: expected %d hits and %d misses, got %d and %d\n", static_cast<int>(expectedHits),
+				static_cast<int>(expectedMisses), static_cast<int>(hits), static_cast<int>(misses));
+			ret = false;
+		}
+		return ret;
+	}
+
+	/*!
+	 * \brief Files of a batch sharing an include get independent roots, the
+	 *		  include is parsed once then merged from the unit cache
+	*/
+	bool parseBatchSharedInclude() {
+		constexpr int COUNT = 4;
+		writeSource("shared.conf", "class Shared {\nint base\n}\nShared shared\nshared.base = 10\n");
+		std::vector<std::filesystem::path> files;
+		for (int i{ 0 }; i < COUNT; ++i) {
+			const std::string text = "%use \"shared.conf\"\nint own = " + std::to_string(i) +
+				"\nshared.base = own\n";
+			files.push_back("batch" + std::to_string(i) + ".conf");
+			writeSource(files.back(), text.c_str());
+		}
+
+		bool ret = true;
+		ConfParser parser;
+		parser.SetIncludeCache(true);
+		const auto hits = ConfUnitCache::Instance().GetHits();
+		const auto misses = ConfUnitCache::Instance().GetMisses();
+		//Only includes are cached: one miss, then one hit per other file
+		auto roots = parser.ParseBatch(files);
+		ret &= expectBatch(roots, hits, misses, COUNT - 1, 1);
+		//Every include hits now, whatever the thread parsing it
+		const auto threadedHits = ConfUnitCache::Instance().GetHits();
+		auto threaded = parser.ParseBatch(files, COUNT);
+		ret &= expectBatch(threaded, threadedHits, misses + 1, COUNT, 0);
+		roots.insert(roots.end(), threaded.begin(), threaded.end());
+		for (auto& it : roots) CP_SF(it);
+		return ret;
+	}
+
+	const Test Tests[] = {
+		{ "include_diamond_write", includeDiamondWrite },
+		{ "image_previous_parse", imagePreviousParse },
+		{ "image_macros", imageMacros },
+		{ "document_later_write", documentLaterWrite },
+		{ "document_compound", documentCompound },
+		{ "document_lifetime", documentLifetime },
+		{ "document_conditions", documentConditions },
+		{ "preprocessor_nested", preprocessorNested },
+		{ "preprocessor_if", preprocessorIf },
+		{ "preprocessor_unterminated", preprocessorUnterminated },
+		{ "macro_parameters", macroParameters },
+		{ "macro_expansion_cache", macroExpansionCache },
+		{ "macro_redefinition", macroRedefinition },
+		{ "macro_hash", macroHash },
+		{ "value_graph_set", valueGraphSet },
+		{ "value_graph_update", valueGraphUpdate },
+		{ "value_graph_callback", valueGraphCallback },
+		{ "value_graph_roots", valueGraphRoots },
+		{ "watcher_compound", watcherCompound },
+		{ "watcher_snapshot", watcherSnapshot },
+		{ "watcher_include_cycle", watcherIncludeCycle },
+		{ "parse_batch_shared_include", parseBatchSharedInclude },
+	};
+
+	bool run(const Test& test) {
+		const auto dir = std::filesystem::temp_directory_path() / "confparser_tests" / test.Name;
+		std::filesystem::remove_all(dir);
+		std::filesystem::create_directories(dir);
+		const auto cwd = std::filesystem::current_path();
+		std::filesystem::current_path(dir);
+		const bool ret = test.Run();
+		std::filesystem::current_path(cwd);
+		std::printf("%s %s\n", ret ? "PASS" : "FAIL", test.Name);
+		return ret;
+	}
+}
+
+int main(int argc, char** argv) {
+	bool ret = true, found = false;
+	for (const auto& it : Tests) {
+		if (argc > 1 && std::strcmp(argv[1], it.Name)) continue;
+		found = true;
+		ret &= run(it);
+	}
+	if (!found) std::printf("Unknown test %s\n", argv[1]);
+	return ret && found ? 0 : 1;
+}